@@ -0,0 +1,1089 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Local calendar units (hour, day, ISO week, month, year) of UTC times.
+
+Documentation is in calendar.hpp.
+*/
+
+#include "calendar.hpp"
+#include "local_time_cursor.hpp"
+#include "filetime.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+const ULONGLONG ticks_per_hour = 10000ULL * 1000 * 60 * 60;
+const ULONGLONG ticks_per_day = ticks_per_hour * 24;
+const ULONGLONG ticks_per_week = ticks_per_day * 7;
+
+
+struct HourBucketer
+{
+    DWORD operator()( const ULONGLONG local_ticks )
+    {
+        return (DWORD)( local_ticks / ticks_per_hour );
+    }
+};
+
+
+struct DayBucketer
+{
+    DWORD operator()( const ULONGLONG local_ticks )
+    {
+        return (DWORD)( local_ticks / ticks_per_day );
+    }
+};
+
+
+// 1601-01-01 is a Monday so the ISO weeks begin at 0
+struct WeekBucketer
+{
+    DWORD operator()( const ULONGLONG local_ticks )
+    {
+        return (DWORD)( local_ticks / ticks_per_week );
+    }
+};
+
+
+// The range of the last month is remembered since the months are not the same length
+class MonthBucketer
+{
+public:
+    MonthBucketer() : _begin( 0 ), _end( 0 ), _bucket( 0 ) {}
+
+    DWORD operator()( const ULONGLONG local_ticks )
+    {
+        if( ( local_ticks - _begin ) >= ( _end - _begin ) )
+        {
+            const ULONGLONG days = local_ticks / ticks_per_day;
+            unsigned year = 0, month = 0, day = 0;
+            jay::time::DaysToDate( days, year, month, day );
+
+            _begin = ( days - ( day - 1 ) ) * ticks_per_day;
+            _end = _begin + ( jay::time::GetDaysInMonth( month, year ) * ticks_per_day );
+            _bucket = ( ( year - 1601 ) * 12 ) + ( month - 1 );
+        }
+
+        return _bucket;
+    }
+
+private:
+    ULONGLONG _begin;
+    ULONGLONG _end;
+    DWORD _bucket;
+};
+
+
+// The range of the last year is remembered the same as for months
+class YearBucketer
+{
+public:
+    YearBucketer() : _begin( 0 ), _end( 0 ), _bucket( 0 ) {}
+
+    DWORD operator()( const ULONGLONG local_ticks )
+    {
+        if( ( local_ticks - _begin ) >= ( _end - _begin ) )
+        {
+            unsigned year = 0, month = 0, day = 0;
+            jay::time::DaysToDate( local_ticks / ticks_per_day, year, month, day );
+
+            _begin = jay::time::DateToDays( 1, 1, year ) * ticks_per_day;
+            _end = _begin + ( ( 365 + jay::time::IsLeapYear( year ) ) * ticks_per_day );
+            _bucket = year - 1601;
+        }
+
+        return _bucket;
+    }
+
+private:
+    ULONGLONG _begin;
+    ULONGLONG _end;
+    DWORD _bucket;
+};
+
+
+// Output the bucket of each time
+class BucketWriter
+{
+public:
+    explicit BucketWriter( DWORD buckets[] ) : _buckets( buckets ) {}
+
+    void operator()( const size_t index, const DWORD bucket ) { _buckets[ index ] = bucket; }
+    void Invalid( const size_t index ) { _buckets[ index ] = JAY_TIME_INVALID_CALENDAR_BUCKET; }
+
+private:
+    DWORD *_buckets;
+};
+
+
+// Count the times in each bucket
+class BucketCounter
+{
+public:
+    BucketCounter( const DWORD first_bucket, ULONGLONG counts[], const size_t bucket_count ) :
+        _first_bucket( first_bucket ), _counts( counts ), _bucket_count( bucket_count ) {}
+
+    void operator()( const size_t, const DWORD bucket )
+    {
+        if( ( bucket >= _first_bucket ) && ( ( bucket - _first_bucket ) < _bucket_count ) )
+            ++_counts[ bucket - _first_bucket ];
+    }
+
+    void Invalid( const size_t ) {}
+
+private:
+    const DWORD _first_bucket;
+    ULONGLONG *_counts;
+    const size_t _bucket_count;
+};
+
+
+// Add up the values of the times in each bucket
+class BucketSummer
+{
+public:
+    BucketSummer(
+        const double values[],
+        const DWORD first_bucket,
+        double sums[],
+        const size_t bucket_count
+    ) :
+        _values( values ), _first_bucket( first_bucket ), _sums( sums ),
+        _bucket_count( bucket_count ) {}
+
+    void operator()( const size_t index, const DWORD bucket )
+    {
+        if( ( bucket >= _first_bucket ) && ( ( bucket - _first_bucket ) < _bucket_count ) )
+            _sums[ bucket - _first_bucket ] += _values[ index ];
+    }
+
+    void Invalid( const size_t ) {}
+
+private:
+    const double *_values;
+    const DWORD _first_bucket;
+    double *_sums;
+    const size_t _bucket_count;
+};
+
+
+/* Pass the bucket of each time to 'output'. Each time is converted with the cursor's window, so the
+cursor is only called when a time is outside of it.
+*/
+template <class Bucketer, class Output>
+bool ForEachCalendarBucket(
+    const FILETIME utc_times[],
+    const size_t count,
+    jay::time::LocalTimeCursor &cursor,
+    Bucketer bucketer,
+    Output &output
+)
+{
+    jay::time::LocalTimeWindow window = {};
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const ULONGLONG utc_ticks = jay::time::FileTimeToTicks( utc_times[ i ] );
+
+        if( !jay::time::IsTimeInWindow( window, utc_ticks )
+            && !cursor.GetWindow( utc_ticks, window )
+        )
+        {
+            if( !first_error )
+                first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+            output.Invalid( i );
+            continue;
+        }
+
+        output( i, bucketer( utc_ticks + window.offset ) );
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+
+template <class Output>
+bool ForEachCalendarBucket(
+    const FILETIME utc_times[],
+    const size_t count,
+    const jay::time::CalendarUnit unit,
+    jay::time::LocalTimeCursor &cursor,
+    Output &output
+)
+{
+    switch( unit )
+    {
+    case jay::time::CALENDAR_HOUR:
+        return ForEachCalendarBucket( utc_times, count, cursor, HourBucketer(), output );
+    case jay::time::CALENDAR_DAY:
+        return ForEachCalendarBucket( utc_times, count, cursor, DayBucketer(), output );
+    case jay::time::CALENDAR_WEEK:
+        return ForEachCalendarBucket( utc_times, count, cursor, WeekBucketer(), output );
+    case jay::time::CALENDAR_MONTH:
+        return ForEachCalendarBucket( utc_times, count, cursor, MonthBucketer(), output );
+    case jay::time::CALENDAR_YEAR:
+        return ForEachCalendarBucket( utc_times, count, cursor, YearBucketer(), output );
+    }
+
+    SetLastError( ERROR_INVALID_PARAMETER );
+    return false;
+}
+
+
+/* Converts UTC ticks to local ticks with the window of a cursor, so the cursor is only called when
+a time is outside of it. If there's no cursor the times are UTC and only checked.
+*/
+class LocalTicksConverter
+{
+public:
+    // 'cursor' is the zone of the local times, or NULL for UTC
+    explicit LocalTicksConverter( jay::time::LocalTimeCursor *cursor ) : _cursor( cursor )
+    {
+        const jay::time::LocalTimeWindow empty = {};
+        _window = empty;
+    }
+
+    bool operator()( const ULONGLONG utc_ticks, ULONGLONG &local_ticks )
+    {
+        LONGLONG ticks = (LONGLONG)utc_ticks;
+
+        if( _cursor )
+        {
+            if( !jay::time::IsTimeInWindow( _window, utc_ticks )
+                && !_cursor->GetWindow( utc_ticks, _window )
+            )
+                return false;
+
+            ticks += _window.offset;
+        }
+
+        if( ( utc_ticks > JAY_TIME_MAX_FILETIME_TICKS )
+            || ( ticks < 0 ) || ( (ULONGLONG)ticks > JAY_TIME_MAX_FILETIME_TICKS )
+        )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        local_ticks = (ULONGLONG)ticks;
+        return true;
+    }
+
+private:
+    jay::time::LocalTimeCursor *const _cursor;
+    jay::time::LocalTimeWindow _window;
+};
+
+
+enum Rounding
+{
+    ROUND_FLOOR,
+    ROUND_CEIL,
+    ROUND_NEAREST
+};
+
+
+/* Finds the UTC times at which the local calendar unit of a UTC time begins and at which the next
+one begins. The last unit's times are remembered, so a sorted stream of times only converts local
+time to UTC time when the unit changes.
+
+The beginning of a unit is the first UTC time whose local time is in it. If the unit's local start
+doesn't exist that's the transition at the end of the gap, and if it exists twice that's the first
+one. The beginning of the next unit is the first one after the UTC time.
+*/
+class CalendarUnitResolver
+{
+public:
+    // 'cursor' is the zone of the local times, or NULL for UTC
+    CalendarUnitResolver( const jay::time::CalendarUnit unit, jay::time::LocalTimeCursor *cursor ) :
+        _unit( unit ),
+        _cursor( cursor ),
+        _converter( cursor ),
+        _valid( false ),
+        _bucket( 0 ),
+        _begin( 0 ),
+        _has_next( false ),
+        _next_earlier( 0 ),
+        _next_later( 0 )
+    {
+    }
+
+    bool Resolve( const ULONGLONG utc_ticks, const Rounding rounding, ULONGLONG &result )
+    {
+        ULONGLONG local_ticks = 0;
+
+        if( !_converter( utc_ticks, local_ticks ) )
+            return false;
+
+        const DWORD bucket = GetBucket( local_ticks );
+        if( ( !_valid || ( bucket != _bucket ) ) && !SetBucket( bucket ) )
+            return false;
+
+        if( ( rounding == ROUND_FLOOR ) || ( _begin == utc_ticks ) )
+        {
+            result = _begin;
+            return true;
+        }
+
+        if( !_has_next )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        const ULONGLONG next = ( _next_earlier > utc_ticks ) ? _next_earlier : _next_later;
+
+        if( rounding == ROUND_CEIL )
+            result = next;
+        else // half way rounds up
+            result = ( ( utc_ticks - _begin ) < ( next - utc_ticks ) ) ? _begin : next;
+
+        return true;
+    }
+
+private:
+    DWORD GetBucket( const ULONGLONG local_ticks )
+    {
+        switch( _unit )
+        {
+        case jay::time::CALENDAR_HOUR:
+            return HourBucketer()( local_ticks );
+        case jay::time::CALENDAR_DAY:
+            return DayBucketer()( local_ticks );
+        case jay::time::CALENDAR_WEEK:
+            return WeekBucketer()( local_ticks );
+        case jay::time::CALENDAR_MONTH:
+            return _month( local_ticks );
+        case jay::time::CALENDAR_YEAR:
+            return _year( local_ticks );
+        }
+
+        return 0;
+    }
+
+    // The UTC time at which a bucket begins
+    bool GetBeginning(
+        const DWORD bucket,
+        const jay::time::LocalTimePolicy ambiguous,
+        ULONGLONG &utc_ticks
+    ) const
+    {
+        SYSTEMTIME local = {}, utc = {};
+        DWORD tzi_id = 0;
+        FILETIME ft;
+
+        if( !jay::time::CalendarBucketToLocalTime( bucket, _unit, local ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        if( !_cursor )
+            utc = local;
+        else if( !jay::time::LocalTimeToUTCTime( local, utc, tzi_id,
+                jay::time::LOCAL_TIME_SHIFT, ambiguous, _cursor->GetProvider() )
+        )
+            return false;
+
+        if( !SystemTimeToFileTime( &utc, &ft ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        utc_ticks = jay::time::FileTimeToTicks( ft );
+        return true;
+    }
+
+    bool SetBucket( const DWORD bucket )
+    {
+        _valid = false;
+
+        if( !GetBeginning( bucket, jay::time::LOCAL_TIME_EARLIER, _begin ) )
+            return false;
+
+        // the last unit has no next unit
+        _has_next = ( bucket != JAY_TIME_INVALID_CALENDAR_BUCKET - 1 )
+            && GetBeginning( bucket + 1, jay::time::LOCAL_TIME_EARLIER, _next_earlier )
+            && GetBeginning( bucket + 1, jay::time::LOCAL_TIME_LATER, _next_later );
+
+        _bucket = bucket;
+        _valid = true;
+        return true;
+    }
+
+    const jay::time::CalendarUnit _unit;
+    jay::time::LocalTimeCursor *const _cursor;
+    LocalTicksConverter _converter;
+    MonthBucketer _month;
+    YearBucketer _year;
+
+    bool _valid;
+    DWORD _bucket;
+    ULONGLONG _begin;
+    bool _has_next;
+    ULONGLONG _next_earlier;
+    ULONGLONG _next_later;
+};
+
+
+bool IsCalendarUnitValid( const jay::time::CalendarUnit unit )
+{
+    return ( unit >= jay::time::CALENDAR_HOUR ) && ( unit <= jay::time::CALENDAR_YEAR );
+}
+
+
+bool RoundToCalendarUnit(
+    const FILETIME &utc_ft,
+    const jay::time::CalendarUnit unit,
+    jay::time::LocalTimeCursor *cursor,
+    const Rounding rounding,
+    FILETIME &result
+)
+{
+    if( !IsCalendarUnitValid( unit ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    CalendarUnitResolver resolver( unit, cursor );
+    ULONGLONG ticks = 0;
+
+    if( !resolver.Resolve( jay::time::FileTimeToTicks( utc_ft ), rounding, ticks ) )
+        return false;
+
+    jay::time::TicksToFileTime( ticks, result );
+    return true;
+}
+
+
+bool RoundToCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const jay::time::CalendarUnit unit,
+    jay::time::LocalTimeCursor *cursor,
+    const Rounding rounding
+)
+{
+    if( !IsCalendarUnitValid( unit ) || ( count && ( !utc_times || !results ) ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    CalendarUnitResolver resolver( unit, cursor );
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        ULONGLONG ticks = 0;
+
+        if( resolver.Resolve( jay::time::FileTimeToTicks( utc_times[ i ] ), rounding, ticks ) )
+        {
+            jay::time::TicksToFileTime( ticks, results[ i ] );
+            continue;
+        }
+
+        if( !first_error )
+            first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+        ZeroMemory( &results[ i ], sizeof( results[ i ] ) );
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// The local date and time of day of local ticks
+struct LocalDate
+{
+    unsigned year;
+    unsigned month;
+    unsigned day;
+    ULONGLONG time_of_day;
+};
+
+void GetLocalDate( const ULONGLONG local_ticks, LocalDate &date )
+{
+    jay::time::DaysToDate( local_ticks / ticks_per_day, date.year, date.month, date.day );
+    date.time_of_day = local_ticks % ticks_per_day;
+}
+
+
+/* The difference from one local time to another in calendar units. If 'whole' then a unit is only
+counted if the time from plus the units doesn't pass the time to. For months and years the day is
+clamped to the end of the month, the same as SystemTimeAdd().
+*/
+class CalendarDifference
+{
+public:
+    CalendarDifference(
+        const jay::time::CalendarUnit unit,
+        const bool whole,
+        const ULONGLONG to_local_ticks
+    ) :
+        _unit( unit ), _whole( whole ), _to( to_local_ticks ), _unit_ticks( 0 )
+    {
+        switch( unit )
+        {
+        case jay::time::CALENDAR_HOUR:
+            _unit_ticks = ticks_per_hour;
+            break;
+        case jay::time::CALENDAR_DAY:
+            _unit_ticks = ticks_per_day;
+            break;
+        case jay::time::CALENDAR_WEEK:
+            _unit_ticks = ticks_per_week;
+            break;
+        default:
+            break;
+        }
+
+        GetLocalDate( to_local_ticks, _to_date );
+    }
+
+    LONGLONG operator()( const ULONGLONG from_local_ticks ) const
+    {
+        // Hours, days and weeks are a fixed number of local ticks. 1601-01-01 is a Monday so the
+        // weeks are ISO weeks.
+        if( _unit_ticks && _whole )
+            return ( (LONGLONG)_to - (LONGLONG)from_local_ticks ) / (LONGLONG)_unit_ticks;
+
+        if( _unit_ticks )
+            return (LONGLONG)( _to / _unit_ticks ) - (LONGLONG)( from_local_ticks / _unit_ticks );
+
+        LocalDate from;
+        GetLocalDate( from_local_ticks, from );
+
+        const bool years = ( _unit == jay::time::CALENDAR_YEAR );
+
+        LONGLONG difference = (LONGLONG)_to_date.year - from.year;
+        if( !years )
+            difference = ( difference * 12 ) + ( (LONGLONG)_to_date.month - from.month );
+
+        if( !_whole || !difference )
+            return difference;
+
+        // The time from plus the difference is in the month of the time to, or for years in the
+        // month of the time from in the year of the time to.
+        const unsigned month = years ? from.month : _to_date.month;
+        const unsigned days_in_month = jay::time::GetDaysInMonth( month, _to_date.year );
+        const unsigned day = ( from.day < days_in_month ) ? from.day : days_in_month;
+
+        const ULONGLONG sum = ( ( ( month * 32ULL ) + day ) * ticks_per_day ) + from.time_of_day;
+        const ULONGLONG to = ( ( ( _to_date.month * 32ULL ) + _to_date.day ) * ticks_per_day )
+            + _to_date.time_of_day;
+
+        if( ( difference > 0 ) && ( sum > to ) )
+            --difference;
+        else if( ( difference < 0 ) && ( sum < to ) )
+            ++difference;
+
+        return difference;
+    }
+
+private:
+    const jay::time::CalendarUnit _unit;
+    const bool _whole;
+    const ULONGLONG _to;
+    ULONGLONG _unit_ticks;
+    LocalDate _to_date;
+};
+
+
+bool GetDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const jay::time::CalendarUnit unit,
+    jay::time::LocalTimeCursor *cursor,
+    const bool whole,
+    long long &difference
+)
+{
+    if( !IsCalendarUnitValid( unit ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    LocalTicksConverter converter( cursor );
+    ULONGLONG from = 0, to = 0;
+
+    if( !converter( jay::time::FileTimeToTicks( from_utc ), from )
+        || !converter( jay::time::FileTimeToTicks( to_utc ), to )
+    )
+        return false;
+
+    difference = CalendarDifference( unit, whole, to )( from );
+    return true;
+}
+
+
+bool GetDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const jay::time::CalendarUnit unit,
+    jay::time::LocalTimeCursor *cursor,
+    const bool whole
+)
+{
+    if( !IsCalendarUnitValid( unit ) || ( count && ( !utc_times || !differences ) ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    LocalTicksConverter converter( cursor );
+    ULONGLONG to = 0;
+
+    if( !converter( jay::time::FileTimeToTicks( to_utc ), to ) )
+    {
+        for( size_t i = 0; i < count; ++i )
+            differences[ i ] = 0;
+
+        return false;
+    }
+
+    const CalendarDifference calculate( unit, whole, to );
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        ULONGLONG from = 0;
+
+        if( converter( jay::time::FileTimeToTicks( utc_times[ i ] ), from ) )
+        {
+            differences[ i ] = calculate( from );
+            continue;
+        }
+
+        if( !first_error )
+            first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+        differences[ i ] = 0;
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+bool GetCalendarBuckets(
+    const FILETIME utc_times[],
+    DWORD buckets[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    if( count && ( !utc_times || !buckets ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    BucketWriter output( buckets );
+    return ForEachCalendarBucket( utc_times, count, unit, cursor, output );
+}
+
+
+
+bool CountCalendarBuckets(
+    const FILETIME utc_times[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    const DWORD first_bucket,
+    ULONGLONG counts[],
+    const size_t bucket_count
+)
+{
+    if( ( count && !utc_times ) || ( bucket_count && !counts ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    BucketCounter output( first_bucket, counts, bucket_count );
+    return ForEachCalendarBucket( utc_times, count, unit, cursor, output );
+}
+
+
+bool SumCalendarBuckets(
+    const FILETIME utc_times[],
+    const double values[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    const DWORD first_bucket,
+    double sums[],
+    const size_t bucket_count
+)
+{
+    if( ( count && ( !utc_times || !values ) ) || ( bucket_count && !sums ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    BucketSummer output( values, first_bucket, sums, bucket_count );
+    return ForEachCalendarBucket( utc_times, count, unit, cursor, output );
+}
+
+
+
+bool LocalTimeToCalendarBucket( const SYSTEMTIME &local, const CalendarUnit unit, DWORD &bucket )
+{
+    FILETIME ft;
+    if( !IsSystemTimeValid_IgnoreDayOfWeek( local ) || !SystemTimeToFileTime( &local, &ft ) )
+        return false;
+
+    const ULONGLONG ticks = FileTimeToTicks( ft );
+
+    switch( unit )
+    {
+    case CALENDAR_HOUR:
+        bucket = HourBucketer()( ticks );
+        return true;
+    case CALENDAR_DAY:
+        bucket = DayBucketer()( ticks );
+        return true;
+    case CALENDAR_WEEK:
+        bucket = WeekBucketer()( ticks );
+        return true;
+    case CALENDAR_MONTH:
+        bucket = ( ( local.wYear - 1601 ) * 12 ) + ( local.wMonth - 1 );
+        return true;
+    case CALENDAR_YEAR:
+        bucket = local.wYear - 1601;
+        return true;
+    }
+
+    return false;
+}
+
+
+
+bool CalendarBucketToLocalTime( const DWORD bucket, const CalendarUnit unit, SYSTEMTIME &local )
+{
+    ULONGLONG unit_ticks = 0;
+
+    switch( unit )
+    {
+    case CALENDAR_HOUR:
+        unit_ticks = ticks_per_hour;
+        break;
+    case CALENDAR_DAY:
+        unit_ticks = ticks_per_day;
+        break;
+    case CALENDAR_WEEK:
+        unit_ticks = ticks_per_week;
+        break;
+    case CALENDAR_MONTH:
+    case CALENDAR_YEAR:
+    {
+        const DWORD months = ( unit == CALENDAR_YEAR ) ? 0 : ( bucket % 12 );
+        const DWORD years = ( unit == CALENDAR_YEAR ) ? bucket : ( bucket / 12 );
+
+        // compared before adding so that a large year bucket doesn't wrap
+        if( ( years > ( 30827 - 1601 ) ) || !IsYearValid( 1601 + years ) )
+            return false;
+
+        const SYSTEMTIME st = { (WORD)( 1601 + years ), (WORD)( months + 1 ), 0, 1, 0, 0, 0, 0 };
+        local = st;
+        local.wDayOfWeek = GetDayOfWeek( local.wDay, local.wMonth, local.wYear );
+        return true;
+    }
+    default:
+        return false;
+    }
+
+    // this is the same time as max SYSTEMTIME
+    const FILETIME max = { 0xF06C58F0, 0x7FFF35F4 };
+
+    if( bucket > ( FileTimeToTicks( max ) / unit_ticks ) )
+        return false;
+
+    FILETIME ft;
+    TicksToFileTime( bucket * unit_ticks, ft );
+    return !!FileTimeToSystemTime( &ft, &local );
+}
+
+
+
+bool FloorCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+)
+{
+    return RoundToCalendarUnit( utc_ft, unit, &cursor, ROUND_FLOOR, result );
+}
+
+
+bool FloorCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result )
+{
+    return RoundToCalendarUnit( utc_ft, unit, NULL, ROUND_FLOOR, result );
+}
+
+
+bool FloorCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, &cursor, ROUND_FLOOR );
+}
+
+
+bool FloorCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, NULL, ROUND_FLOOR );
+}
+
+
+
+bool CeilCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+)
+{
+    return RoundToCalendarUnit( utc_ft, unit, &cursor, ROUND_CEIL, result );
+}
+
+
+bool CeilCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result )
+{
+    return RoundToCalendarUnit( utc_ft, unit, NULL, ROUND_CEIL, result );
+}
+
+
+bool CeilCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, &cursor, ROUND_CEIL );
+}
+
+
+bool CeilCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, NULL, ROUND_CEIL );
+}
+
+
+
+bool RoundCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+)
+{
+    return RoundToCalendarUnit( utc_ft, unit, &cursor, ROUND_NEAREST, result );
+}
+
+
+bool RoundCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result )
+{
+    return RoundToCalendarUnit( utc_ft, unit, NULL, ROUND_NEAREST, result );
+}
+
+
+bool RoundCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, &cursor, ROUND_NEAREST );
+}
+
+
+bool RoundCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+)
+{
+    return RoundToCalendarUnit( utc_times, results, count, unit, NULL, ROUND_NEAREST );
+}
+
+
+
+bool GetCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    long long &difference
+)
+{
+    return GetDifference( from_utc, to_utc, unit, &cursor, false, difference );
+}
+
+
+bool GetCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    long long &difference
+)
+{
+    return GetDifference( from_utc, to_utc, unit, NULL, false, difference );
+}
+
+
+bool GetCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    return GetDifference( utc_times, to_utc, differences, count, unit, &cursor, false );
+}
+
+
+bool GetCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit
+)
+{
+    return GetDifference( utc_times, to_utc, differences, count, unit, NULL, false );
+}
+
+
+
+bool GetWholeCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    long long &difference
+)
+{
+    return GetDifference( from_utc, to_utc, unit, &cursor, true, difference );
+}
+
+
+bool GetWholeCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    long long &difference
+)
+{
+    return GetDifference( from_utc, to_utc, unit, NULL, true, difference );
+}
+
+
+bool GetWholeCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+)
+{
+    return GetDifference( utc_times, to_utc, differences, count, unit, &cursor, true );
+}
+
+
+bool GetWholeCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit
+)
+{
+    return GetDifference( utc_times, to_utc, differences, count, unit, NULL, true );
+}
+
+} // namespace time
+} // namespace jay
@@ -0,0 +1,400 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Local calendar units (hour, day, ISO week, month, year) of UTC times.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+A calendar bucket is a dense number for a local hour, day, ISO week, month or year, counted from the
+first one that begins on January 1, 1601 (a Monday):
+
+CALENDAR_HOUR : The number of local hours since 1601-01-01 00:00.
+CALENDAR_DAY : The number of local days since 1601-01-01.
+CALENDAR_WEEK : The number of ISO weeks (Monday to Sunday) since the week of 1601-01-01.
+CALENDAR_MONTH : ( year - 1601 ) * 12 + ( month - 1 )
+CALENDAR_YEAR : year - 1601
+
+Consecutive local hours, days, weeks, months and years have consecutive buckets, so an array
+indexed by 'bucket - first_bucket' holds a count or sum for each of them. The buckets of UTC times
+are calculated with a LocalTimeCursor (refer to local_time_cursor.hpp) so the zone is the cursor's
+zone and converting a sorted stream costs one comparison per time. The bucket of a local time is
+then a division, except for months and years where the current one's range is remembered.
+
+The bucket is of the local time, so the day on which the clocks go back has 25 hours of UTC times
+and the day on which they go forward has 23. The local hour that is repeated when the clocks go back
+is one bucket with the UTC times of both, and the local hour that is skipped when they go forward
+has no UTC times.
+
+To count events per local day:
+
+    LocalTimeCursor cursor( *Timezone::Find( L"Eastern Standard Time" ) );
+    DWORD first = 0;
+    LocalTimeToCalendarBucket( first_local_day, CALENDAR_DAY, first );
+    vector<ULONGLONG> counts( days );
+    CountCalendarBuckets( utc_times, n, CALENDAR_DAY, cursor, first, &counts[ 0 ], days );
+
+FloorCalendarUnit(), CeilCalendarUnit() and RoundCalendarUnit() output the UTC time at which the
+local unit of a UTC time begins or the next one begins, for example the start of the local day for
+log rotation. They're calculated with the buckets, in ticks, and the local start of a unit is
+converted to UTC time by LocalTimeToUTCTime() only when the unit changes.
+
+GetCalendarDifference() and GetWholeCalendarDifference() count the local units between two UTC
+times, eg the age of a file in local days. They're calculated from the buckets and the local ticks,
+so the number of days between two times is the same on the days the clocks change. The exact elapsed
+time between two times is FileTime::Difference() in filetime.hpp.
+
+    LocalTimeCursor cursor( *Timezone::Find( L"Eastern Standard Time" ) );
+    vector<long long> ages( n );
+    GetCalendarDifference( file_times, now, &ages[ 0 ], n, CALENDAR_DAY, cursor );
+
+The functions have no shared state other than the cursor, and the counts and sums are added to the
+caller's arrays. To count in parallel give each thread its own cursor, its own part of the times and
+its own arrays, then add the arrays together.
+*/
+
+#ifndef _JAY_TIME_CALENDAR_HPP
+#define _JAY_TIME_CALENDAR_HPP
+
+#include "local_time_cursor.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+// The bucket output for a time that could not be converted
+#define JAY_TIME_INVALID_CALENDAR_BUCKET ( (DWORD)-1 )
+
+
+enum CalendarUnit
+{
+    CALENDAR_HOUR,
+    CALENDAR_DAY,
+    CALENDAR_WEEK,
+    CALENDAR_MONTH,
+    CALENDAR_YEAR
+};
+
+
+/* GetCalendarBuckets()
+- Get the local calendar buckets of UTC times.
+
+Each time that could not be converted is JAY_TIME_INVALID_CALENDAR_BUCKET in 'buckets'.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : 'unit' is invalid.
+ERROR_INVALID_TIME : A UTC time is invalid or its local time could not be determined.
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'utc_times' : UTC times
+[out] 'buckets' : The bucket of each time
+[in] 'count' : The number of times in 'utc_times' and 'buckets'
+[in] 'unit' : The calendar unit of the buckets
+[in] 'cursor' : The zone of the local times
+[ret][failure] (false) : At least one time could not be converted. An error code was set.
+[ret][success] (true) : All the buckets were output
+*/
+bool GetCalendarBuckets(
+    const FILETIME utc_times[],
+    DWORD buckets[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+
+
+/* CountCalendarBuckets()
+* SumCalendarBuckets()
+- Count the UTC times in each local calendar bucket, or add up their values.
+
+'counts[ i ]' or 'sums[ i ]' is incremented by each time in bucket 'first_bucket + i'. The arrays
+are not cleared first, so the results of several calls can be accumulated. A time in a bucket
+outside of the arrays is ignored. A time that could not be converted is ignored and is a failure.
+
+The error codes are the same as GetCalendarBuckets().
+
+[in] 'utc_times' : UTC times
+[in] 'values' : The value of each time
+[in] 'count' : The number of times in 'utc_times' and 'values'
+[in] 'unit' : The calendar unit of the buckets
+[in] 'cursor' : The zone of the local times
+[in] 'first_bucket' : The bucket of 'counts[ 0 ]' or 'sums[ 0 ]'
+[in][out] 'counts' / 'sums' : The count or sum of each bucket
+[in] 'bucket_count' : The number of buckets in 'counts' or 'sums'
+[ret][failure] (false) : At least one time could not be converted. An error code was set.
+[ret][success] (true) : All the times were converted
+*/
+bool CountCalendarBuckets(
+    const FILETIME utc_times[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    const DWORD first_bucket,
+    ULONGLONG counts[],
+    const size_t bucket_count
+);
+bool SumCalendarBuckets(
+    const FILETIME utc_times[],
+    const double values[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    const DWORD first_bucket,
+    double sums[],
+    const size_t bucket_count
+);
+
+
+/* LocalTimeToCalendarBucket()
+- Get the calendar bucket of a local time.
+
+[in] 'local' : Local time. wDayOfWeek is ignored.
+[in] 'unit' : The calendar unit of the bucket
+[out] 'bucket' : The bucket that contains 'local'
+[ret][failure] (false) : 'local' or 'unit' is invalid
+[ret][success] (true) : The bucket was output
+*/
+bool LocalTimeToCalendarBucket( const SYSTEMTIME &local, const CalendarUnit unit, DWORD &bucket );
+
+
+/* CalendarBucketToLocalTime()
+- Get the local time at the beginning of a calendar bucket.
+
+[in] 'bucket' : The bucket
+[in] 'unit' : The calendar unit of the bucket
+[out] 'local' : The local time at the beginning of 'bucket'
+[ret][failure] (false) : 'bucket' or 'unit' is invalid
+[ret][success] (true) : The local time was output
+*/
+bool CalendarBucketToLocalTime( const DWORD bucket, const CalendarUnit unit, SYSTEMTIME &local );
+
+
+
+/* FloorCalendarUnit()
+* CeilCalendarUnit()
+* RoundCalendarUnit()
+- Get the UTC time at which the local calendar unit of a UTC time begins, or the next one begins.
+
+Floor is the beginning of the unit that contains 'utc_ft'. Ceil is 'utc_ft' if that's the beginning
+of its unit, otherwise the beginning of the next unit. Round is whichever of those is closer, and
+the next unit if it's half way.
+
+The beginning of a unit is the first UTC time whose local time is in the unit, so it is correct
+when the local time at which the unit begins doesn't exist or exists twice:
+
+If the local start (eg midnight) is skipped by the clocks going forward then the unit begins at the
+transition, the first local time after the gap.
+
+If the local start is repeated by the clocks going back then the unit begins at the first one. The
+next unit begins at the first of its starts that is after 'utc_ft'.
+
+As in calendar buckets, the local hour that is repeated when the clocks go back is one unit.
+
+If 'cursor' is not passed then the units are of UTC time. The batch overloads remember the last
+unit, so a sorted stream only converts a local time to UTC time when the unit changes. Each time
+that could not be rounded is zeroed out in 'results'.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : 'unit' is invalid.
+ERROR_INVALID_TIME : A UTC time is invalid or the result is after the maximum valid time.
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'utc_ft' / 'utc_times' : UTC time
+[out] 'result' / 'results' : UTC time
+[in] 'count' : The number of times in 'utc_times' and 'results'
+[in] 'unit' : The calendar unit
+[in][opt] 'cursor' : The zone of the local times. If not passed then UTC.
+[ret][failure] (false) : Failed or, for batch, at least one time failed. An error code was set.
+[ret][success] (true) : The result was output
+*/
+bool FloorCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+);
+bool FloorCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result );
+bool FloorCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+bool FloorCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+);
+bool CeilCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+);
+bool CeilCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result );
+bool CeilCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+bool CeilCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+);
+bool RoundCalendarUnit(
+    const FILETIME &utc_ft,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    FILETIME &result
+);
+bool RoundCalendarUnit( const FILETIME &utc_ft, const CalendarUnit unit, FILETIME &result );
+bool RoundCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+bool RoundCalendarUnit(
+    const FILETIME utc_times[],
+    FILETIME results[],
+    const size_t count,
+    const CalendarUnit unit
+);
+
+
+
+/* GetCalendarDifference()
+* GetWholeCalendarDifference()
+- Get the number of local calendar units from one UTC time to another.
+
+GetCalendarDifference() is the number of unit boundaries crossed, which is the bucket of 'to_utc'
+minus the bucket of the time from. 23:59 to 00:01 the next day is 1 day, and December 31 to
+January 1 is 1 year.
+
+GetWholeCalendarDifference() is the number of whole units. Hours, days and weeks are whole units of
+local clock time, so 10:00 the day before the clocks change to 10:00 the day after is 2 days even
+though it's 47 or 49 hours. Months and years are counted the same as SystemTimeAdd() adds them: the
+largest number of them that can be added to the time from without passing 'to_utc', with the day
+clamped to the end of the month. January 31 to February 28 is 1 month and February 29, 2012 to
+February 28, 2013 is 1 year.
+
+Either is negative if 'to_utc' is before the time from. The batch overloads are the difference from
+each time to 'to_utc', eg the age of each file, and each difference that could not be calculated is
+0 in 'differences'.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : 'unit' is invalid.
+ERROR_INVALID_TIME : A UTC time is invalid or its local time could not be determined.
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'from_utc' / 'utc_times' : UTC time from
+[in] 'to_utc' : UTC time to
+[out] 'difference' / 'differences' : The number of units from each time to 'to_utc'
+[in] 'count' : The number of times in 'utc_times' and 'differences'
+[in] 'unit' : The calendar unit
+[in][opt] 'cursor' : The zone of the local times. If not passed then UTC.
+[ret][failure] (false) : Failed or, for batch, at least one time failed. An error code was set.
+[ret][success] (true) : The difference was output
+*/
+bool GetCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    long long &difference
+);
+bool GetCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    long long &difference
+);
+bool GetCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+bool GetCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit
+);
+bool GetWholeCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor,
+    long long &difference
+);
+bool GetWholeCalendarDifference(
+    const FILETIME &from_utc,
+    const FILETIME &to_utc,
+    const CalendarUnit unit,
+    long long &difference
+);
+bool GetWholeCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit,
+    LocalTimeCursor &cursor
+);
+bool GetWholeCalendarDifference(
+    const FILETIME utc_times[],
+    const FILETIME &to_utc,
+    long long differences[],
+    const size_t count,
+    const CalendarUnit unit
+);
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_CALENDAR_HPP
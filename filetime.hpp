@@ -0,0 +1,432 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+A FILETIME value type, and durations that carry their unit in their type.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+FileTime is a point in time as its number of 100ns intervals since January 1, 1601 (ticks), the same
+as FileTimeToTicks(). It's valid if it's a valid FILETIME (refer to IsFileTimeValid()).
+
+Duration<unit> is a signed count of a unit, where the unit is its number of ticks. The units are:
+
+    Ticks, Microseconds, Milliseconds, Seconds, Minutes, Hours, Days
+
+A duration can only be added to a duration of the same unit, and a FileTime can only be offset by a
+duration, so an offset in minutes can't be mistaken for one in ticks:
+
+    FileTime ft( utc_ft );
+    if( !ft.Subtract( Minutes( tzi.Bias ) ) )
+        ... // the local time is out of range
+
+The unit is a template argument, so converting between units is a multiplication or division by a
+constant and the overflow limits it's checked against are constants too. Nothing is allocated and
+there are no tables; the arithmetic is done in registers.
+
+Arithmetic that can overflow, or leave the range of a valid FileTime, comes in two forms:
+
+Checked (eg Add()) : Returns false on overflow and the output is not modified.
+Saturating (eg SaturatingAdd()) : Clamps the result to the limit it would have passed.
+
+The checked and saturating integer functions (CheckedAdd() etc) use the compiler's overflow builtins
+when it has them (GCC 5 and later) and otherwise compare against the limits before the operation.
+Either way signed overflow, which is undefined, never happens.
+*/
+
+#ifndef _JAY_TIME_FILETIME_HPP
+#define _JAY_TIME_FILETIME_HPP
+
+#include "time.hpp"
+
+#include <limits.h>
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+// The ticks of the max valid FILETIME, { 0xF06C58F0, 0x7FFF35F4 }. Refer to IsFileTimeValid().
+#define JAY_TIME_MAX_FILETIME_TICKS ( ( (ULONGLONG)0x7FFF35F4 << 32 ) | 0xF06C58F0 )
+
+#if defined( __GNUC__ ) && !defined( __clang__ ) && ( __GNUC__ >= 5 )
+#define JAY_TIME_HAS_OVERFLOW_BUILTINS
+#endif
+
+
+/* CheckedAdd()
+* CheckedSubtract()
+* CheckedMultiply()
+- Add, subtract or multiply two signed 64-bit integers if the result doesn't overflow.
+
+[in] 'a' : The first operand
+[in] 'b' : The second operand
+[out] 'result' : The result. It's not modified on failure.
+[ret][failure] (false) : The result would overflow
+[ret][success] (true) : The result was output
+*/
+inline bool CheckedAdd( const LONGLONG a, const LONGLONG b, LONGLONG &result )
+{
+#ifdef JAY_TIME_HAS_OVERFLOW_BUILTINS
+    LONGLONG x;
+    if( __builtin_add_overflow( a, b, &x ) )
+        return false;
+
+    result = x;
+    return true;
+#else
+    if( ( b > 0 ) ? ( a > LLONG_MAX - b ) : ( a < LLONG_MIN - b ) )
+        return false;
+
+    result = a + b;
+    return true;
+#endif
+}
+
+inline bool CheckedSubtract( const LONGLONG a, const LONGLONG b, LONGLONG &result )
+{
+#ifdef JAY_TIME_HAS_OVERFLOW_BUILTINS
+    LONGLONG x;
+    if( __builtin_sub_overflow( a, b, &x ) )
+        return false;
+
+    result = x;
+    return true;
+#else
+    if( ( b > 0 ) ? ( a < LLONG_MIN + b ) : ( a > LLONG_MAX + b ) )
+        return false;
+
+    result = a - b;
+    return true;
+#endif
+}
+
+inline bool CheckedMultiply( const LONGLONG a, const LONGLONG b, LONGLONG &result )
+{
+#ifdef JAY_TIME_HAS_OVERFLOW_BUILTINS
+    LONGLONG x;
+    if( __builtin_mul_overflow( a, b, &x ) )
+        return false;
+
+    result = x;
+    return true;
+#else
+    // when 'b' is a constant, as it is when a duration is scaled, the divisions are folded
+    if( ( a > 0 )
+        ? ( ( b > 0 ) ? ( a > LLONG_MAX / b ) : ( b < LLONG_MIN / a ) )
+        : ( ( b > 0 ) ? ( a < LLONG_MIN / b ) : ( a && ( b < LLONG_MAX / a ) ) )
+    )
+        return false;
+
+    result = a * b;
+    return true;
+#endif
+}
+
+
+/* SaturatingAdd()
+* SaturatingSubtract()
+* SaturatingMultiply()
+- Add, subtract or multiply two signed 64-bit integers, clamping the result to LLONG_MIN/LLONG_MAX.
+
+[in] 'a' : The first operand
+[in] 'b' : The second operand
+[ret] (LONGLONG) : The result, or the limit it would have passed
+*/
+inline LONGLONG SaturatingAdd( const LONGLONG a, const LONGLONG b )
+{
+    LONGLONG result = ( b > 0 ) ? LLONG_MAX : LLONG_MIN;
+    CheckedAdd( a, b, result );
+    return result;
+}
+
+inline LONGLONG SaturatingSubtract( const LONGLONG a, const LONGLONG b )
+{
+    LONGLONG result = ( b > 0 ) ? LLONG_MIN : LLONG_MAX;
+    CheckedSubtract( a, b, result );
+    return result;
+}
+
+inline LONGLONG SaturatingMultiply( const LONGLONG a, const LONGLONG b )
+{
+    LONGLONG result = ( ( a < 0 ) != ( b < 0 ) ) ? LLONG_MIN : LLONG_MAX;
+    CheckedMultiply( a, b, result );
+    return result;
+}
+
+
+
+/* class Duration
+- A signed count of a unit of time.
+
+'unit' is the number of ticks (100ns intervals) in the unit. It must be positive. Converting to a
+larger unit truncates toward zero, so a duration can only be converted exactly to units that it's a
+multiple of. The unit of each typedef is a multiple of the ones before it.
+*/
+template <LONGLONG unit>
+class Duration
+{
+public:
+    explicit Duration( const LONGLONG count = 0 ) : _count( count ) {}
+
+    LONGLONG GetCount() const { return _count; }
+
+
+    /* Duration::Add()
+    * Duration::Subtract()
+    * Duration::Multiply()
+    - Add or subtract a duration, or multiply by a number.
+
+    The checked versions return false on overflow and don't modify the duration. The saturating
+    versions clamp it to LLONG_MIN/LLONG_MAX of the unit.
+
+    [in] 'other' : The duration to add or subtract
+    [in] 'factor' : The number to multiply by
+    [ret][failure] (false) : The result would overflow
+    [ret][success] (true) : The result is the duration
+    */
+    bool Add( const Duration &other ) { return CheckedAdd( _count, other._count, _count ); }
+    bool Subtract( const Duration &other )
+    {
+        return CheckedSubtract( _count, other._count, _count );
+    }
+    bool Multiply( const LONGLONG factor ) { return CheckedMultiply( _count, factor, _count ); }
+
+    void SaturatingAdd( const Duration &other )
+    {
+        _count = jay::time::SaturatingAdd( _count, other._count );
+    }
+    void SaturatingSubtract( const Duration &other )
+    {
+        _count = jay::time::SaturatingSubtract( _count, other._count );
+    }
+    void SaturatingMultiply( const LONGLONG factor )
+    {
+        _count = jay::time::SaturatingMultiply( _count, factor );
+    }
+
+
+    /* Duration::Convert()
+    * Duration::SaturatingConvert()
+    - Convert the duration to another unit.
+
+    Converting to a larger unit truncates toward zero and can't overflow. Converting to a smaller
+    unit multiplies by the ratio of the units, which is a constant.
+
+    [out] 'to' : The duration in unit 'to_unit'. Convert() doesn't modify it on failure.
+    [ret][failure] (false) : The duration would overflow in 'to_unit'
+    [ret][success] (true) : The duration was output
+    */
+    template <LONGLONG to_unit>
+    bool Convert( Duration<to_unit> &to ) const
+    {
+        if( unit <= to_unit )
+        {
+            to = Duration<to_unit>( _count / ( to_unit / ( ( unit <= to_unit ) ? unit : 1 ) ) );
+            return true;
+        }
+
+        LONGLONG count = 0;
+        if( !CheckedMultiply( _count, unit / to_unit, count ) )
+            return false;
+
+        to = Duration<to_unit>( count );
+        return true;
+    }
+
+    template <LONGLONG to_unit>
+    void SaturatingConvert( Duration<to_unit> &to ) const
+    {
+        if( unit <= to_unit )
+            to = Duration<to_unit>( _count / ( to_unit / ( ( unit <= to_unit ) ? unit : 1 ) ) );
+        else
+            to = Duration<to_unit>( jay::time::SaturatingMultiply( _count, unit / to_unit ) );
+    }
+
+
+    bool operator==( const Duration &other ) const { return _count == other._count; }
+    bool operator!=( const Duration &other ) const { return _count != other._count; }
+    bool operator<( const Duration &other ) const { return _count < other._count; }
+    bool operator<=( const Duration &other ) const { return _count <= other._count; }
+    bool operator>( const Duration &other ) const { return _count > other._count; }
+    bool operator>=( const Duration &other ) const { return _count >= other._count; }
+
+private:
+    LONGLONG _count;
+};
+
+typedef Duration<1> Ticks;
+typedef Duration<10> Microseconds;
+typedef Duration<10 * 1000> Milliseconds;
+typedef Duration<10 * 1000 * 1000> Seconds;
+typedef Duration<(LONGLONG)10 * 1000 * 1000 * 60> Minutes;
+typedef Duration<(LONGLONG)10 * 1000 * 1000 * 60 * 60> Hours;
+typedef Duration<(LONGLONG)10 * 1000 * 1000 * 60 * 60 * 24> Days;
+
+
+
+/* class FileTime
+- A point in time as its number of 100ns intervals since January 1, 1601 (ticks), UTC or local.
+
+The default is January 1, 1601. A FileTime made from an invalid FILETIME is invalid, and checked
+arithmetic on an invalid FileTime fails.
+*/
+class FileTime
+{
+public:
+    FileTime() : _ticks( 0 ) {}
+    explicit FileTime( const FILETIME &ft ) : _ticks( FileTimeToTicks( ft ) ) {}
+
+    static FileTime FromTicks( const ULONGLONG ticks )
+    {
+        FileTime result;
+        result._ticks = ticks;
+        return result;
+    }
+
+    ULONGLONG GetTicks() const { return _ticks; }
+
+    FILETIME GetFileTime() const
+    {
+        FILETIME ft;
+        TicksToFileTime( _ticks, ft );
+        return ft;
+    }
+
+    bool IsValid() const { return _ticks <= JAY_TIME_MAX_FILETIME_TICKS; }
+
+
+    /* FileTime::Add()
+    * FileTime::Subtract()
+    - Offset the time by a duration.
+
+    [in] 'duration' : The duration to add or subtract, in any unit
+    [ret][failure] (false) : The time is invalid or the result would be. It's not modified.
+    [ret][success] (true) : The time was offset and is valid
+    */
+    template <LONGLONG unit>
+    bool Add( const Duration<unit> &duration )
+    {
+        Ticks ticks;
+        return duration.Convert( ticks ) && Offset( ticks.GetCount(), false );
+    }
+
+    template <LONGLONG unit>
+    bool Subtract( const Duration<unit> &duration )
+    {
+        Ticks ticks;
+        return duration.Convert( ticks ) && Offset( ticks.GetCount(), true );
+    }
+
+
+    /* FileTime::SaturatingAdd()
+    * FileTime::SaturatingSubtract()
+    - Offset the time by a duration, clamping the result to the range of a valid FileTime.
+
+    An invalid time is treated as the max valid time.
+
+    [in] 'duration' : The duration to add or subtract, in any unit
+    */
+    template <LONGLONG unit>
+    void SaturatingAdd( const Duration<unit> &duration )
+    {
+        Ticks ticks;
+        duration.SaturatingConvert( ticks );
+        SaturatingOffset( ticks.GetCount(), false );
+    }
+
+    template <LONGLONG unit>
+    void SaturatingSubtract( const Duration<unit> &duration )
+    {
+        Ticks ticks;
+        duration.SaturatingConvert( ticks );
+        SaturatingOffset( ticks.GetCount(), true );
+    }
+
+
+    /* FileTime::Difference()
+    - Get the duration from another time to this time.
+
+    The difference of two valid times can't overflow.
+
+    [in] 'other' : The other time
+    [out] 'difference' : This time minus 'other'
+    [ret][failure] (false) : Either time is invalid
+    [ret][success] (true) : The difference was output
+    */
+    bool Difference( const FileTime &other, Ticks &difference ) const
+    {
+        if( !IsValid() || !other.IsValid() )
+            return false;
+
+        difference = Ticks( (LONGLONG)_ticks - (LONGLONG)other._ticks );
+        return true;
+    }
+
+
+    bool operator==( const FileTime &other ) const { return _ticks == other._ticks; }
+    bool operator!=( const FileTime &other ) const { return _ticks != other._ticks; }
+    bool operator<( const FileTime &other ) const { return _ticks < other._ticks; }
+    bool operator<=( const FileTime &other ) const { return _ticks <= other._ticks; }
+    bool operator>( const FileTime &other ) const { return _ticks > other._ticks; }
+    bool operator>=( const FileTime &other ) const { return _ticks >= other._ticks; }
+
+private:
+    // Add or subtract ticks. A valid time is less than 2^63 so it's signed arithmetic.
+    bool Offset( const LONGLONG ticks, const bool subtract )
+    {
+        LONGLONG result = 0;
+
+        if( !IsValid()
+            || !( subtract
+                ? CheckedSubtract( (LONGLONG)_ticks, ticks, result )
+                : CheckedAdd( (LONGLONG)_ticks, ticks, result ) )
+            || ( result < 0 ) || ( (ULONGLONG)result > JAY_TIME_MAX_FILETIME_TICKS )
+        )
+            return false;
+
+        _ticks = (ULONGLONG)result;
+        return true;
+    }
+
+    void SaturatingOffset( const LONGLONG ticks, const bool subtract )
+    {
+        const LONGLONG current =
+            (LONGLONG)( IsValid() ? _ticks : JAY_TIME_MAX_FILETIME_TICKS );
+
+        const LONGLONG result = subtract
+            ? jay::time::SaturatingSubtract( current, ticks )
+            : jay::time::SaturatingAdd( current, ticks );
+
+        _ticks = ( result < 0 ) ? 0
+            : ( ( (ULONGLONG)result > JAY_TIME_MAX_FILETIME_TICKS )
+                ? JAY_TIME_MAX_FILETIME_TICKS : (ULONGLONG)result );
+    }
+
+    ULONGLONG _ticks;
+};
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_FILETIME_HPP
@@ -0,0 +1,478 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+A std::chrono clock for FILETIME, and conversions from chrono time points, timespec and Unix time in
+nanoseconds. This header requires C++11. The rest of the library doesn't.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+filetime_clock is a chrono clock whose time points are FILETIMEs: its duration is 100ns intervals
+(ticks) and its epoch is January 1, 1601 UTC. Like FILETIME it doesn't count leap seconds, so it
+differs from std::chrono::system_clock only by the constant number of seconds between 1601 and 1970,
+and converting between them is one addition:
+
+    std::chrono::system_clock::time_point now = filetime_clock::to_sys( filetime_clock::now() );
+
+std::chrono::system_clock's epoch is taken to be January 1, 1970 UTC, which C++20 requires and every
+implementation already used.
+
+ToFileTime() converts a filetime_clock or system_clock time point of any duration, a timespec, or a
+UnixNanoseconds count to a FILETIME. A duration finer than 100ns is rounded down to the tick before.
+
+The overloads of GetTimeInfo() and UTCTimeToLocalTime() in this header take any of those times and
+pass the FILETIME to the library, so no SYSTEMTIME is made to call them:
+
+    ISO8601 iso8601;
+    TimeInfo ti;
+    GetTimeInfo( iso8601, ti, std::chrono::system_clock::now() );
+
+    LocalTimeCursor cursor( *Timezone::Find( L"Eastern Standard Time" ) );
+    filetime_clock::time_point local;
+    UTCTimeToLocalTime( UnixNanoseconds( event.ns ), local, cursor );
+
+UTCTimeToLocalTime() converts with a LocalTimeCursor (refer to local_time_cursor.hpp), which works
+in ticks, so the local time is a filetime_clock time point. Like a local FILETIME it's the local
+time's fields counted from 1601, not a UTC time.
+*/
+
+#ifndef _JAY_TIME_FILETIME_CLOCK_HPP
+#define _JAY_TIME_FILETIME_CLOCK_HPP
+
+#if !( __cplusplus >= 201103L ) && !( defined( _MSC_VER ) && ( _MSC_VER >= 1900 ) )
+#error filetime_clock.hpp requires C++11
+#endif
+
+#include "filetime.hpp"
+#include "iso8601.hpp"
+#include "local_time_cursor.hpp"
+#include "timezone.hpp"
+
+#include <time.h>
+#include <windows.h>
+
+#include <chrono>
+#include <ratio>
+#include <type_traits>
+
+
+
+namespace jay {
+namespace time {
+
+// The number of ticks from January 1, 1601 to January 1, 1970
+#define JAY_TIME_UNIX_EPOCH_TICKS ( (LONGLONG)116444736 * 1000 * 1000 * 1000 )
+
+
+// Convert a chrono duration to a coarser one, rounding toward negative infinity
+template <class To, class Rep, class Period>
+inline To FloorDuration( const std::chrono::duration<Rep, Period> &d )
+{
+    const To result = std::chrono::duration_cast<To>( d );
+    return ( result > d ) ? ( result - To( 1 ) ) : result;
+}
+
+
+/* struct filetime_clock
+- A std::chrono clock of FILETIMEs: 100ns intervals since January 1, 1601 UTC.
+
+The names are lowercase because it's a chrono clock, like std::chrono::system_clock.
+*/
+struct filetime_clock
+{
+    typedef LONGLONG rep;
+    typedef std::ratio<1, 10 * 1000 * 1000> period;
+    typedef std::chrono::duration<rep, period> duration;
+    typedef std::chrono::time_point<filetime_clock> time_point;
+
+    static const bool is_steady = false;
+
+    // The current UTC time, from ::GetSystemTimeAsFileTime()
+    static time_point now()
+    {
+        FILETIME ft;
+        GetSystemTimeAsFileTime( &ft );
+        return from_filetime( ft );
+    }
+
+    // A FILETIME as a time point. The validity is not checked.
+    static time_point from_filetime( const FILETIME &ft )
+    {
+        return time_point( duration( (rep)FileTimeToTicks( ft ) ) );
+    }
+
+    /* The duration of the time point from_sys() returns. A duration finer than a tick is rounded
+    down to ticks: FILETIME has no finer resolution, and a count of nanoseconds since 1601 overflows
+    64 bits in 1893.
+    */
+    template <class Duration>
+    struct from_sys_duration
+    {
+        typedef typename std::conditional<
+            std::ratio_less<typename Duration::period, period>::value,
+            duration,
+            typename std::common_type<Duration, std::chrono::seconds>::type
+        >::type type;
+    };
+
+    /* filetime_clock::to_sys()
+    * filetime_clock::from_sys()
+    - Convert to or from std::chrono::system_clock.
+
+    The conversion is one addition of the seconds between the epochs. These are the functions that
+    std::chrono::clock_cast uses in C++20.
+    */
+    template <class Duration>
+    static std::chrono::time_point<
+        std::chrono::system_clock,
+        typename std::common_type<Duration, std::chrono::seconds>::type
+    > to_sys( const std::chrono::time_point<filetime_clock, Duration> &tp )
+    {
+        typedef typename std::common_type<Duration, std::chrono::seconds>::type result_duration;
+
+        return std::chrono::time_point<std::chrono::system_clock, result_duration>(
+            tp.time_since_epoch() - unix_epoch() );
+    }
+
+    template <class Duration>
+    static std::chrono::time_point<filetime_clock, typename from_sys_duration<Duration>::type>
+    from_sys( const std::chrono::time_point<std::chrono::system_clock, Duration> &tp )
+    {
+        typedef typename from_sys_duration<Duration>::type result_duration;
+
+        return std::chrono::time_point<filetime_clock, result_duration>(
+            FloorDuration<result_duration>( tp.time_since_epoch() ) + unix_epoch() );
+    }
+
+#if defined( __cpp_lib_chrono ) && ( __cpp_lib_chrono >= 201907L )
+    /* filetime_clock::to_utc()
+    * filetime_clock::from_utc()
+    - Convert to or from std::chrono::utc_clock (C++20).
+
+    FILETIME doesn't count leap seconds, so the conversion is through system_clock and a time in a
+    leap second is the same as the second before it.
+    */
+    template <class Duration>
+    static std::chrono::utc_time<typename std::common_type<Duration, std::chrono::seconds>::type>
+    to_utc( const std::chrono::time_point<filetime_clock, Duration> &tp )
+    {
+        return std::chrono::utc_clock::from_sys( to_sys( tp ) );
+    }
+
+    template <class Duration>
+    static std::chrono::time_point<filetime_clock, typename from_sys_duration<Duration>::type>
+    from_utc( const std::chrono::utc_time<Duration> &tp )
+    {
+        return from_sys( std::chrono::utc_clock::to_sys( tp ) );
+    }
+#endif
+
+    // The seconds from the epoch of filetime_clock to the epoch of system_clock
+    static std::chrono::seconds unix_epoch()
+    {
+        return std::chrono::seconds( JAY_TIME_UNIX_EPOCH_TICKS / ( 10 * 1000 * 1000 ) );
+    }
+};
+
+
+/* struct UnixNanoseconds
+- A UTC time as the number of nanoseconds since January 1, 1970, not counting leap seconds.
+
+This is a distinct type so that ToFileTime() can tell it from other integers.
+*/
+struct UnixNanoseconds
+{
+    explicit UnixNanoseconds( const LONGLONG count ) : count( count ) {}
+
+    LONGLONG count;
+};
+
+
+/* DurationToTicks()
+- Convert a chrono duration with an integer count to ticks, rounding down.
+
+The ratio of the duration's period to a tick is a constant, so this is one multiplication or one
+division.
+
+[in] 'd' : The duration
+[out] 'ticks' : The number of ticks in 'd', rounded toward negative infinity
+[ret][failure] (false) : The number of ticks would overflow
+[ret][success] (true) : The ticks were output
+*/
+template <class Rep, class Period>
+inline bool DurationToTicks( const std::chrono::duration<Rep, Period> &d, LONGLONG &ticks )
+{
+    static_assert( std::is_integral<Rep>::value, "The duration's count must be an integer." );
+
+    typedef std::ratio_divide<Period, filetime_clock::period> ratio;
+
+    LONGLONG count = 0;
+    if( !CheckedMultiply( (LONGLONG)d.count(), (LONGLONG)ratio::num, count ) )
+        return false;
+
+    ticks = ( count / ratio::den ) - ( ( count % ratio::den ) < 0 );
+    return true;
+}
+
+
+// Output ticks as a FILETIME if they're in its valid range. Otherwise set ERROR_INVALID_TIME.
+inline bool TicksToValidFileTime( const LONGLONG ticks, FILETIME &ft )
+{
+    if( ( ticks < 0 ) || ( (ULONGLONG)ticks > JAY_TIME_MAX_FILETIME_TICKS ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    TicksToFileTime( (ULONGLONG)ticks, ft );
+    return true;
+}
+
+
+/* ToFileTime()
+- Convert a UTC time to a FILETIME.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : The time is not in the range of a valid FILETIME, or 'ts' is not normalized.
+######
+
+[in] 'tp' / 'ts' / 'ns' : Some point in time, UTC only
+[out] 'ft' : The same point in time, rounded down to the tick
+[ret][failure] (false) : The time can't be a FILETIME. An error code was set.
+[ret][success] (true) : The FILETIME was output
+*/
+template <class Duration>
+inline bool ToFileTime( const std::chrono::time_point<filetime_clock, Duration> &tp, FILETIME &ft )
+{
+    LONGLONG ticks = 0;
+    if( !DurationToTicks( tp.time_since_epoch(), ticks ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    return TicksToValidFileTime( ticks, ft );
+}
+
+template <class Duration>
+inline bool ToFileTime(
+    const std::chrono::time_point<std::chrono::system_clock, Duration> &tp,
+    FILETIME &ft
+)
+{
+    LONGLONG ticks = 0;
+    if( !DurationToTicks( tp.time_since_epoch(), ticks )
+        || !CheckedAdd( ticks, JAY_TIME_UNIX_EPOCH_TICKS, ticks )
+    )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    return TicksToValidFileTime( ticks, ft );
+}
+
+inline bool ToFileTime( const timespec &ts, FILETIME &ft )
+{
+    LONGLONG ticks = 0;
+    if( ( ts.tv_nsec < 0 ) || ( ts.tv_nsec >= 1000 * 1000 * 1000 )
+        || !CheckedMultiply( (LONGLONG)ts.tv_sec, 10 * 1000 * 1000, ticks )
+        || !CheckedAdd( ticks, JAY_TIME_UNIX_EPOCH_TICKS + ts.tv_nsec / 100, ticks )
+    )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    return TicksToValidFileTime( ticks, ft );
+}
+
+inline bool ToFileTime( const UnixNanoseconds &ns, FILETIME &ft )
+{
+    return ToFileTime( std::chrono::time_point<std::chrono::system_clock,
+        std::chrono::nanoseconds>( std::chrono::nanoseconds( ns.count ) ), ft );
+}
+
+
+/* GetTimeInfo()
+- Overloads of ISO8601::GetTimeInfo() for the times that ToFileTime() converts.
+
+This is the same as 'iso8601.GetTimeInfo()' with the FILETIME of 'utc'. If 'utc' can't be a
+FILETIME then the output is cleared and false is returned.
+
+The batch overload converts each time in 'utc_times' to 'outputs'. Each time that could not be
+converted is cleared in 'outputs', and false is returned if any could not be.
+
+[in] 'iso8601' : The conversion options
+[out] 'output' / 'outputs' : A DayDateTime or TimeInfo for each time
+[in] 'utc' / 'utc_times' : Some point in time, UTC only
+[in] 'count' : The number of times in 'utc_times' and 'outputs'
+[in][opt] 'tz' : The zone of the local time
+[ret][failure] (false) : Conversion failed or, for batch, at least one conversion failed
+[ret][success] (true) : Conversion successful
+*/
+template <class Output, class Time>
+inline bool GetTimeInfo( const ISO8601 &iso8601, Output &output, const Time &utc )
+{
+    FILETIME utc_ft;
+    if( !ToFileTime( utc, utc_ft ) )
+    {
+        output.Clear();
+        return false;
+    }
+
+    return iso8601.GetTimeInfo( output, utc_ft );
+}
+
+template <class Output, class Time>
+inline bool GetTimeInfo(
+    const ISO8601 &iso8601,
+    Output &output,
+    const Time &utc,
+    const Timezone &tz
+)
+{
+    FILETIME utc_ft;
+    if( !ToFileTime( utc, utc_ft ) )
+    {
+        output.Clear();
+        return false;
+    }
+
+    return iso8601.GetTimeInfo( output, utc_ft, tz );
+}
+
+template <class Output, class Time>
+inline bool GetTimeInfo(
+    const ISO8601 &iso8601,
+    Output outputs[],
+    const Time utc_times[],
+    const size_t count
+)
+{
+    bool success = true;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( !GetTimeInfo( iso8601, outputs[ i ], utc_times[ i ] ) )
+            success = false;
+    }
+
+    return success;
+}
+
+
+/* UTCTimeToLocalTime()
+- Overloads of LocalTimeCursor::UTCTimeToLocalTime() for the times that ToFileTime() converts.
+
+This is the same as 'cursor.UTCTimeToLocalTime()' with the FILETIME of 'utc'. The local time is a
+filetime_clock time point (refer to the comment block at the top of this file).
+
+The batch overload converts all the times it can. Each time that could not be converted is the
+epoch in 'local_times'. The error code is that of the first time that could not be converted.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : A UTC time is not a valid FILETIME or its local time could not be determined.
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'utc' / 'utc_times' : UTC time
+[out] 'local' / 'local_times' : Local time
+[out][opt] 'tzi_id' : A valid TIME_ZONE_ID for 'local'
+[in] 'count' : The number of times in 'utc_times' and 'local_times'
+[in] 'cursor' : The zone of the local time
+[ret][failure] (false) : Conversion failed or, for batch, at least one conversion failed. An error
+code was set.
+[ret][success] (true) : Conversion successful
+*/
+template <class Time>
+inline bool UTCTimeToLocalTime(
+    const Time &utc,
+    filetime_clock::time_point &local,
+    DWORD &tzi_id,
+    LocalTimeCursor &cursor
+)
+{
+    FILETIME utc_ft, local_ft;
+    if( !ToFileTime( utc, utc_ft ) || !cursor.UTCTimeToLocalTime( utc_ft, local_ft, tzi_id ) )
+        return false;
+
+    local = filetime_clock::from_filetime( local_ft );
+    return true;
+}
+
+template <class Time>
+inline bool UTCTimeToLocalTime(
+    const Time &utc,
+    filetime_clock::time_point &local,
+    LocalTimeCursor &cursor
+)
+{
+    DWORD tzi_id = 0;
+    return UTCTimeToLocalTime( utc, local, tzi_id, cursor );
+}
+
+template <class Time>
+inline bool UTCTimeToLocalTime(
+    const Time utc_times[],
+    filetime_clock::time_point local_times[],
+    const size_t count,
+    LocalTimeCursor &cursor
+)
+{
+    if( count && ( !utc_times || !local_times ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( UTCTimeToLocalTime( utc_times[ i ], local_times[ i ], cursor ) )
+            continue;
+
+        if( !first_error )
+            first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+        local_times[ i ] = filetime_clock::time_point();
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_FILETIME_CLOCK_HPP
@@ -21,11 +21,11 @@ along with jay::time. If not, see <http://www.gnu.org/licenses/>.
 /** Example to show a file's times: creation, last accessed, last modified.
 
 Compiled using g++ (GCC) 4.7.2. No warnings.
-g++ -Wall -o GetFileTime filetimes_example.cpp iso8601.cpp time.cpp timezone.cpp
+g++ -Wall -o GetFileTime filetimes_example.cpp iso8601.cpp time.cpp timezone.cpp timezone_embedded.cpp
 
 Compiled using VS2010 cl 16.00.40219.01.
 One expected warning: C4512 assignment operator could not be generated.
-cl /W4 /EHsc /FeGetFileTime filetimes_example.cpp iso8601.cpp time.cpp timezone.cpp
+cl /W4 /EHsc /FeGetFileTime filetimes_example.cpp iso8601.cpp time.cpp timezone.cpp timezone_embedded.cpp
 */
 
 /* Sample of output when iso8601.format.usa_style = true;
@@ -41,6 +41,12 @@ using namespace std;
 
 
 namespace {
+
+// The number of objects decomposed at once by DecomposeTimes()
+const size_t block_size = 64;
+
+const LONGLONG ticks_per_minute = 10000LL * 1000 * 60;
+
 } // anonymous namespace
 
 
@@ -81,15 +87,46 @@ string ISO8601::GetDayStringUSA( const SYSTEMTIME &st ) const
 string ISO8601::GetDateString( const SYSTEMTIME &st ) const
 {
     stringstream ss_date;
+    const char *separator = ( format.basic_format ? "" : "-" );
 
     ss_date.fill( '0' );
 
-    if( st.wYear > 9999 )
-        ss_date << "+";
+    if( format.date_format == DATE_FORMAT_WEEK )
+    {
+        IsoWeekDate week_date;
+
+        if( !GetIsoWeekDate( st, week_date ) )
+            return "";
+
+        if( week_date.year > 9999 )
+            ss_date << "+";
+
+        ss_date << setw( 4 ) << week_date.year;
+        ss_date << separator << "W" << setw( 2 ) << week_date.week;
+        ss_date << separator << week_date.day;
+    }
+    else if( format.date_format == DATE_FORMAT_ORDINAL )
+    {
+        unsigned year, day_of_year;
+
+        if( !GetOrdinalDate( st, year, day_of_year ) )
+            return "";
+
+        if( year > 9999 )
+            ss_date << "+";
 
-    ss_date << setw( 4 ) << st.wYear;
-    ss_date << "-" << setw( 2 ) << st.wMonth;
-    ss_date << "-" << setw( 2 ) << st.wDay;
+        ss_date << setw( 4 ) << year;
+        ss_date << separator << setw( 3 ) << day_of_year;
+    }
+    else
+    {
+        if( st.wYear > 9999 )
+            ss_date << "+";
+
+        ss_date << setw( 4 ) << st.wYear;
+        ss_date << separator << setw( 2 ) << st.wMonth;
+        ss_date << separator << setw( 2 ) << st.wDay;
+    }
 
     return ss_date.str();
 }
@@ -109,11 +146,12 @@ string ISO8601::GetDateStringUSA( const SYSTEMTIME &st ) const
 string ISO8601::GetTimeString( const SYSTEMTIME &st ) const
 {
     stringstream ss_time;
+    const char *separator = ( format.basic_format ? "" : ":" );
 
     ss_time.fill( '0' );
     ss_time << setw( 2 ) << st.wHour;
-    ss_time << ":" << setw( 2 ) << st.wMinute;
-    ss_time << ":" << setw( 2 ) << st.wSecond;
+    ss_time << separator << setw( 2 ) << st.wMinute;
+    ss_time << separator << setw( 2 ) << st.wSecond;
 
     if( format.time_string_with_milliseconds )
         ss_time << "." << setw( 3 ) << st.wMilliseconds;
@@ -152,7 +190,7 @@ string ISO8601::GetUTCOffsetString( const long bias ) const
     ss_utc.fill( '0' );
     ss_utc << ( ( bias > 0 ) ? "-" : "+" );
     ss_utc << setw( 2 ) << ( abs( bias ) / 60 );
-    ss_utc << ":" << setw( 2 ) << ( abs( bias ) % 60 );
+    ss_utc << ( format.basic_format ? "" : ":" ) << setw( 2 ) << ( abs( bias ) % 60 );
 
     return ss_utc.str();
 }
@@ -181,20 +219,21 @@ string ISO8601::GetUTCTimestampString( const SYSTEMTIME &utc_st ) const
 {
     stringstream ss_timestamp;
 
-    string date = GetDateString( utc_st );
-    string time = GetTimeString( utc_st );
-
-    if( !date.size() || !time.size() )
-        return "";
-
-    ss_timestamp << date << "T" << time;
-
+    /* The timestamp is always the extended format calendar date and time, so it's not written by
+    GetDateString() and GetTimeString() which follow 'format.date_format' and 'format.basic_format'.
+    */
     ss_timestamp.fill( '0' );
 
-    // if time string wasn't already formatted with milliseconds
-    if( !format.time_string_with_milliseconds )
-        ss_timestamp << "." << setw( 3 ) << utc_st.wMilliseconds;
+    if( utc_st.wYear > 9999 )
+        ss_timestamp << "+";
 
+    ss_timestamp << setw( 4 ) << utc_st.wYear;
+    ss_timestamp << "-" << setw( 2 ) << utc_st.wMonth;
+    ss_timestamp << "-" << setw( 2 ) << utc_st.wDay;
+    ss_timestamp << "T" << setw( 2 ) << utc_st.wHour;
+    ss_timestamp << ":" << setw( 2 ) << utc_st.wMinute;
+    ss_timestamp << ":" << setw( 2 ) << utc_st.wSecond;
+    ss_timestamp << "." << setw( 3 ) << utc_st.wMilliseconds;
     ss_timestamp << "Z";
 
     return ss_timestamp.str();
@@ -239,12 +278,22 @@ bool ISO8601::GetTimeInfo( DayDateTime &ddt ) const
 
 
 bool ISO8601::GetTimeInfo( TimeInfo &ti, const FILETIME &utc_ft ) const
+{
+    return GetTimeInfoLocalAndUTC( ti, utc_ft, NULL );
+}
+
+
+bool ISO8601::GetTimeInfoLocalAndUTC(
+    TimeInfo &ti,
+    const FILETIME &utc_ft,
+    const Timezone *tz
+) const
 {
     ti.Clear();
 
     ti.InitializeLocalTimePref( prefer_local_time );
 
-    if( !GetTimeInfoLocalOrUTC( *ti._local, utc_ft, true )
+    if( !GetTimeInfoInZone( *ti._local, utc_ft, true, tz )
         || !GetTimeInfoLocalOrUTC( *ti._utc, utc_ft, false )
     )
     {
@@ -289,6 +338,47 @@ bool ISO8601::GetTimeInfo( TimeInfo &ti ) const
 
 
 
+bool ISO8601::GetTimeInfo( DayDateTime &ddt, const FILETIME &utc_ft, const Timezone &tz ) const
+{
+    return GetTimeInfoInZone( ddt, utc_ft, prefer_local_time, &tz );
+}
+
+
+bool ISO8601::GetTimeInfo( DayDateTime &ddt, const SYSTEMTIME &utc_st, const Timezone &tz ) const
+{
+    FILETIME utc_ft = {};
+
+    if( !SystemTimeToFileTime( &utc_st, &utc_ft ) )
+    {
+        ddt.Clear();
+        return false;
+    }
+
+    return GetTimeInfo( ddt, utc_ft, tz );
+}
+
+
+bool ISO8601::GetTimeInfo( TimeInfo &ti, const FILETIME &utc_ft, const Timezone &tz ) const
+{
+    return GetTimeInfoLocalAndUTC( ti, utc_ft, &tz );
+}
+
+
+bool ISO8601::GetTimeInfo( TimeInfo &ti, const SYSTEMTIME &utc_st, const Timezone &tz ) const
+{
+    FILETIME utc_ft = {};
+
+    if( !SystemTimeToFileTime( &utc_st, &utc_ft ) )
+    {
+        ti.Clear();
+        return false;
+    }
+
+    return GetTimeInfo( ti, utc_ft, tz );
+}
+
+
+
 bool ISO8601::GetStrings( DayDateTime &ddt ) const
 {
     ddt.day = GetDayString( ddt.st );
@@ -320,28 +410,85 @@ bool ISO8601::GetTimeInfoLocalOrUTC(
 {
     ddt.Clear();
 
-    if( !IsFileTimeValid( utc_ft ) )
+    SYSTEMTIME utc_st = {};
+
+    if( !IsFileTimeValid( utc_ft ) || !FileTimeToSystemTime( &utc_ft, &utc_st ) )
     {
         ddt.Clear();
         return false;
     }
 
+    return GetTimeInfoFromUTC( ddt, utc_ft, utc_st, convert_to_local_time, NULL );
+}
+
+
+bool ISO8601::GetTimeInfoInZone(
+    DayDateTime &ddt,
+    const FILETIME &utc_ft,
+    const bool convert_to_local_time,
+    const Timezone *tz
+) const
+{
+    // the current timezone is converted by the virtual function so that an override applies
+    if( !tz )
+        return GetTimeInfoLocalOrUTC( ddt, utc_ft, convert_to_local_time );
+
+    ddt.Clear();
+
+    SYSTEMTIME utc_st = {};
+
+    if( !IsFileTimeValid( utc_ft ) || !FileTimeToSystemTime( &utc_ft, &utc_st ) )
+    {
+        ddt.Clear();
+        return false;
+    }
+
+    return GetTimeInfoFromUTC( ddt, utc_ft, utc_st, convert_to_local_time, tz );
+}
+
+
+bool ISO8601::GetTimeInfoFromUTC(
+    DayDateTime &ddt,
+    const FILETIME &utc_ft,
+    const SYSTEMTIME &utc_st,
+    const bool convert_to_local_time,
+    const Timezone *tz
+) const
+{
+    ddt.Clear();
+
     bool is_daylight_saving_time = false;
 
     if( convert_to_local_time )
     {
-        SYSTEMTIME utc_st = {};
         DWORD tzi_id = 0;
         TIME_ZONE_INFORMATION tzi = {};
 
-        if( !FileTimeToSystemTime( &utc_ft, &utc_st )
-            || !UTCTimeToLocalTime( utc_st, ddt.st, tzi_id, tzi )
+        if( !( tz ? UTCTimeToLocalTime( utc_st, ddt.st, tzi_id, tzi, *tz )
+                : UTCTimeToLocalTime( utc_st, ddt.st, tzi_id, tzi ) )
         )
         {
             ddt.Clear();
             return false;
         }
 
+        /* The local time is in DST but DST is not applied for it, so standard time is used instead.
+        Refer to the comment block for ISO8601::ignore_dst. This is checked after the conversion so
+        it applies the same to whichever timezone information the conversion used.
+        */
+        if( ( tzi_id == TIME_ZONE_ID_DAYLIGHT )
+            && ( ignore_dst || ( ddt.st.wYear < dst_start_year ) )
+        )
+        {
+            tzi_id = TIME_ZONE_ID_STANDARD;
+
+            if( !SystemTimeAddMinutes( ddt.st, tzi.DaylightBias - tzi.StandardBias ) )
+            {
+                ddt.Clear();
+                return false;
+            }
+        }
+
         if( tzi_id == TIME_ZONE_ID_DAYLIGHT )
         {
             is_daylight_saving_time = true;
@@ -371,16 +518,60 @@ bool ISO8601::GetTimeInfoLocalOrUTC(
     else // Use UTC time, not local
     {
         ddt.ft = utc_ft;
+        ddt.st = utc_st;
+        ddt.bias = 0;
+    }
 
-        if( !FileTimeToSystemTime( &ddt.ft, &ddt.st ) )
-        {
-            ddt.Clear();
-            return false;
-        }
+    return GetTimeInfoFromLocal( ddt, is_daylight_saving_time );
+}
 
-        ddt.bias = 0;
+
+bool ISO8601::GetTimeInfoInPreparedZone(
+    DayDateTime &ddt,
+    const FILETIME &utc_ft,
+    const ValidSystemTime &utc_st,
+    const PreparedTimezone &zone
+) const
+{
+    const ULONGLONG utc_ticks = FileTimeToTicks( utc_ft );
+
+    // the timezone information of another year is needed
+    if( !zone.IsPrepared( utc_ticks ) )
+        return GetTimeInfoFromUTC( ddt, utc_ft, utc_st, true, zone.GetTimezone() );
+
+    ddt.Clear();
+
+    DWORD tzi_id = zone.GetTimezoneId( utc_ticks );
+
+    /* The same as GetTimeInfoFromUTC(): DST is not applied if it's ignored or before the start
+    year. The local time is in the zone's year since the zone is prepared for it.
+    */
+    if( ( tzi_id == TIME_ZONE_ID_DAYLIGHT )
+        && ( ignore_dst || ( zone.GetYear() < dst_start_year ) )
+    )
+    {
+        tzi_id = TIME_ZONE_ID_STANDARD;
     }
 
+    ddt.bias = zone.GetBias( tzi_id );
+
+    // the UTC fields are carried by the bias. the result is in the year so it's valid.
+    ValidSystemTime local = utc_st;
+    if( !SystemTimeSubtractMinutes( local, ddt.bias ) )
+    {
+        ddt.Clear();
+        return false;
+    }
+
+    ddt.st = local;
+    TicksToFileTime( utc_ticks - ( ddt.bias * ticks_per_minute ), ddt.ft );
+
+    return GetTimeInfoFromLocal( ddt, ( tzi_id == TIME_ZONE_ID_DAYLIGHT ) );
+}
+
+
+bool ISO8601::GetTimeInfoFromLocal( DayDateTime &ddt, const bool is_daylight_saving_time ) const
+{
     if( !SystemTimeToTm( ddt.st, is_daylight_saving_time, ddt.tm )
         || !( format.usa_style ? GetStringsUSA( ddt ) : GetStrings( ddt ) )
     )
@@ -395,5 +586,140 @@ bool ISO8601::GetTimeInfoLocalOrUTC(
     return ddt.valid;
 }
 
+
+
+bool ISO8601::GetTimeInfo(
+    DayDateTime ddts[],
+    std::string &timestamp,
+    const FILETIME &utc_ft,
+    const Timezone *const zones[],
+    const size_t count
+) const
+{
+    timestamp = "";
+
+    SYSTEMTIME utc_st = {};
+    bool success = IsFileTimeValid( utc_ft ) && FileTimeToSystemTime( &utc_ft, &utc_st );
+
+    if( success )
+    {
+        timestamp = GetUTCTimestampString( utc_st );
+        success = !timestamp.empty();
+    }
+
+    // the UTC time is decomposed once above and each zone only converts it
+    for( size_t i = 0; success && ( i < count ); ++i )
+    {
+        success = zones[ i ] ? GetTimeInfoFromUTC( ddts[ i ], utc_ft, utc_st, true, zones[ i ] )
+            : GetTimeInfoLocalOrUTC( ddts[ i ], utc_ft, true );
+    }
+
+    if( !success )
+    {
+        timestamp = "";
+
+        for( size_t i = 0; i < count; ++i )
+            ddts[ i ].Clear();
+    }
+
+    return success;
+}
+
+
+bool ISO8601::GetTimeInfo(
+    DayDateTime ddts[],
+    std::string &timestamp,
+    const FILETIME &utc_ft,
+    const PreparedTimezone zones[],
+    const size_t count
+) const
+{
+    timestamp = "";
+
+    SYSTEMTIME utc_st = {};
+    ValidSystemTime valid_utc_st;
+    bool success = IsFileTimeValid( utc_ft ) && FileTimeToSystemTime( &utc_ft, &utc_st )
+        && ValidSystemTime::Create( utc_st, valid_utc_st );
+
+    if( success )
+    {
+        timestamp = GetUTCTimestampString( utc_st );
+        success = !timestamp.empty();
+    }
+
+    // the UTC time is decomposed once above and each zone only converts it
+    for( size_t i = 0; success && ( i < count ); ++i )
+        success = GetTimeInfoInPreparedZone( ddts[ i ], utc_ft, valid_utc_st, zones[ i ] );
+
+    if( !success )
+    {
+        timestamp = "";
+
+        for( size_t i = 0; i < count; ++i )
+            ddts[ i ].Clear();
+    }
+
+    return success;
+}
+
+
+
+bool DecomposeTimes( DayDateTime ddts[], const size_t count )
+{
+    ULONGLONG ticks[ block_size ];
+    WORD columns[ 9 ][ block_size ];
+    const TimeFieldColumns fields = { columns[ 0 ], columns[ 1 ], columns[ 2 ], columns[ 3 ],
+        columns[ 4 ], columns[ 5 ], columns[ 6 ], columns[ 7 ], columns[ 8 ] };
+
+    bool all = true;
+
+    for( size_t begin = 0; begin < count; begin += block_size )
+    {
+        const size_t size = min( block_size, count - begin );
+
+        for( size_t i = 0; i < size; ++i )
+            ticks[ i ] = FileTimeToTicks( ddts[ begin + i ].ft );
+
+        all &= TicksToTimeFields( ticks, size, fields );
+
+        for( size_t i = 0; i < size; ++i )
+        {
+            DayDateTime &ddt = ddts[ begin + i ];
+
+            ddt.st.wYear = columns[ 0 ][ i ];
+            ddt.st.wMonth = columns[ 1 ][ i ];
+            ddt.st.wDayOfWeek = columns[ 2 ][ i ];
+            ddt.st.wDay = columns[ 3 ][ i ];
+            ddt.st.wHour = columns[ 4 ][ i ];
+            ddt.st.wMinute = columns[ 5 ][ i ];
+            ddt.st.wSecond = columns[ 6 ][ i ];
+            ddt.st.wMilliseconds = columns[ 7 ][ i ];
+
+            // an invalid time is year 0
+            if( !ddt.st.wYear )
+            {
+                const int isdst = ddt.tm.tm_isdst;
+                ZeroMemory( &ddt.tm, sizeof( ddt.tm ) );
+                ddt.tm.tm_isdst = isdst;
+                continue;
+            }
+
+            ddt.tm.tm_sec = ddt.st.wSecond;
+            ddt.tm.tm_min = ddt.st.wMinute;
+            ddt.tm.tm_hour = ddt.st.wHour;
+            ddt.tm.tm_mday = ddt.st.wDay;
+            ddt.tm.tm_mon = ddt.st.wMonth - 1;
+            ddt.tm.tm_year = ddt.st.wYear - 1900;
+            ddt.tm.tm_wday = ddt.st.wDayOfWeek;
+            ddt.tm.tm_yday = columns[ 8 ][ i ];
+        }
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
+}
+
 } // namespace time
 } // namespace jay
@@ -110,6 +110,21 @@ class TimeFormat;
 class ISO8601;
 class DayDateTime;
 class TimeInfo;
+class Timezone; // timezone.hpp
+class PreparedTimezone; // timezone.hpp
+class ValidSystemTime; // time.hpp
+
+
+
+/* enum DateFormat
+- The form of the ISO 8601 'date' string (refer to GetIsoWeekDate() and GetOrdinalDate()).
+*/
+enum DateFormat
+{
+    DATE_FORMAT_CALENDAR, // 2013-08-11
+    DATE_FORMAT_WEEK, // 2013-W32-7
+    DATE_FORMAT_ORDINAL // 2013-223
+};
 
 
 
@@ -133,21 +148,38 @@ public:
     // [true] : 'time' string with milliseconds: 18:46:00.085
     bool time_string_with_milliseconds; // = false
 
+    // The form of the 'date' string if not USA style: calendar, week or ordinal date
+    // The UTC timestamp is always a calendar date.
+    DateFormat date_format; // = DATE_FORMAT_CALENDAR
+
+    /* [false] : 'date, time, offset' strings are ISO 8601 extended format: 2013-W32-7, 14:46:00,
+    -04:00
+    [true] : 'date, time, offset' strings are ISO 8601 basic format: 2013W327, 144600, -0400
+    USA style strings and the UTC timestamp are not affected.
+    */
+    bool basic_format; // = false
+
     void Clear()
     {
         usa_style = false;
         day_string_with_abbreviation = false;
         time_string_with_milliseconds = false;
+        date_format = DATE_FORMAT_CALENDAR;
+        basic_format = false;
     }
 
     explicit TimeFormat(
         bool usa_style = false,
         bool day_string_with_abbreviation = false,
-        bool time_string_with_milliseconds = false
+        bool time_string_with_milliseconds = false,
+        DateFormat date_format = DATE_FORMAT_CALENDAR,
+        bool basic_format = false
         ) :
         usa_style( usa_style ),
         day_string_with_abbreviation( day_string_with_abbreviation ),
-        time_string_with_milliseconds( time_string_with_milliseconds )
+        time_string_with_milliseconds( time_string_with_milliseconds ),
+        date_format( date_format ),
+        basic_format( basic_format )
     {}
 };
 
@@ -210,8 +242,10 @@ public:
     // [ret][success][failure] (std::string) : GetDayStringEnglish()
     virtual std::string GetDayStringUSA( const SYSTEMTIME &st ) const;
 
-    // [ret][failure] (std::string) : Empty string
-    // [ret][success] (std::string) : Date string: 2013-08-11
+    /* The form of the date is TimeFormat::date_format, in basic format if TimeFormat::basic_format.
+    [ret][failure] (std::string) : Empty string
+    [ret][success] (std::string) : Date string: 2013-08-11, 2013-W32-7 or 2013-223
+    */
     virtual std::string GetDateString( const SYSTEMTIME &st ) const;
 
     // [ret][failure] (std::string) : Empty string
@@ -219,7 +253,7 @@ public:
     virtual std::string GetDateStringUSA( const SYSTEMTIME &st ) const;
 
     // [ret][failure] (std::string) : Empty string
-    // [ret][success] (std::string) : Time string: 14:46:00
+    // [ret][success] (std::string) : Time string: 14:46:00, or 144600 in basic format
     virtual std::string GetTimeString( const SYSTEMTIME &st ) const;
 
     // [ret][failure] (std::string) : Empty string
@@ -228,7 +262,7 @@ public:
 
     // [in] 'bias' : The offset from the UTC timezone in minutes
     // [ret][failure] (std::string) : Empty string
-    // [ret][success] (std::string) : UTC offset string: -04:00
+    // [ret][success] (std::string) : UTC offset string: -04:00, or -0400 in basic format
     virtual std::string GetUTCOffsetString( const long bias ) const;
 
     // [in] 'bias' : The offset from the UTC timezone in minutes
@@ -250,8 +284,12 @@ public:
 
     If a FILETIME/SYSTEMTIME is not passed then the current time is used.
 
+    If a Timezone is passed then local time is the time in that zone instead of the current
+    timezone. Refer to the comment block above the Timezone class declaration in timezone.hpp.
+
     [out] 'ddt' / 'ti' : Local or UTC time
     [in][opt] 'utc_ft' / 'utc_st' : Some point in time, UTC only
+    [in][opt] 'tz' : The zone of the local time
     [ret][failure] (false) : Conversion failed. 'ddt' was cleared; see DayDateTime::Clear().
     [ret][success] (true) : Conversion successful
     */
@@ -261,6 +299,49 @@ public:
     bool GetTimeInfo( TimeInfo &ti, const FILETIME &utc_ft ) const;
     bool GetTimeInfo( TimeInfo &ti, const SYSTEMTIME &utc_st ) const;
     bool GetTimeInfo( TimeInfo &ti ) const;
+    bool GetTimeInfo( DayDateTime &ddt, const FILETIME &utc_ft, const Timezone &tz ) const;
+    bool GetTimeInfo( DayDateTime &ddt, const SYSTEMTIME &utc_st, const Timezone &tz ) const;
+    bool GetTimeInfo( TimeInfo &ti, const FILETIME &utc_ft, const Timezone &tz ) const;
+    bool GetTimeInfo( TimeInfo &ti, const SYSTEMTIME &utc_st, const Timezone &tz ) const;
+
+    /* ISO8601::GetTimeInfo()
+    - Convert input UTC time to the local time in each of several zones.
+
+    This is the same as calling GetTimeInfo() with each zone and 'prefer_local_time' true, except
+    the UTC time is validated, decomposed and written as a timestamp only once for all the zones.
+
+    Each Timezone is converted by UTCTimeToLocalTime(), which gets its timezone information for the
+    year. A NULL zone is converted by GetTimeInfoLocalOrUTC() so a derived class's override of it
+    applies.
+
+    Each PreparedTimezone already has its timezone information and transitions (refer to
+    PreparedTimezone in timezone.hpp), so its bias is one comparison and the local time is the UTC
+    fields minus the bias. A time the zone is not prepared for, eg in a different year, is converted
+    the same way as a Timezone. GetTimeInfoLocalOrUTC() is not called, even for the current
+    timezone, so a derived class's override of it does not apply.
+
+    [out] 'ddts' : An array of 'count' local times. 'ddts[ i ]' is the local time in 'zones[ i ]'.
+    [out] 'timestamp' : ISO 8601 timestamp in UTC with milliseconds: 2013-08-11T18:46:00.085Z
+    [in] 'utc_ft' : Some point in time, UTC only
+    [in] 'zones' : An array of 'count' zones. A NULL Timezone is the current timezone.
+    [in] 'count' : The number of zones
+    [ret][failure] (false) : Conversion failed. Every 'ddts' was cleared and 'timestamp' is empty.
+    [ret][success] (true) : Conversion successful
+    */
+    bool GetTimeInfo(
+        DayDateTime ddts[],
+        std::string &timestamp,
+        const FILETIME &utc_ft,
+        const Timezone *const zones[],
+        const size_t count
+    ) const;
+    bool GetTimeInfo(
+        DayDateTime ddts[],
+        std::string &timestamp,
+        const FILETIME &utc_ft,
+        const PreparedTimezone zones[],
+        const size_t count
+    ) const;
 
     explicit ISO8601(
         bool prefer_local_time = true,
@@ -309,6 +390,89 @@ protected:
         const FILETIME &utc_ft,
         const bool convert_to_local_time
     ) const;
+
+    /* ISO8601::GetTimeInfoInZone() const
+    - Convert input time to a DayDateTime object, with local time in a zone
+
+    This is the same as GetTimeInfoLocalOrUTC() except local time is in the zone 'tz'. If 'tz' is
+    NULL then GetTimeInfoLocalOrUTC() is called, so a derived class's override of it applies.
+
+    [out] 'ddt' : Local or UTC time
+    [in] 'utc_ft' : Some point in time, UTC only
+    [in] 'convert_to_local_time' : Convert UTC time to local time before converting to DayDateTime
+    [in] 'tz' : The zone of the local time, or NULL for the current timezone
+    [ret][failure] (false) : Conversion failed. 'ddt' was cleared; see DayDateTime::Clear().
+    [ret][success] (true) : Conversion successful
+    */
+    bool GetTimeInfoInZone(
+        DayDateTime &ddt,
+        const FILETIME &utc_ft,
+        const bool convert_to_local_time,
+        const Timezone *tz
+    ) const;
+
+    /* ISO8601::GetTimeInfoFromUTC() const
+    - Convert input time that was already decomposed to a DayDateTime object
+
+    This is the same as GetTimeInfoInZone() except the UTC time has already been validated and
+    converted to a SYSTEMTIME. It's shared by the functions that convert one time for several zones.
+
+    [out] 'ddt' : Local or UTC time
+    [in] 'utc_ft' : Some point in time, UTC only
+    [in] 'utc_st' : The same point in time as 'utc_ft'
+    [in] 'convert_to_local_time' : Convert UTC time to local time before converting to DayDateTime
+    [in] 'tz' : The zone of the local time, or NULL for the current timezone
+    [ret][failure] (false) : Conversion failed. 'ddt' was cleared; see DayDateTime::Clear().
+    [ret][success] (true) : Conversion successful
+    */
+    bool GetTimeInfoFromUTC(
+        DayDateTime &ddt,
+        const FILETIME &utc_ft,
+        const SYSTEMTIME &utc_st,
+        const bool convert_to_local_time,
+        const Timezone *tz
+    ) const;
+
+    /* ISO8601::GetTimeInfoInPreparedZone() const
+    - Convert input time that was already decomposed to a DayDateTime object, in a prepared zone
+
+    This is the same as GetTimeInfoFromUTC() with 'convert_to_local_time' true, except the bias is
+    from 'zone' if it's prepared for the time.
+
+    [out] 'ddt' : Local time
+    [in] 'utc_ft' : Some point in time, UTC only
+    [in] 'utc_st' : The same point in time as 'utc_ft'
+    [in] 'zone' : The zone of the local time
+    [ret][failure] (false) : Conversion failed. 'ddt' was cleared; see DayDateTime::Clear().
+    [ret][success] (true) : Conversion successful
+    */
+    bool GetTimeInfoInPreparedZone(
+        DayDateTime &ddt,
+        const FILETIME &utc_ft,
+        const ValidSystemTime &utc_st,
+        const PreparedTimezone &zone
+    ) const;
+
+    /* ISO8601::GetTimeInfoFromLocal() const
+    - Write the rest of a DayDateTime object from its local or UTC time
+
+    [in][out] 'ddt' : 'ddt.ft', 'ddt.st' and 'ddt.bias' are the time. The rest is written.
+    [in] 'is_daylight_saving_time' : Whether or not DST was applied to the time
+    [ret][failure] (false) : Some or all members haven't been written. 'ddt' was cleared.
+    [ret][success] (true) : All members have been written
+    */
+    bool GetTimeInfoFromLocal( DayDateTime &ddt, const bool is_daylight_saving_time ) const;
+
+    /* ISO8601::GetTimeInfoLocalAndUTC() const
+    - Convert input time to a TimeInfo object
+
+    [out] 'ti' : Local and UTC time
+    [in] 'utc_ft' : Some point in time, UTC only
+    [in] 'tz' : The zone of the local time, or NULL for the current timezone
+    [ret][failure] (false) : Conversion failed. 'ti' was cleared; see TimeInfo::Clear().
+    [ret][success] (true) : Conversion successful
+    */
+    bool GetTimeInfoLocalAndUTC( TimeInfo &ti, const FILETIME &utc_ft, const Timezone *tz ) const;
 };
 
 
@@ -552,6 +716,30 @@ private:
     DayDateTime _alternate_time_info;
 };
 
+
+
+/* DecomposeTimes()
+- Output the 'st' and 'tm' of each DayDateTime in an array from its 'ft'.
+
+For an array of objects whose 'ft' (and 'bias') were set by the caller, eg times read back from an
+export. The times are decomposed in blocks by TicksToTimeFields() in time.hpp, which also outputs
+'tm.tm_yday', instead of by FileTimeToSystemTime() and SystemTimeToTm() for each object.
+'tm.tm_isdst', 'valid' and the strings are not changed.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : The 'ft' of at least one object is invalid. Its 'st' and 'tm' were zeroed out,
+except 'tm.tm_isdst'.
+######
+
+[in][out] 'ddts' : The objects
+[in] 'count' : The number of objects
+[ret][failure] (false) : At least one time could not be decomposed. An error code was set.
+[ret][success] (true) : Every time was decomposed
+*/
+bool DecomposeTimes( DayDateTime ddts[], const size_t count );
+
 } // namespace time
 } // namespace jay
 #endif // _JAY_TIME_ISO8601_HPP
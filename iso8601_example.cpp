@@ -21,10 +21,10 @@ along with jay::time. If not, see <http://www.gnu.org/licenses/>.
 /** Examples that show how to use ISO8601::GetTimeInfo() to output DayDateTime/TimeInfo.
 
 Compiled using g++ (GCC) 4.7.2. No warnings.
-g++ -Wall -o iso8601_example iso8601_example.cpp iso8601.cpp timezone.cpp time.cpp
+g++ -Wall -o iso8601_example iso8601_example.cpp iso8601.cpp timezone.cpp timezone_embedded.cpp time.cpp
 
 Compiled using VS2010 cl 16.00.40219.01. Warning for TimeInfo no assignment operator.
-cl /W4 /EHsc iso8601_example.cpp iso8601.cpp timezone.cpp time.cpp
+cl /W4 /EHsc iso8601_example.cpp iso8601.cpp timezone.cpp timezone_embedded.cpp time.cpp
 
 Preprocessor defines:
 DEBUG_ST : Show SYSTEMTIME structs
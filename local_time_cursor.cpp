@@ -0,0 +1,296 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Convert a stream of UTC times to local time, fast when the stream is sorted or nearly sorted.
+
+Documentation is in local_time_cursor.hpp.
+*/
+
+#include "local_time_cursor.hpp"
+#include "timezone.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+const LONGLONG ticks_per_millisecond = 10000;
+const LONGLONG ticks_per_minute = ticks_per_millisecond * 1000 * 60;
+
+
+// The ticks of the first time after the maximum valid FILETIME
+LONGLONG GetEndOfTime()
+{
+    // this is the same time as max SYSTEMTIME
+    const FILETIME max = { 0xF06C58F0, 0x7FFF35F4 };
+
+    return (LONGLONG)jay::time::FileTimeToTicks( max ) + 1;
+}
+
+
+// The ticks of a SYSTEMTIME. False if it's invalid.
+bool SystemTimeToTicks( const SYSTEMTIME &st, LONGLONG &ticks )
+{
+    FILETIME ft;
+    if( !SystemTimeToFileTime( &st, &ft ) )
+        return false;
+
+    ticks = (LONGLONG)jay::time::FileTimeToTicks( ft );
+    return true;
+}
+
+
+// The ticks of January 1 of 'year' at midnight. After the maximum year it's the end of time.
+LONGLONG GetYearStart( const unsigned year )
+{
+    const SYSTEMTIME st = { (WORD)year, 1, 0, 1, 0, 0, 0, 0 };
+    LONGLONG ticks = 0;
+
+    if( !jay::time::IsYearValid( year ) || !SystemTimeToTicks( st, ticks ) )
+        return ( year < 1601 ) ? 0 : GetEndOfTime();
+
+    return ticks;
+}
+
+
+// Limit the window [begin, end) that contains 'ticks' by 'bound'
+void LimitWindow( LONGLONG &begin, LONGLONG &end, const LONGLONG ticks, const LONGLONG bound )
+{
+    if( bound <= ticks )
+    {
+        if( begin < bound )
+            begin = bound;
+    }
+    else
+    {
+        if( end > bound )
+            end = bound;
+    }
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+LocalTimeCursor::LocalTimeCursor() :
+    _current(),
+    _cache( _current )
+{
+    Reset();
+}
+
+
+LocalTimeCursor::LocalTimeCursor( const TimezoneProvider &provider ) :
+    _current(),
+    _cache( provider )
+{
+    Reset();
+}
+
+
+
+void LocalTimeCursor::Reset()
+{
+    const LocalTimeWindow empty = {};
+    _window = empty;
+    _previous = empty;
+    _cache.Clear();
+}
+
+
+
+bool LocalTimeCursor::CalculateWindow(
+    const ULONGLONG utc_ticks,
+    LocalTimeWindow &window
+) const
+{
+    FILETIME utc_ft;
+    TicksToFileTime( utc_ticks, utc_ft );
+
+    SYSTEMTIME utc_st = {}, local = {};
+    DWORD tzi_id = 0;
+    TIME_ZONE_INFORMATION tzi = {};
+    LONGLONG local_ticks = 0;
+
+    if( !IsFileTimeValid( utc_ft ) || !FileTimeToSystemTime( &utc_ft, &utc_st ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    if( !jay::time::UTCTimeToLocalTime( utc_st, local, tzi_id, tzi, _cache ) )
+        return false;
+
+    if( !SystemTimeToTicks( local, local_ticks ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    /* The SYSTEMTIMEs only have milliseconds, so the offset is from the UTC time truncated the
+    same way. Otherwise it's off by the sub-millisecond part of the time that created the window.
+    */
+    const LONGLONG ticks = (LONGLONG)utc_ticks;
+    const LONGLONG offset = local_ticks - ( ticks - ( ticks % ticks_per_millisecond ) );
+    LONGLONG begin = 0, end = GetEndOfTime();
+
+    /* The timezone information is for the local year, and the edge cases in UTCTimeToLocalTime()
+    are decided by the UTC year, so the window is within both.
+    */
+    LimitWindow( begin, end, ticks, GetYearStart( utc_st.wYear ) );
+    LimitWindow( begin, end, ticks, GetYearStart( utc_st.wYear + 1 ) );
+    LimitWindow( begin, end, ticks, GetYearStart( local.wYear ) - offset );
+    LimitWindow( begin, end, ticks, GetYearStart( local.wYear + 1 ) - offset );
+
+    /* The start of DST is a local standard time and the start of standard time is a local
+    daylight time. Refer to GetLocalTimeForTimezone().
+    */
+    SYSTEMTIME daylight_start = {}, standard_start = {};
+    LONGLONG daylight_start_ticks = 0, standard_start_ticks = 0;
+
+    if( TimezoneTimeToLocalTime( tzi.DaylightDate, local.wYear, daylight_start )
+        && TimezoneTimeToLocalTime( tzi.StandardDate, local.wYear, standard_start )
+        && SystemTimeToTicks( daylight_start, daylight_start_ticks )
+        && SystemTimeToTicks( standard_start, standard_start_ticks )
+    )
+    {
+        LimitWindow( begin, end, ticks,
+            daylight_start_ticks + ( ( tzi.Bias + tzi.StandardBias ) * ticks_per_minute ) );
+        LimitWindow( begin, end, ticks,
+            standard_start_ticks + ( ( tzi.Bias + tzi.DaylightBias ) * ticks_per_minute ) );
+    }
+
+    window.begin = (ULONGLONG)begin;
+    window.end = (ULONGLONG)end;
+    window.offset = offset;
+    window.tzi_id = tzi_id;
+    return true;
+}
+
+
+
+bool LocalTimeCursor::Seek( const ULONGLONG utc_ticks )
+{
+    if( IsTimeInWindow( _window, utc_ticks ) )
+        return true;
+
+    if( IsTimeInWindow( _previous, utc_ticks ) )
+    {
+        const LocalTimeWindow temp = _window;
+        _window = _previous;
+        _previous = temp;
+        return true;
+    }
+
+    LocalTimeWindow window;
+    if( !CalculateWindow( utc_ticks, window ) )
+        return false;
+
+    _previous = _window;
+    _window = window;
+    return true;
+}
+
+
+
+bool LocalTimeCursor::GetWindow( const ULONGLONG utc_ticks, LocalTimeWindow &window )
+{
+    if( !Seek( utc_ticks ) )
+        return false;
+
+    window = _window;
+    return true;
+}
+
+
+
+bool LocalTimeCursor::UTCTimeToLocalTime(
+    const FILETIME &utc_ft,
+    FILETIME &local_ft,
+    DWORD &tzi_id
+)
+{
+    const ULONGLONG utc_ticks = FileTimeToTicks( utc_ft );
+
+    if( !Seek( utc_ticks ) )
+        return false;
+
+    TicksToFileTime( utc_ticks + _window.offset, local_ft );
+    tzi_id = _window.tzi_id;
+    return true;
+}
+
+
+bool LocalTimeCursor::UTCTimeToLocalTime( const FILETIME &utc_ft, FILETIME &local_ft )
+{
+    DWORD tzi_id = 0;
+    return UTCTimeToLocalTime( utc_ft, local_ft, tzi_id );
+}
+
+
+bool LocalTimeCursor::UTCTimeToLocalTime(
+    const FILETIME utc_times[],
+    FILETIME local_times[],
+    const size_t count
+)
+{
+    if( count && ( !utc_times || !local_times ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const ULONGLONG utc_ticks = FileTimeToTicks( utc_times[ i ] );
+
+        if( IsTimeInWindow( _window, utc_ticks ) || Seek( utc_ticks ) )
+        {
+            TicksToFileTime( utc_ticks + _window.offset, local_times[ i ] );
+            continue;
+        }
+
+        if( !first_error )
+            first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+        ZeroMemory( &local_times[ i ], sizeof( local_times[ i ] ) );
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace time
+} // namespace jay
@@ -0,0 +1,173 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Convert a stream of UTC times to local time, fast when the stream is sorted or nearly sorted.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+UTCTimeToLocalTime() in timezone.hpp starts from scratch for each time: it gets the timezone
+information for the year, calculates the year's transitions and compares the time to them. The
+times in a log or a file scan are usually in order, and nearly all of them are between the same two
+transitions as the time before.
+
+A LocalTimeCursor remembers the window of UTC time in which the offset from UTC to local time is the
+same. The window ends at the previous and next transition (a change between standard and daylight
+time) and is also limited to one year, since the timezone information can change from year to year.
+A time in the window is converted with one comparison and one addition of the offset:
+
+    LocalTimeCursor cursor( *Timezone::Find( L"Eastern Standard Time" ) );
+    for( each utc_ft in the log )
+        cursor.UTCTimeToLocalTime( utc_ft, local_ft, tzi_id );
+
+When a time is outside the window the cursor calculates the window for that time the same way as
+UTCTimeToLocalTime(), and the local time is the same as UTCTimeToLocalTime() would output. The
+window before that is kept so that a stream that jumps back and forth across one transition, or
+briefly back into the previous window, doesn't recalculate each time. A time anywhere else is
+simply a recalculation; there is no requirement that the times be sorted.
+
+The timezone information for each year is cached by the cursor (CachedTimezoneProvider) so it's
+retrieved once per year no matter how many windows are calculated.
+
+A cursor is not safe to use from multiple threads at the same time. Use one cursor per stream.
+*/
+
+#ifndef _JAY_TIME_LOCAL_TIME_CURSOR_HPP
+#define _JAY_TIME_LOCAL_TIME_CURSOR_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+/* struct LocalTimeWindow
+- A range of UTC time in which the offset from UTC to local time is the same.
+
+The times are in ticks (refer to FileTimeToTicks()). A UTC time in [begin, end) is local time
+'utc + offset', and 'tzi_id' is its TIME_ZONE_ID, the same as UTCTimeToLocalTime() would output.
+*/
+struct LocalTimeWindow
+{
+    ULONGLONG begin;
+    ULONGLONG end;
+    LONGLONG offset;
+    DWORD tzi_id;
+};
+
+
+// Whether or not a UTC time in ticks is in the window. An empty window contains nothing.
+inline bool IsTimeInWindow( const LocalTimeWindow &window, const ULONGLONG utc_ticks )
+{
+    return ( utc_ticks - window.begin ) < ( window.end - window.begin );
+}
+
+
+
+/* class LocalTimeCursor
+- Converts UTC times to local time in a zone, remembering the window of the last conversion.
+*/
+class LocalTimeCursor
+{
+public:
+    /* LocalTimeCursor::UTCTimeToLocalTime()
+    - Convert a UTC time to local time.
+
+    The batch overload converts all the times it can. Each time that could not be converted is
+    zeroed out in 'local_times'.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_TIME : A UTC time is invalid or its local time could not be determined.
+
+    If a failure occurs getting the timezone information the error code may be different from the
+    above.
+    ######
+
+    [in] 'utc_ft' / 'utc_times' : UTC time
+    [out] 'local_ft' / 'local_times' : Local time
+    [out][opt] 'tzi_id' : A valid TIME_ZONE_ID for 'local_ft'
+    [in] 'count' : The number of times in 'utc_times' and 'local_times'
+    [ret][failure] (false) : Conversion failed or, for batch, at least one conversion failed. An
+    error code was set.
+    [ret][success] (true) : Conversion successful
+    */
+    bool UTCTimeToLocalTime( const FILETIME &utc_ft, FILETIME &local_ft, DWORD &tzi_id );
+    bool UTCTimeToLocalTime( const FILETIME &utc_ft, FILETIME &local_ft );
+    bool UTCTimeToLocalTime(
+        const FILETIME utc_times[],
+        FILETIME local_times[],
+        const size_t count
+    );
+
+    /* LocalTimeCursor::GetWindow()
+    - Get the window that contains a UTC time.
+
+    This moves the cursor to the window, the same as converting the time does.
+
+    [in] 'utc_ticks' : UTC time in ticks
+    [out] 'window' : The window that contains 'utc_ticks'
+    [ret][failure] (false) : The window could not be determined. An error code was set.
+    [ret][success] (true) : The window was output
+    */
+    bool GetWindow( const ULONGLONG utc_ticks, LocalTimeWindow &window );
+
+    // The zone's timezone information, cached by the cursor
+    const TimezoneProvider &GetProvider() const { return _cache; }
+
+    // Forget the windows and the cached timezone information. Call this if the zone's timezone
+    // information has changed.
+    void Reset();
+
+    // The current timezone. The default provider is called when a year is first needed.
+    LocalTimeCursor();
+
+    // The timezone information from 'provider', eg a Timezone handle. 'provider' must remain valid
+    // for the life of this object.
+    explicit LocalTimeCursor( const TimezoneProvider &provider );
+
+private:
+    // not copyable
+    LocalTimeCursor( const LocalTimeCursor & );
+    LocalTimeCursor &operator=( const LocalTimeCursor & );
+
+    // Move to the window that contains 'utc_ticks'
+    bool Seek( const ULONGLONG utc_ticks );
+
+    // Calculate the window that contains 'utc_ticks'
+    bool CalculateWindow( const ULONGLONG utc_ticks, LocalTimeWindow &window ) const;
+
+    const CurrentTimezoneProvider _current;
+    CachedTimezoneProvider _cache;
+
+    LocalTimeWindow _window;
+    LocalTimeWindow _previous;
+};
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_LOCAL_TIME_CURSOR_HPP
@@ -0,0 +1,319 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Generate the times from one local time to another at a fixed step.
+
+Documentation is in local_time_series.hpp.
+*/
+
+#include "local_time_series.hpp"
+#include "local_time_cursor.hpp"
+#include "filetime.hpp"
+#include "timezone.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+const ULONGLONG ticks_per_millisecond = 10000;
+const ULONGLONG ticks_per_day = ticks_per_millisecond * 1000 * 60 * 60 * 24;
+
+
+// The ticks of a valid SYSTEMTIME
+ULONGLONG SystemTimeToTicks( const SYSTEMTIME &st )
+{
+    const ULONGLONG ms = ( ( st.wHour * 60ULL + st.wMinute ) * 60 + st.wSecond ) * 1000
+        + st.wMilliseconds;
+
+    return jay::time::DateToDays( st.wDay, st.wMonth, st.wYear ) * ticks_per_day
+        + ms * ticks_per_millisecond;
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+LocalTimeSeries::LocalTimeSeries()
+    : _cursor(), _done( true ), _day( ~0ULL )
+{
+}
+
+LocalTimeSeries::LocalTimeSeries( const TimezoneProvider &provider )
+    : _cursor( provider ), _done( true ), _day( ~0ULL )
+{
+}
+
+
+bool LocalTimeSeries::Start(
+    const SYSTEMTIME &first,
+    const SYSTEMTIME &last,
+    const ULONGLONG step,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+)
+{
+    _done = true;
+
+    if( !step
+        || ( ( arithmetic != LOCAL_TIME_WALL_CLOCK ) && ( arithmetic != LOCAL_TIME_ELAPSED ) ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    if( !IsSystemTimeValid_IgnoreDayOfWeek( first )
+        || !IsSystemTimeValid_IgnoreDayOfWeek( last ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    if( arithmetic == LOCAL_TIME_ELAPSED )
+    {
+        SYSTEMTIME first_utc, last_utc;
+        DWORD tzi_id;
+
+        if( !LocalTimeToUTCTime( first, first_utc, tzi_id, nonexistent, ambiguous,
+                _cursor.GetProvider() )
+            || !LocalTimeToUTCTime( last, last_utc, tzi_id, nonexistent, ambiguous,
+                _cursor.GetProvider() ) )
+        {
+            return false;
+        }
+
+        _next = SystemTimeToTicks( first_utc );
+        _last = SystemTimeToTicks( last_utc );
+    }
+    else
+    {
+        _next = SystemTimeToTicks( first );
+        _last = SystemTimeToTicks( last );
+    }
+
+    _arithmetic = arithmetic;
+    _nonexistent = nonexistent;
+    _ambiguous = ambiguous;
+    _step = step;
+
+    // no window yet. the first time is resolved and its window is entered.
+    const LocalTimeWindow empty = { 0, 0, 0, TIME_ZONE_ID_UNKNOWN };
+    _window = empty;
+    _local_begin = _local_end = 0;
+
+    _done = ( _next > _last );
+    return true;
+}
+
+
+void LocalTimeSeries::GetLocalTime( const ULONGLONG local_ticks, SYSTEMTIME &local_time )
+{
+    const ULONGLONG day = local_ticks / ticks_per_day;
+
+    // the date is only calculated when the day changes
+    if( day != _day )
+    {
+        unsigned year, month, mday;
+        DaysToDate( day, year, month, mday );
+
+        _date.wYear = (WORD)year;
+        _date.wMonth = (WORD)month;
+        _date.wDay = (WORD)mday;
+        // January 1, 1601 is a Monday
+        _date.wDayOfWeek = (WORD)( ( day + 1 ) % 7 );
+        _day = day;
+    }
+
+    ULONGLONG ms = ( local_ticks % ticks_per_day ) / ticks_per_millisecond;
+
+    local_time = _date;
+    local_time.wMilliseconds = (WORD)( ms % 1000 );
+    ms /= 1000;
+    local_time.wSecond = (WORD)( ms % 60 );
+    ms /= 60;
+    local_time.wMinute = (WORD)( ms % 60 );
+    local_time.wHour = (WORD)( ms / 60 );
+}
+
+
+bool LocalTimeSeries::EnterWindow( const ULONGLONG utc_ticks )
+{
+    LocalTimeWindow window, neighbor;
+
+    if( !_cursor.GetWindow( utc_ticks, window ) )
+        return false;
+
+    /* The local times of the window are [begin + offset, end + offset). If the clocks were set back
+    at 'begin' the first of them are also local times of the window before, and if they're set back
+    at 'end' the last of them are also local times of the window after. Those are ambiguous.
+    */
+    LONGLONG local_begin = (LONGLONG)window.begin + window.offset;
+    LONGLONG local_end = (LONGLONG)window.end + window.offset;
+
+    if( window.begin )
+    {
+        if( !_cursor.GetWindow( window.begin - 1, neighbor ) )
+            return false;
+
+        if( neighbor.offset > window.offset )
+            local_begin += neighbor.offset - window.offset;
+    }
+
+    if( window.end <= JAY_TIME_MAX_FILETIME_TICKS )
+    {
+        if( !_cursor.GetWindow( window.end, neighbor ) )
+            return false;
+
+        if( neighbor.offset < window.offset )
+            local_end -= window.offset - neighbor.offset;
+    }
+
+    _window = window;
+    _local_begin = local_begin;
+    _local_end = local_end;
+    return true;
+}
+
+
+bool LocalTimeSeries::NextElapsed( LocalTimePoint &point )
+{
+    if( !IsTimeInWindow( _window, _next ) && !_cursor.GetWindow( _next, _window ) )
+        return false;
+
+    const LONGLONG local_ticks = (LONGLONG)_next + _window.offset;
+
+    if( ( local_ticks < 0 ) || ( (ULONGLONG)local_ticks > JAY_TIME_MAX_FILETIME_TICKS ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    point.utc_ticks = _next;
+    GetLocalTime( (ULONGLONG)local_ticks, point.local_time );
+    point.tzi_id = _window.tzi_id;
+    return true;
+}
+
+
+bool LocalTimeSeries::NextWallClock( LocalTimePoint &point )
+{
+    const LONGLONG local_ticks = (LONGLONG)_next;
+
+    // neither nonexistent nor ambiguous, and in the window
+    if( ( _local_begin <= local_ticks ) && ( local_ticks < _local_end ) )
+    {
+        point.utc_ticks = (ULONGLONG)( local_ticks - _window.offset );
+        GetLocalTime( _next, point.local_time );
+        point.tzi_id = _window.tzi_id;
+        return true;
+    }
+
+    SYSTEMTIME local_time, utc_st;
+    DWORD tzi_id;
+
+    GetLocalTime( _next, local_time );
+
+    if( !LocalTimeToUTCTime( local_time, utc_st, tzi_id, _nonexistent, _ambiguous,
+            _cursor.GetProvider() ) )
+    {
+        return false;
+    }
+
+    const ULONGLONG utc_ticks = SystemTimeToTicks( utc_st );
+
+    if( !IsTimeInWindow( _window, utc_ticks ) && !EnterWindow( utc_ticks ) )
+        return false;
+
+    // the local time of the UTC time, which is different from the local time stepped to if that's
+    // nonexistent
+    point.utc_ticks = utc_ticks;
+    GetLocalTime( (ULONGLONG)( (LONGLONG)utc_ticks + _window.offset ), point.local_time );
+    point.tzi_id = _window.tzi_id;
+    return true;
+}
+
+
+bool LocalTimeSeries::Next( LocalTimePoint &point )
+{
+    for( ;; )
+    {
+        if( _done )
+        {
+            SetLastError( ERROR_NO_MORE_ITEMS );
+            return false;
+        }
+
+        const bool success = ( _arithmetic == LOCAL_TIME_ELAPSED ) ?
+            NextElapsed( point ) : NextWallClock( point );
+
+        // A wall clock time rejected by policy is skipped.
+        const bool skip = !success && ( _arithmetic == LOCAL_TIME_WALL_CLOCK )
+            && ( GetLastError() == ERROR_INVALID_TIME )
+            && ( ( _nonexistent == LOCAL_TIME_REJECT ) || ( _ambiguous == LOCAL_TIME_REJECT ) );
+
+        if( !success && !skip )
+        {
+            _done = true;
+            return false;
+        }
+
+        if( ( _last - _next ) < _step )
+            _done = true;
+        else
+            _next += _step;
+
+        if( success )
+            return true;
+    }
+}
+
+
+bool LocalTimeSeries::Next( LocalTimePoint points[], const size_t count, size_t &output_count )
+{
+    output_count = 0;
+
+    while( ( output_count < count ) && !_done )
+    {
+        if( !Next( points[ output_count ] ) )
+        {
+            // the last times of the series were skipped
+            if( GetLastError() == ERROR_NO_MORE_ITEMS )
+                break;
+
+            return false;
+        }
+
+        ++output_count;
+    }
+
+    return true;
+}
+
+} // namespace time
+} // namespace jay
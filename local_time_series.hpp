@@ -0,0 +1,215 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Generate the times from one local time to another at a fixed step, eg every 15 minutes.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+A report axis or the slots used to fill gaps in a time series are the times from A to B at a fixed
+step in local time. Stepping a SYSTEMTIME and converting each one with UTCTimeToLocalTime() or
+LocalTimeToUTCTime() gets the timezone information and calculates the transitions for every step.
+
+A LocalTimeSeries outputs each time as UTC ticks and its local fields. The step is one of two kinds
+(refer to LocalTimeArithmetic in timezone.hpp):
+
+LOCAL_TIME_ELAPSED : The UTC time is stepped, so the times are 'step' apart. The local time of each
+is the UTC time plus the offset of its window (refer to local_time_cursor.hpp), so the offset is
+only recalculated when a transition is crossed.
+
+LOCAL_TIME_WALL_CLOCK : The local time is stepped, so the times are on the same local clock
+positions every day, eg 00:00, 00:15, ... even on the days the clocks change. Each window has a
+range of local times that are neither nonexistent nor ambiguous. In that range the UTC time is the
+local time minus the offset. The range is calculated when the series enters a window, and a local
+time outside of any such range (in a gap or an overlap) is resolved by LocalTimeToUTCTime() with
+the policies.
+
+    LocalTimeSeries series( *Timezone::Find( L"Eastern Standard Time" ) );
+    // a step of 15 minutes in ticks
+    if( series.Start( first_local, last_local, 15 * 60 * 10000000ULL, LOCAL_TIME_WALL_CLOCK,
+            LOCAL_TIME_LATER, LOCAL_TIME_REJECT ) )
+    {
+        LocalTimePoint points[ 96 ];
+        size_t count = 0;
+        while( series.Next( points, 96, count ) && count )
+            ... // 'count' points
+    }
+
+The local fields are calculated from the local ticks (refer to DaysToDate() in time.hpp), and the
+date only when the day changes.
+
+A series is not safe to use from multiple threads at the same time.
+*/
+
+#ifndef _JAY_TIME_LOCAL_TIME_SERIES_HPP
+#define _JAY_TIME_LOCAL_TIME_SERIES_HPP
+
+#include "local_time_cursor.hpp"
+#include "timezone.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+/* struct LocalTimePoint
+- A time in a LocalTimeSeries.
+*/
+struct LocalTimePoint
+{
+    // UTC time in ticks (refer to FileTimeToTicks())
+    ULONGLONG utc_ticks;
+
+    // Local time
+    SYSTEMTIME local_time;
+
+    // A valid TIME_ZONE_ID for 'local_time'
+    DWORD tzi_id;
+};
+
+
+
+/* class LocalTimeSeries
+- The times from one local time to another at a fixed step, in a zone.
+*/
+class LocalTimeSeries
+{
+public:
+    /* LocalTimeSeries::Start()
+    - Start a series.
+
+    The series is 'first', then every 'step' after it up to and including 'last'. 'first' and
+    'last' are resolved by LocalTimeToUTCTime() for LOCAL_TIME_ELAPSED. For LOCAL_TIME_WALL_CLOCK
+    each local time in the series is resolved instead, and a local time rejected by
+    LOCAL_TIME_REJECT is skipped. With the other policies a resolved time may be the same UTC time
+    as, or before, the time before it.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_PARAMETER : 'step' is 0 or 'arithmetic' is invalid.
+    ERROR_INVALID_TIME : 'first' or 'last' is invalid, or is nonexistent or ambiguous and rejected
+    by policy.
+
+    If a failure occurs getting the timezone information the error code may be different from the
+    above.
+    ######
+
+    [in] 'first' : The first local time. wDayOfWeek is ignored.
+    [in] 'last' : The last local time. If it's before 'first' the series is empty.
+    [in] 'step' : The step in ticks
+    [in] 'arithmetic' : Whether the step is wall clock or elapsed time
+    [in] 'nonexistent' : How to resolve a local time that does not exist
+    [in] 'ambiguous' : How to resolve a local time that exists twice
+    [ret][failure] (false) : The series could not be started. An error code was set.
+    [ret][success] (true) : The series was started
+    */
+    bool Start(
+        const SYSTEMTIME &first,
+        const SYSTEMTIME &last,
+        const ULONGLONG step,
+        const LocalTimeArithmetic arithmetic,
+        const LocalTimePolicy nonexistent,
+        const LocalTimePolicy ambiguous
+    );
+
+    /* LocalTimeSeries::Next()
+    - Get the next time or times of the series.
+
+    The batch overload outputs up to 'count' times. Fewer than 'count' means the series has ended.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_NO_MORE_ITEMS : The series has ended, or was not started. Single time overload only.
+    ERROR_INVALID_TIME : A time could not be converted.
+
+    If a failure occurs getting the timezone information the error code may be different from the
+    above.
+    ######
+
+    [out] 'point' / 'points' : The next time or times
+    [in] 'count' : The number of times that 'points' can hold
+    [out] 'output_count' : The number of times output to 'points'. On failure it's the number output
+    before the failure, which are valid.
+    [ret][failure] (false) : The series has ended or a time could not be converted. An error code
+    was set. The series has ended if a time could not be converted.
+    [ret][success] (true) : The time or times were output
+    */
+    bool Next( LocalTimePoint &point );
+    bool Next( LocalTimePoint points[], const size_t count, size_t &output_count );
+
+    // Whether or not the series has ended. A series that was not started has ended.
+    bool IsDone() const { return _done; }
+
+    // The current timezone. The default provider is called when a year is first needed.
+    LocalTimeSeries();
+
+    // The timezone information from 'provider', eg a Timezone handle. 'provider' must remain valid
+    // for the life of this object.
+    explicit LocalTimeSeries( const TimezoneProvider &provider );
+
+private:
+    // not copyable
+    LocalTimeSeries( const LocalTimeSeries & );
+    LocalTimeSeries &operator=( const LocalTimeSeries & );
+
+    // Output the local fields of local ticks
+    void GetLocalTime( const ULONGLONG local_ticks, SYSTEMTIME &local_time );
+
+    // Enter the window of a UTC time and calculate its range of unambiguous local times
+    bool EnterWindow( const ULONGLONG utc_ticks );
+
+    bool NextElapsed( LocalTimePoint &point );
+    bool NextWallClock( LocalTimePoint &point );
+
+    LocalTimeCursor _cursor;
+
+    LocalTimeArithmetic _arithmetic;
+    LocalTimePolicy _nonexistent;
+    LocalTimePolicy _ambiguous;
+    ULONGLONG _step;
+
+    // The next time and the last time of the series. UTC ticks if elapsed, local ticks if wall
+    // clock.
+    ULONGLONG _next;
+    ULONGLONG _last;
+    bool _done;
+
+    // The window of the last time output
+    LocalTimeWindow _window;
+
+    // The local ticks [begin, end) of the window that are neither nonexistent nor ambiguous
+    LONGLONG _local_begin;
+    LONGLONG _local_end;
+
+    // The number of days since January 1, 1601 of the last local date output, and the date
+    ULONGLONG _day;
+    SYSTEMTIME _date;
+};
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_LOCAL_TIME_SERIES_HPP
@@ -0,0 +1,257 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Recurring local times such as "the 2nd Tuesday of every month at 02:30".
+
+Documentation is in recurrence.hpp.
+*/
+
+#include "recurrence.hpp"
+#include "timezone.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+// Whether or not 'a' is later than 'b'. Both must be valid.
+bool IsFileTimeLater( const FILETIME &a, const FILETIME &b )
+{
+    return ( a.dwHighDateTime > b.dwHighDateTime )
+        || ( ( a.dwHighDateTime == b.dwHighDateTime ) && ( a.dwLowDateTime > b.dwLowDateTime ) );
+}
+
+
+/* Get the next occurrences of a rule. 'provider' should cache because each occurrence gets the
+timezone information for its year.
+*/
+bool GetNextOccurrencesFromProvider(
+    const jay::time::RecurrenceRule &rule,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const jay::time::TimezoneProvider &provider
+)
+{
+    if( !jay::time::IsRecurrenceRuleValid( rule ) || ( count && !occurrences ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    SYSTEMTIME after_st = {}, after_local = {};
+    DWORD tzi_id = 0;
+    TIME_ZONE_INFORMATION tzi = {};
+
+    if( !jay::time::IsFileTimeValid( after_utc )
+        || !FileTimeToSystemTime( &after_utc, &after_st )
+        || !jay::time::UTCTimeToLocalTime( after_st, after_local, tzi_id, tzi, provider )
+    )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    /* Begin at the last month of the cycle that is on or before the local month. An occurrence in
+    an earlier month of the cycle is in an earlier local month, so it's before 'after_local' and,
+    unless a change back to standard time repeats local times across the beginning of the local
+    month, before 'after_utc'. It can be only minutes before though, so occurrences from here on
+    are not necessarily after 'after_utc' either. Those that aren't are skipped by the
+    IsFileTimeLater() check below.
+    */
+    const unsigned interval = rule.month_interval;
+    unsigned year = after_local.wYear;
+    int first_month = (int)after_local.wMonth
+        - (int)( ( after_local.wMonth + 12 - rule.tzt.wMonth ) % interval );
+
+    if( first_month < 1 )
+    {
+        first_month += 12;
+        --year;
+    }
+
+    unsigned month = (unsigned)first_month;
+
+    size_t i = 0;
+    while( i < count )
+    {
+        if( year > 30827 )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        SYSTEMTIME tzt = rule.tzt;
+        tzt.wMonth = (WORD)month;
+
+        SYSTEMTIME local = {}, utc = {};
+        if( !jay::time::TimezoneTimeToLocalTime( tzt, year, local ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        if( jay::time::LocalTimeToUTCTime( local, utc, tzi_id,
+                rule.nonexistent, rule.ambiguous, provider )
+            && SystemTimeToFileTime( &utc, &occurrences[ i ] )
+        )
+        {
+            if( IsFileTimeLater( occurrences[ i ], after_utc ) )
+                ++i;
+        }
+        // a time rejected by policy is skipped
+        else if( GetLastError() != ERROR_INVALID_TIME )
+            return false;
+
+        month += interval;
+        if( month > 12 )
+        {
+            month -= 12;
+            ++year;
+        }
+    }
+
+    return true;
+}
+
+
+/* Get the next occurrences of each rule. The row of a rule that fails is zeroed and the first
+error is kept.
+*/
+bool GetNextOccurrencesFromProvider(
+    const jay::time::RecurrenceRule rules[],
+    const size_t rule_count,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const jay::time::TimezoneProvider &provider
+)
+{
+    if( rule_count && ( !rules || ( count && !occurrences ) ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    DWORD first_error = 0;
+
+    for( size_t i = 0; i < rule_count; ++i )
+    {
+        FILETIME *row = occurrences + ( i * count );
+
+        if( !GetNextOccurrencesFromProvider( rules[ i ], after_utc, row, count, provider ) )
+        {
+            if( !first_error )
+                first_error = GetLastError() ? GetLastError() : ERROR_INVALID_TIME;
+
+            ZeroMemory( row, count * sizeof( *row ) );
+        }
+    }
+
+    if( first_error )
+    {
+        SetLastError( first_error );
+        return false;
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+bool IsRecurrenceRuleValid( const RecurrenceRule &rule )
+{
+    return IsRelativeTimezoneTimeValid( rule.tzt )
+        && rule.month_interval
+        && ( rule.month_interval <= 12 )
+        && !( 12 % rule.month_interval )
+        && ( rule.nonexistent >= LOCAL_TIME_EARLIER ) && ( rule.nonexistent <= LOCAL_TIME_SHIFT )
+        && ( rule.ambiguous >= LOCAL_TIME_EARLIER ) && ( rule.ambiguous <= LOCAL_TIME_SHIFT );
+}
+
+
+
+bool GetNextOccurrences(
+    const RecurrenceRule &rule,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count
+)
+{
+    const CurrentTimezoneProvider current;
+    const CachedTimezoneProvider cache( current );
+    return GetNextOccurrencesFromProvider( rule, after_utc, occurrences, count, cache );
+}
+
+
+bool GetNextOccurrences(
+    const RecurrenceRule &rule,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const TimezoneProvider &provider
+)
+{
+    const CachedTimezoneProvider cache( provider );
+    return GetNextOccurrencesFromProvider( rule, after_utc, occurrences, count, cache );
+}
+
+
+bool GetNextOccurrences(
+    const RecurrenceRule rules[],
+    const size_t rule_count,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count
+)
+{
+    const CurrentTimezoneProvider current;
+    const CachedTimezoneProvider cache( current );
+    return GetNextOccurrencesFromProvider( rules, rule_count, after_utc, occurrences, count,
+        cache );
+}
+
+
+bool GetNextOccurrences(
+    const RecurrenceRule rules[],
+    const size_t rule_count,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const TimezoneProvider &provider
+)
+{
+    const CachedTimezoneProvider cache( provider );
+    return GetNextOccurrencesFromProvider( rules, rule_count, after_utc, occurrences, count,
+        cache );
+}
+
+} // namespace time
+} // namespace jay
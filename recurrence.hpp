@@ -0,0 +1,152 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Recurring local times such as "the 2nd Tuesday of every month at 02:30".
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+A recurrence rule is a relative timezone time, the same format as the StandardDate and DaylightDate
+of TIME_ZONE_INFORMATION, that repeats every so many months:
+
+"2nd Tuesday of every month at 02:30"
+    { month 1, occurrence 2, Tuesday, 02:30 } every 1 month
+
+"last Friday of each quarter at 17:00"
+    { month 3, occurrence 5 (final), Friday, 17:00 } every 3 months
+
+The occurrences are local times in a zone. Each is converted to UTC by LocalTimeToUTCTime() so an
+occurrence in a DST gap or overlap is resolved by the rule's policies. An occurrence that the policy
+rejects is skipped. Refer to timezone.hpp.
+
+GetNextOccurrences() enumerates the next occurrences of one or more rules after a UTC time. Each
+occurrence is calculated directly from its month, so the work is proportional to the number of
+occurrences. The timezone information for each year is fetched once per call and shared by all the
+occurrences and rules in that call.
+*/
+
+#ifndef _JAY_TIME_RECURRENCE_HPP
+#define _JAY_TIME_RECURRENCE_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+/* struct RecurrenceRule
+- A local time that recurs every so many months.
+
+'tzt' is a relative timezone time (refer to IsRelativeTimezoneTimeValid()). Its month is the first
+month of the cycle. 'month_interval' must divide 12 evenly (1, 2, 3, 4, 6 or 12) so that the months
+of the cycle are the same every year.
+*/
+struct RecurrenceRule
+{
+    // The month, occurrence of the day of the week and time of day of an occurrence
+    SYSTEMTIME tzt;
+
+    // The number of months between occurrences: 1, 2, 3, 4, 6 or 12
+    unsigned month_interval;
+
+    // How to resolve an occurrence that is nonexistent or ambiguous in local time
+    LocalTimePolicy nonexistent;
+    LocalTimePolicy ambiguous;
+};
+
+
+/* IsRecurrenceRuleValid()
+- Check if a recurrence rule is valid.
+
+[in] 'rule' : The recurrence rule
+[ret][failure] (false) : 'rule' is invalid
+[ret][success] (true) : 'rule' is valid
+*/
+bool IsRecurrenceRuleValid( const RecurrenceRule &rule );
+
+
+/* GetNextOccurrences()
+- Get the next occurrences of recurrence rules after a point in time.
+
+The batch overload gets the next 'count' occurrences of each of 'rule_count' rules. The
+occurrences of 'rules[ i ]' are output to 'occurrences[ i * count ]' through
+'occurrences[ i * count + count - 1 ]'. If the occurrences of a rule could not be calculated then
+they are zeroed and the rest of the rules are still calculated.
+
+The occurrences of a rule are in ascending order and are all after 'after_utc'.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : A rule is invalid.
+ERROR_INVALID_TIME : 'after_utc' is invalid or there are not 'count' occurrences before the maximum
+year (30827).
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'rule' / 'rules' : The recurrence rule(s)
+[in] 'rule_count' : The number of rules in 'rules'
+[in] 'after_utc' : UTC time. The occurrences are after this time.
+[out] 'occurrences' : UTC times. 'count' for each rule.
+[in] 'count' : The number of occurrences to get for each rule
+[in][opt] 'provider' : The zone's timezone information, eg a Timezone handle. If not passed then
+the current timezone.
+[ret][failure] (false) : Failed or, for batch, at least one rule failed. An error code was set.
+[ret][success] (true) : The occurrences were output
+*/
+bool GetNextOccurrences(
+    const RecurrenceRule &rule,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count
+);
+bool GetNextOccurrences(
+    const RecurrenceRule &rule,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const TimezoneProvider &provider
+);
+bool GetNextOccurrences(
+    const RecurrenceRule rules[],
+    const size_t rule_count,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count
+);
+bool GetNextOccurrences(
+    const RecurrenceRule rules[],
+    const size_t rule_count,
+    const FILETIME &after_utc,
+    FILETIME occurrences[],
+    const size_t count,
+    const TimezoneProvider &provider
+);
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_RECURRENCE_HPP
@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Sort keys, hashes and sorting for arrays of SYSTEMTIME, FILETIME and DayDateTime.
+
+Documentation is in sort_key.hpp.
+*/
+
+#include "sort_key.hpp"
+#include "iso8601.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <string.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+// A DayDateTime's key and its index in the array
+struct KeyIndex
+{
+    ULONGLONG key;
+    size_t index;
+};
+
+inline ULONGLONG GetKey( const ULONGLONG &key )
+{
+    return key;
+}
+
+inline ULONGLONG GetKey( const KeyIndex &entry )
+{
+    return entry.key;
+}
+
+
+/* Sort 'entries' by their keys, a byte at a time from the least significant. The sort is stable.
+'scratch' is the same size as 'entries' and is overwritten.
+*/
+template <class Entry>
+void RadixSort( Entry *entries, Entry *scratch, const size_t count )
+{
+    if( count < 2 )
+        return;
+
+    // the number of keys with each value of each byte
+    size_t counts[ 8 ][ 256 ];
+    memset( counts, 0, sizeof( counts ) );
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const ULONGLONG key = GetKey( entries[ i ] );
+
+        for( unsigned byte = 0; byte < 8; ++byte )
+            ++counts[ byte ][ ( key >> ( byte * 8 ) ) & 0xFF ];
+    }
+
+    Entry *from = entries;
+    Entry *to = scratch;
+    const ULONGLONG first_key = GetKey( entries[ 0 ] );
+
+    for( unsigned byte = 0; byte < 8; ++byte )
+    {
+        const unsigned shift = byte * 8;
+
+        // the byte is the same in every key
+        if( counts[ byte ][ ( first_key >> shift ) & 0xFF ] == count )
+            continue;
+
+        size_t offsets[ 256 ];
+        size_t offset = 0;
+
+        for( unsigned value = 0; value < 256; ++value )
+        {
+            offsets[ value ] = offset;
+            offset += counts[ byte ][ value ];
+        }
+
+        for( size_t i = 0; i < count; ++i )
+            to[ offsets[ ( GetKey( from[ i ] ) >> shift ) & 0xFF ]++ ] = from[ i ];
+
+        swap( from, to );
+    }
+
+    if( from != entries )
+        copy( from, from + count, entries );
+}
+
+
+struct SystemTimeLess
+{
+    bool operator()( const SYSTEMTIME &a, const SYSTEMTIME &b ) const
+    {
+        return jay::time::CompareSystemTimes( a, b ) < 0;
+    }
+};
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+void SortKeyToSystemTime( const ULONGLONG key, SYSTEMTIME &st )
+{
+    st.wYear = (WORD)( key >> 39 );
+    st.wMonth = (WORD)( ( key >> 35 ) & 0xF );
+    st.wDay = (WORD)( ( key >> 30 ) & 0x1F );
+    st.wHour = (WORD)( ( key >> 25 ) & 0x1F );
+    st.wMinute = (WORD)( ( key >> 19 ) & 0x3F );
+    st.wSecond = (WORD)( ( key >> 13 ) & 0x3F );
+    st.wMilliseconds = (WORD)( ( key >> 3 ) & 0x3FF );
+    st.wDayOfWeek = (WORD)( key & 0x7 );
+}
+
+
+bool GetSortKeys( const SYSTEMTIME times[], ULONGLONG keys[], const size_t count )
+{
+    unsigned exact = 1;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        keys[ i ] = GetSortKey( times[ i ] );
+        exact &= (unsigned)IsSortKeyExact( times[ i ] );
+    }
+
+    return !!exact;
+}
+
+bool GetSortKeys( const FILETIME times[], ULONGLONG keys[], const size_t count )
+{
+    for( size_t i = 0; i < count; ++i )
+        keys[ i ] = FileTimeToTicks( times[ i ] );
+
+    return true;
+}
+
+
+void SortTimes( SYSTEMTIME times[], const size_t count )
+{
+    if( count < 2 )
+        return;
+
+    vector<ULONGLONG> keys( count ), scratch( count );
+
+    if( !GetSortKeys( times, &keys[ 0 ], count ) )
+    {
+        stable_sort( times, times + count, SystemTimeLess() );
+        return;
+    }
+
+    RadixSort( &keys[ 0 ], &scratch[ 0 ], count );
+
+    for( size_t i = 0; i < count; ++i )
+        SortKeyToSystemTime( keys[ i ], times[ i ] );
+}
+
+void SortTimes( FILETIME times[], const size_t count )
+{
+    if( count < 2 )
+        return;
+
+    vector<ULONGLONG> keys( count ), scratch( count );
+
+    GetSortKeys( times, &keys[ 0 ], count );
+    RadixSort( &keys[ 0 ], &scratch[ 0 ], count );
+
+    for( size_t i = 0; i < count; ++i )
+        TicksToFileTime( keys[ i ], times[ i ] );
+}
+
+void SortTimes( DayDateTime times[], const size_t count )
+{
+    if( count < 2 )
+        return;
+
+    vector<KeyIndex> entries( count ), scratch( count );
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        entries[ i ].key = GetSortKey( times[ i ] );
+        entries[ i ].index = i;
+    }
+
+    RadixSort( &entries[ 0 ], &scratch[ 0 ], count );
+
+    /* entries[ i ].index is the object that goes to 'i'. Each cycle of the permutation is followed
+    by swapping, and an entry that is done is marked by its index being its own position.
+    */
+    for( size_t i = 0; i < count; ++i )
+    {
+        size_t j = i;
+
+        while( entries[ j ].index != i )
+        {
+            const size_t k = entries[ j ].index;
+
+            swap( times[ j ], times[ k ] );
+            entries[ j ].index = j;
+            j = k;
+        }
+
+        entries[ j ].index = j;
+    }
+}
+
+} // namespace time
+} // namespace jay
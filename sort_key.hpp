@@ -0,0 +1,280 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Sort keys, hashes and sorting for arrays of SYSTEMTIME, FILETIME and DayDateTime.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+CompareSystemTimes() compares up to eight members one after the other, so sorting many SYSTEMTIMEs
+with it is mostly unpredictable branches. A sort key is a ULONGLONG in which the members are packed
+most significant first:
+
+    wYear (16 bits), wMonth (4), wDay (5), wHour (5), wMinute (6), wSecond (6), wMilliseconds (10),
+    wDayOfWeek (3)
+
+so comparing two keys is one comparison and the order of the keys is the order of
+CompareSystemTimes(). Every member of a SYSTEMTIME in range of its bits is in the key, which is true
+of every valid SYSTEMTIME (refer to IsSystemTimeValid()), so the key is also a copy of it. The sort
+key of a FILETIME is its ticks (refer to FileTimeToTicks()). The sort key of a DayDateTime is the
+ticks of its UTC time, 'ft' plus 'bias', so DayDateTimes at different offsets sort chronologically.
+
+SortTimes() sorts an array by least significant digit radix sort of the keys, a byte at a time.
+Each byte that is the same in every key is skipped, eg the year's most significant byte, so an
+array of times in the same year or month takes fewer passes. A SYSTEMTIME or FILETIME array is
+sorted as its keys, so the sort moves 8 bytes for each time. A DayDateTime array is sorted as its
+keys and indexes and then the objects are moved to their places.
+
+    vector<SYSTEMTIME> times = ...;
+    SortTimes( &times[ 0 ], times.size() );
+
+If the compiler supports C++11 (JAY_TIME_HAS_STD_HASH) there are std::hash specializations for
+SYSTEMTIME, FILETIME and DayDateTime. The Windows types don't have an operator==, so an unordered
+container also needs the equality that goes with the hash:
+
+    unordered_set<SYSTEMTIME, hash<SYSTEMTIME>, SystemTimeEqualTo> seen;
+*/
+
+#ifndef _JAY_TIME_SORT_KEY_HPP
+#define _JAY_TIME_SORT_KEY_HPP
+
+#include "time.hpp"
+#include "iso8601.hpp"
+
+#include <windows.h>
+
+#include <cstddef>
+
+
+
+/* JAY_TIME_HAS_STD_HASH is defined if the compiler has std::hash, which is C++11 and also in
+Visual Studio 2010.
+*/
+#ifndef JAY_TIME_HAS_STD_HASH
+#if ( __cplusplus >= 201103L ) || ( defined( _MSC_VER ) && ( _MSC_VER >= 1600 ) )
+#define JAY_TIME_HAS_STD_HASH
+#endif
+#endif
+
+#ifdef JAY_TIME_HAS_STD_HASH
+#include <functional>
+#endif
+
+
+
+namespace jay {
+namespace time {
+
+/* GetSortKey()
+- Get the sort key of a time.
+
+A SYSTEMTIME member that is out of range of its bits is the greatest value of its bits in the key.
+The key is then not exact (refer to IsSortKeyExact()): it's not necessarily in the order of the
+time, and other times can have the same key.
+
+[in] 'st' / 'ft' / 'ddt' : Some point in time. For 'ddt' it's 'ddt.ft' plus 'ddt.bias' minutes.
+[ret] : The sort key of the time
+*/
+inline JAY_TIME_CONSTEXPR ULONGLONG GetSortKeyMember(
+    const unsigned value,
+    const unsigned bits,
+    const unsigned shift
+)
+{
+    return (ULONGLONG)( ( value < ( 1u << bits ) ) ? value : ( ( 1u << bits ) - 1 ) ) << shift;
+}
+
+inline JAY_TIME_CONSTEXPR ULONGLONG GetSortKey( const SYSTEMTIME &st )
+{
+    return GetSortKeyMember( st.wYear, 16, 39 )
+        | GetSortKeyMember( st.wMonth, 4, 35 )
+        | GetSortKeyMember( st.wDay, 5, 30 )
+        | GetSortKeyMember( st.wHour, 5, 25 )
+        | GetSortKeyMember( st.wMinute, 6, 19 )
+        | GetSortKeyMember( st.wSecond, 6, 13 )
+        | GetSortKeyMember( st.wMilliseconds, 10, 3 )
+        | GetSortKeyMember( st.wDayOfWeek, 3, 0 );
+}
+
+inline ULONGLONG GetSortKey( const FILETIME &ft )
+{
+    return FileTimeToTicks( ft );
+}
+
+inline ULONGLONG GetSortKey( const DayDateTime &ddt )
+{
+    /* The UTC time of a local time near the min FILETIME can be before it, so the ticks are signed
+    and the sign bit is flipped to keep the keys in order as unsigned.
+    */
+    return (ULONGLONG)( (LONGLONG)FileTimeToTicks( ddt.ft ) + ( ddt.bias * 60 * 10000000LL ) )
+        ^ 0x8000000000000000ULL;
+}
+
+
+/* IsSortKeyExact()
+- Check if every member of a SYSTEMTIME is in range of its bits in the sort key.
+
+If so the key is a copy of the SYSTEMTIME and it's the only SYSTEMTIME with that key.
+
+[ret][failure] (false) : A member of 'st' is out of range
+[ret][success] (true) : The key of 'st' is exact
+*/
+inline JAY_TIME_CONSTEXPR bool IsSortKeyExact( const SYSTEMTIME &st )
+{
+    return ( st.wMonth < 16 ) && ( st.wDay < 32 ) && ( st.wHour < 32 ) && ( st.wMinute < 64 )
+        && ( st.wSecond < 64 ) && ( st.wMilliseconds < 1024 ) && ( st.wDayOfWeek < 8 );
+}
+
+
+/* SortKeyToSystemTime()
+- Get the SYSTEMTIME of an exact sort key.
+
+[in] 'key' : The key of a SYSTEMTIME for which IsSortKeyExact() is true
+[out] 'st' : The SYSTEMTIME
+*/
+void SortKeyToSystemTime( const ULONGLONG key, SYSTEMTIME &st );
+
+
+/* GetSortKeys()
+- Get the sort keys of an array of times.
+
+The keys are calculated without branches so that the compiler can vectorize the loop.
+
+[in] 'times' : The times
+[out] 'keys' : The sort key of each time
+[in] 'count' : The number of times in 'times' and 'keys'
+[ret][failure] (false) : The key of at least one SYSTEMTIME is not exact. All keys were output.
+[ret][success] (true) : The keys were output. For SYSTEMTIME every key is exact.
+*/
+bool GetSortKeys( const SYSTEMTIME times[], ULONGLONG keys[], const size_t count );
+bool GetSortKeys( const FILETIME times[], ULONGLONG keys[], const size_t count );
+
+
+/* SortTimes()
+- Sort an array of times in ascending order.
+
+A SYSTEMTIME array is sorted in the order of CompareSystemTimes(). If the key of a SYSTEMTIME is
+not exact the array is sorted by std::stable_sort() instead. A FILETIME array is sorted in the order
+of its ticks. A DayDateTime array is sorted chronologically by its UTC time, and stably: objects
+with the same UTC time, eg the same time at different offsets, remain in the same order.
+
+The sort uses memory for a copy of the keys, and for DayDateTime of their indexes, twice.
+
+[in][out] 'times' : The times
+[in] 'count' : The number of times in 'times'
+*/
+void SortTimes( SYSTEMTIME times[], const size_t count );
+void SortTimes( FILETIME times[], const size_t count );
+void SortTimes( DayDateTime times[], const size_t count );
+
+
+/* HashSortKey()
+- Mix the bits of a key for a hash.
+
+This is the finalizer of SplitMix64, so each bit of the key affects each bit of the hash.
+*/
+inline ULONGLONG HashSortKey( ULONGLONG key )
+{
+    key = ( key ^ ( key >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    key = ( key ^ ( key >> 27 ) ) * 0x94D049BB133111EBULL;
+    return key ^ ( key >> 31 );
+}
+
+
+/* SystemTimeEqualTo
+* FileTimeEqualTo
+* DayDateTimeEqualTo
+- Equality for the std::hash specializations.
+
+SYSTEMTIMEs are equal if CompareSystemTimes() is 0. DayDateTimes are equal if their 'ft' and 'bias'
+are equal, which is the same time at the same offset.
+*/
+struct SystemTimeEqualTo
+{
+    bool operator()( const SYSTEMTIME &a, const SYSTEMTIME &b ) const
+    {
+        return !CompareSystemTimes( a, b );
+    }
+};
+
+struct FileTimeEqualTo
+{
+    bool operator()( const FILETIME &a, const FILETIME &b ) const
+    {
+        return ( a.dwLowDateTime == b.dwLowDateTime ) && ( a.dwHighDateTime == b.dwHighDateTime );
+    }
+};
+
+struct DayDateTimeEqualTo
+{
+    bool operator()( const DayDateTime &a, const DayDateTime &b ) const
+    {
+        return FileTimeEqualTo()( a.ft, b.ft ) && ( a.bias == b.bias );
+    }
+};
+
+} // namespace time
+} // namespace jay
+
+
+
+#ifdef JAY_TIME_HAS_STD_HASH
+namespace std {
+
+/* The hash of a SYSTEMTIME is of every member, so it's consistent with SystemTimeEqualTo even if
+the sort key is not exact.
+*/
+template<> struct hash<SYSTEMTIME>
+{
+    size_t operator()( const SYSTEMTIME &st ) const
+    {
+        const ULONGLONG date = ( (ULONGLONG)st.wYear << 48 ) | ( (ULONGLONG)st.wMonth << 32 )
+            | ( (ULONGLONG)st.wDay << 16 ) | st.wDayOfWeek;
+        const ULONGLONG time = ( (ULONGLONG)st.wHour << 48 ) | ( (ULONGLONG)st.wMinute << 32 )
+            | ( (ULONGLONG)st.wSecond << 16 ) | st.wMilliseconds;
+
+        return (size_t)jay::time::HashSortKey( date ^ jay::time::HashSortKey( time ) );
+    }
+};
+
+template<> struct hash<FILETIME>
+{
+    size_t operator()( const FILETIME &ft ) const
+    {
+        return (size_t)jay::time::HashSortKey( jay::time::FileTimeToTicks( ft ) );
+    }
+};
+
+template<> struct hash<jay::time::DayDateTime>
+{
+    size_t operator()( const jay::time::DayDateTime &ddt ) const
+    {
+        return (size_t)jay::time::HashSortKey( jay::time::FileTimeToTicks( ddt.ft )
+            ^ jay::time::HashSortKey( (ULONGLONG)(LONGLONG)ddt.bias ) );
+    }
+};
+
+} // namespace std
+#endif // JAY_TIME_HAS_STD_HASH
+
+#endif // _JAY_TIME_SORT_KEY_HPP
@@ -24,10 +24,12 @@ Documentation is in time.hpp.
 */
 
 #include "time.hpp"
+#include "filetime.hpp"
 
 #include <windows.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
 
 #include <string>
 #include <iostream>
@@ -39,7 +41,363 @@ using namespace std;
 
 
 
+/* JAY_TIME_HAS_SSE2 is defined if the compiler targets SSE2, which every x64 processor has. Define
+JAY_TIME_NO_SIMD to use only the scalar code.
+*/
+#if !defined( JAY_TIME_NO_SIMD ) && !defined( JAY_TIME_HAS_SSE2 ) \
+    && ( defined( __SSE2__ ) || defined( _M_X64 ) \
+        || ( defined( _M_IX86_FP ) && ( _M_IX86_FP >= 2 ) ) )
+#define JAY_TIME_HAS_SSE2
+#endif
+
+#ifdef JAY_TIME_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
 namespace {
+
+const LONGLONG milliseconds_per_day = 24 * 60 * 60 * 1000;
+
+
+// Add days to a valid date. False if the date would be out of range.
+bool DateAddDays( unsigned &year, unsigned &month, unsigned &day, const LONGLONG days )
+{
+    // the day stays in the month
+    if( ( days > -(LONGLONG)day )
+        && ( days <= (LONGLONG)( jay::time::GetDaysInMonth( month, year ) - day ) )
+    )
+    {
+        day = (unsigned)( day + days );
+        return true;
+    }
+
+    const LONGLONG first = 0;
+    const LONGLONG last = (LONGLONG)jay::time::DateToDays( 31, 12, 30827 );
+    const LONGLONG current = (LONGLONG)jay::time::DateToDays( day, month, year );
+
+    if( ( days < ( first - current ) ) || ( days > ( last - current ) ) )
+        return false;
+
+    jay::time::DaysToDate( (ULONGLONG)( current + days ), year, month, day );
+    return true;
+}
+
+
+// The day of the week that is a number of days after 'day_of_week'
+WORD AddDaysToDayOfWeek( const WORD day_of_week, const LONGLONG days )
+{
+    return (WORD)( ( day_of_week + ( days % 7 ) + 7 ) % 7 );
+}
+
+
+// Add milliseconds to a valid SYSTEMTIME by carrying them through the time of day and the date
+bool SystemTimeAddMilliseconds( SYSTEMTIME &st, const LONGLONG milliseconds )
+{
+    const LONGLONG time_of_day = ( ( ( ( ( st.wHour * 60 ) + st.wMinute ) * 60 ) + st.wSecond )
+        * 1000 ) + st.wMilliseconds;
+
+    LONGLONG total = 0;
+    if( !jay::time::CheckedAdd( time_of_day, milliseconds, total ) )
+        return false;
+
+    LONGLONG days = total / milliseconds_per_day;
+    total %= milliseconds_per_day;
+
+    if( total < 0 )
+    {
+        total += milliseconds_per_day;
+        --days;
+    }
+
+    unsigned year = st.wYear, month = st.wMonth, day = st.wDay;
+
+    if( days && !DateAddDays( year, month, day, days ) )
+        return false;
+
+    st.wYear = (WORD)year;
+    st.wMonth = (WORD)month;
+    st.wDay = (WORD)day;
+    st.wDayOfWeek = AddDaysToDayOfWeek( st.wDayOfWeek, days );
+    st.wHour = (WORD)( total / ( 60 * 60 * 1000 ) );
+    st.wMinute = (WORD)( ( total / ( 60 * 1000 ) ) % 60 );
+    st.wSecond = (WORD)( ( total / 1000 ) % 60 );
+    st.wMilliseconds = (WORD)( total % 1000 );
+    return true;
+}
+
+
+// Add calendar months to a valid SYSTEMTIME, clamping the day to the end of the month
+bool SystemTimeAddMonths( SYSTEMTIME &st, const LONGLONG months )
+{
+    const LONGLONG first = (LONGLONG)1601 * 12;
+    const LONGLONG last = ( (LONGLONG)30827 * 12 ) + 11;
+    const LONGLONG current = ( (LONGLONG)st.wYear * 12 ) + ( st.wMonth - 1 );
+
+    if( ( months < ( first - current ) ) || ( months > ( last - current ) ) )
+        return false;
+
+    const unsigned year = (unsigned)( ( current + months ) / 12 );
+    const unsigned month = (unsigned)( ( current + months ) % 12 ) + 1;
+    const unsigned days_in_month = jay::time::GetDaysInMonth( month, year );
+
+    st.wYear = (WORD)year;
+    st.wMonth = (WORD)month;
+
+    if( st.wDay > days_in_month )
+        st.wDay = (WORD)days_in_month;
+
+    st.wDayOfWeek = jay::time::GetDayOfWeek( st.wDay, st.wMonth, st.wYear );
+    return true;
+}
+
+
+// The day of the week of a date, calculated again only when the date changes
+class DayOfWeekCache
+{
+public:
+    unsigned short Get( const unsigned day, const unsigned month, const unsigned year )
+    {
+        const unsigned date = ( year << 9 ) | ( month << 5 ) | day;
+
+        if( date != _date )
+        {
+            _date = date;
+            _day_of_week = jay::time::GetDayOfWeek( day, month, year );
+        }
+
+        return _day_of_week;
+    }
+
+    // 0 is not the date of any valid year
+    DayOfWeekCache() : _date( 0 ), _day_of_week( 0 ) {}
+
+private:
+    unsigned _date;
+    unsigned short _day_of_week;
+};
+
+
+// Whether or not a day is in its month. The day, month and year are in range.
+inline bool IsDayInMonth( const unsigned day, const unsigned month, const unsigned year )
+{
+    return ( day <= 28 ) || ( day <= jay::time::GetDaysInMonth( month, year ) );
+}
+
+
+// Zero the bitmask of 'count' times
+void ZeroBitmask( ULONGLONG valid[], const size_t count )
+{
+    memset( valid, 0, ( ( count + 63 ) / 64 ) * sizeof( valid[ 0 ] ) );
+}
+
+// Set the bit of the time at 'index' if it's valid
+inline void SetBit( ULONGLONG valid[], const size_t index, const bool bit )
+{
+    valid[ index / 64 ] |= (ULONGLONG)bit << ( index % 64 );
+}
+
+
+bool ValidateSystemTimeArray(
+    const SYSTEMTIME times[],
+    const size_t count,
+    ULONGLONG valid[],
+    const bool check_day_of_week
+)
+{
+    DayOfWeekCache cache;
+    bool all = true;
+    size_t i = 0;
+
+    ZeroBitmask( valid, count );
+
+#ifdef JAY_TIME_HAS_SSE2
+    /* A SYSTEMTIME is eight WORDs, so all its members are compared to their ranges at once.
+    x <= max if x - max saturates to 0, and x >= min if min - x saturates to 0.
+    */
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_setr_epi16( 30827, 12, (short)( check_day_of_week ? 6 : 0xFFFF ),
+        31, 23, 59, 59, 999 );
+    const __m128i min = _mm_setr_epi16( 1601, 1, 0, 1, 0, 0, 0, 0 );
+
+    for( ; i < count; ++i )
+    {
+        const SYSTEMTIME &st = times[ i ];
+        const __m128i members = _mm_loadu_si128( (const __m128i *)&st );
+        const __m128i out_of_range =
+            _mm_or_si128( _mm_subs_epu16( members, max ), _mm_subs_epu16( min, members ) );
+
+        const bool ok = ( _mm_movemask_epi8( _mm_cmpeq_epi16( out_of_range, zero ) ) == 0xFFFF )
+            && IsDayInMonth( st.wDay, st.wMonth, st.wYear )
+            && ( !check_day_of_week
+                || ( st.wDayOfWeek == cache.Get( st.wDay, st.wMonth, st.wYear ) ) );
+
+        SetBit( valid, i, ok );
+        all &= ok;
+    }
+#endif
+
+    for( ; i < count; ++i )
+    {
+        const SYSTEMTIME &st = times[ i ];
+
+        const bool ok = jay::time::IsSystemTimeValid_IgnoreDayOfWeek( st )
+            && ( !check_day_of_week
+                || ( st.wDayOfWeek == cache.Get( st.wDay, st.wMonth, st.wYear ) ) );
+
+        SetBit( valid, i, ok );
+        all &= ok;
+    }
+
+    return all;
+}
+
+
+// Check the SYSTEMTIME at 'i' of columns
+bool IsColumnTimeValid(
+    const jay::time::SystemTimeColumns &times,
+    const size_t i,
+    DayOfWeekCache &cache
+)
+{
+    return jay::time::IsDateValid( times.day[ i ], times.month[ i ], times.year[ i ] )
+        && ( times.hour[ i ] <= 23 )
+        && ( times.minute[ i ] <= 59 )
+        && ( times.second[ i ] <= 59 )
+        && ( times.milliseconds[ i ] <= 999 )
+        && ( !times.day_of_week
+            || ( times.day_of_week[ i ]
+                == cache.Get( times.day[ i ], times.month[ i ], times.year[ i ] ) ) );
+}
+
+
+#ifdef JAY_TIME_HAS_SSE2
+// The lanes of eight WORDs that are out of [min, max]
+inline __m128i OutOfRange( const WORD *column, const short min, const short max )
+{
+    const __m128i members = _mm_loadu_si128( (const __m128i *)column );
+
+    return _mm_or_si128( _mm_subs_epu16( members, _mm_set1_epi16( max ) ),
+        _mm_subs_epu16( _mm_set1_epi16( min ), members ) );
+}
+#endif
+
+
+/* The Neri-Schneider algorithms count days from March 1 of year 0, so that the leap day is the last
+day of the year. This is the number of days from then to January 1, 1601.
+*/
+const unsigned days_before_1601 = 584694;
+
+const ULONGLONG ticks_per_millisecond = 10000;
+const ULONGLONG ticks_per_day = ticks_per_millisecond * milliseconds_per_day;
+
+// The number of times converted at once by the array of structs conversions
+const size_t block_size = 64;
+
+
+struct TimeFields
+{
+    unsigned year;
+    unsigned month;
+    unsigned day_of_week;
+    unsigned day;
+    unsigned hour;
+    unsigned minute;
+    unsigned second;
+    unsigned milliseconds;
+    unsigned day_of_year;
+};
+
+
+/* Decompose a valid number of days since January 1, 1601 into the date fields.
+Cassio Neri and Lorenz Schneider, "Euclidean affine functions and their application to calendar
+algorithms" (2022). Each division is by a constant.
+*/
+inline void DaysToFields( const unsigned days, TimeFields &fields )
+{
+    // century, then the year of the century, then the month and day of the year from March 1
+    const unsigned n = days + days_before_1601;
+    const unsigned n_1 = ( 4 * n ) + 3;
+    const unsigned century = n_1 / 146097;
+    const unsigned n_2 = ( 4 * ( ( n_1 % 146097 ) / 4 ) ) + 3;
+    const ULONGLONG p_2 = 2939745ULL * n_2;
+    const unsigned year = ( 100 * century ) + (unsigned)( p_2 >> 32 );
+    const unsigned day_of_year = (unsigned)( p_2 & 0xFFFFFFFF ) / 2939745 / 4;
+    const unsigned n_3 = ( 2141 * day_of_year ) + 197913;
+
+    // January and February are the end of the year from March 1
+    const unsigned january = ( day_of_year >= 306 );
+    const unsigned leap = !( year & ( ( year % 100 ) ? 3 : 15 ) );
+
+    fields.year = year + january;
+    fields.month = ( n_3 >> 16 ) - ( january * 12 );
+    fields.day = ( ( n_3 & 0xFFFF ) / 2141 ) + 1;
+    fields.day_of_year = january ? ( day_of_year - 306 ) : ( day_of_year + 59 + leap );
+
+    // January 1, 1601 is a Monday
+    fields.day_of_week = ( days + 1 ) % 7;
+}
+
+
+// Decompose valid ticks into fields
+inline void TicksToFields( const ULONGLONG ticks, TimeFields &fields )
+{
+    const ULONGLONG ms = ticks / ticks_per_millisecond;
+    const unsigned days = (unsigned)( ms / (ULONGLONG)milliseconds_per_day );
+    unsigned time_of_day = (unsigned)( ms - ( (ULONGLONG)days * milliseconds_per_day ) );
+
+    fields.hour = time_of_day / ( 60 * 60 * 1000 );
+    time_of_day -= fields.hour * ( 60 * 60 * 1000 );
+    fields.minute = time_of_day / ( 60 * 1000 );
+    time_of_day -= fields.minute * ( 60 * 1000 );
+    fields.second = time_of_day / 1000;
+    fields.milliseconds = time_of_day - ( fields.second * 1000 );
+
+    DaysToFields( days, fields );
+}
+
+
+// The ISO 8601 week date of a valid number of days since January 1, 1601
+inline void DaysToIsoWeekDate( const unsigned days, jay::time::IsoWeekDate &week_date )
+{
+    // January 1, 1601 is a Monday, so this is [0 = Monday, 6 = Sunday]
+    const unsigned monday_based = days % 7;
+
+    // A week is in the year of its Thursday, and is the week of that year the Thursday is in
+    TimeFields thursday;
+    DaysToFields( days - monday_based + 3, thursday );
+
+    week_date.year = (WORD)thursday.year;
+    week_date.week = (WORD)( ( thursday.day_of_year / 7 ) + 1 );
+    week_date.day = (WORD)( monday_based + 1 );
+}
+
+
+// The ticks of valid fields. This is the inverse of TicksToFields().
+inline ULONGLONG FieldsToTicks(
+    const unsigned year,
+    const unsigned month,
+    const unsigned day,
+    const unsigned hour,
+    const unsigned minute,
+    const unsigned second,
+    const unsigned milliseconds
+)
+{
+    const unsigned january = ( month <= 2 );
+    const unsigned y = year - january;
+    const unsigned m = month + ( january * 12 );
+    const unsigned century = y / 100;
+    const unsigned days = ( ( 1461 * y ) / 4 ) - century + ( century / 4 )
+        + ( ( ( 979 * m ) - 2919 ) / 32 ) + ( day - 1 ) - days_before_1601;
+
+    const unsigned time_of_day =
+        ( ( ( ( ( hour * 60 ) + minute ) * 60 ) + second ) * 1000 ) + milliseconds;
+
+    return ( ( (ULONGLONG)days * milliseconds_per_day ) + time_of_day ) * ticks_per_millisecond;
+}
+
 } // anonymous namespace
 
 
@@ -62,163 +420,651 @@ void ShowSystemTime( const SYSTEMTIME &st, std::ostream &output /* = std::cout *
 
 
 
-bool IsLeapYear( const unsigned year )
+/* http://howardhinnant.github.io/date_algorithms.html (days_from_civil)
+The days are counted from March 1, 0000, which is the beginning of a 400 year era, and then offset
+to January 1, 1601.
+*/
+ULONGLONG DateToDays( const unsigned day, const unsigned month, const unsigned year )
 {
-    if( !( year % 400 ) )
-        return true;
-    else if( !( year % 100 ) )
-        return false;
-    else if( !( year % 4 ) )
-        return true;
-    else
-        return false;
+    const unsigned y = year - ( month <= 2 );
+    const unsigned era = y / 400;
+    const unsigned yoe = y - ( era * 400 );
+    const unsigned doy = ( ( ( 153 * ( ( month > 2 ) ? ( month - 3 ) : ( month + 9 ) ) ) + 2 ) / 5 )
+        + day - 1;
+    const unsigned doe = ( yoe * 365 ) + ( yoe / 4 ) - ( yoe / 100 ) + doy;
+
+    return ( (ULONGLONG)era * 146097 ) + doe - 584694;
+}
+
+
+/* http://howardhinnant.github.io/date_algorithms.html (civil_from_days)
+*/
+void DaysToDate( const ULONGLONG days, unsigned &year, unsigned &month, unsigned &day )
+{
+    // days since March 1, 0000, which is the beginning of a 400 year era
+    const ULONGLONG z = days + 584694;
+    const ULONGLONG era = z / 146097;
+    const unsigned doe = (unsigned)( z - ( era * 146097 ) );
+    const unsigned yoe = ( doe - ( doe / 1460 ) + ( doe / 36524 ) - ( doe / 146096 ) ) / 365;
+    const unsigned doy = doe - ( ( 365 * yoe ) + ( yoe / 4 ) - ( yoe / 100 ) );
+    const unsigned mp = ( ( 5 * doy ) + 2 ) / 153;
+
+    day = doy - ( ( ( 153 * mp ) + 2 ) / 5 ) + 1;
+    month = ( mp < 10 ) ? ( mp + 3 ) : ( mp - 9 );
+    year = (unsigned)( yoe + ( era * 400 ) ) + ( month <= 2 );
 }
 
 
 
-bool IsDateValid( const unsigned day, const unsigned month, const unsigned year )
+#ifdef JAY_TIME_HAS_CONSTEXPR
+// The calendar predicates must stay usable in constant expressions. Refer to time.hpp.
+static_assert( IsLeapYear( 2000 ) && !IsLeapYear( 1900 ) && IsLeapYear( 2012 ), "IsLeapYear" );
+static_assert( IsDateValid( 29, 2, 2012 ) && !IsDateValid( 29, 2, 2013 ), "IsDateValid" );
+static_assert( GetDayOfWeek( 1, 1, 1601 ) == 1, "GetDayOfWeek" );
+
+// Wednesday, February 29, 2012, that time with the wrong day of the week, the next day, and that
+// time with an invalid millisecond
+static constexpr SYSTEMTIME constexpr_st = { 2012, 2, 3, 29, 23, 59, 59, 999 };
+static constexpr SYSTEMTIME constexpr_st_bad_dow = { 2012, 2, 4, 29, 23, 59, 59, 999 };
+static constexpr SYSTEMTIME constexpr_st_next = { 2012, 3, 4, 1, 0, 0, 0, 0 };
+static constexpr SYSTEMTIME constexpr_st_bad_ms = { 2012, 2, 3, 29, 23, 59, 59, 1000 };
+
+static_assert( IsSystemTimeValid_IgnoreDayOfWeek( constexpr_st )
+    && IsSystemTimeValid_IgnoreDayOfWeek( constexpr_st_bad_dow )
+    && !IsSystemTimeValid_IgnoreDayOfWeek( constexpr_st_bad_ms ),
+    "IsSystemTimeValid_IgnoreDayOfWeek" );
+static_assert( IsSystemTimeValid( constexpr_st ) && IsSystemTimeValid( constexpr_st_next )
+    && !IsSystemTimeValid( constexpr_st_bad_dow ), "IsSystemTimeValid" );
+
+// the max FILETIME and the 100ns interval after it, in both the low and high DWORD
+static constexpr FILETIME constexpr_ft_max = { 0xF06C58F0, 0x7FFF35F4 };
+static constexpr FILETIME constexpr_ft_after_max = { 0xF06C58F1, 0x7FFF35F4 };
+static constexpr FILETIME constexpr_ft_after_max_high = { 0, 0x7FFF35F5 };
+
+static_assert( IsFileTimeValid( constexpr_ft_max ) && !IsFileTimeValid( constexpr_ft_after_max )
+    && !IsFileTimeValid( constexpr_ft_after_max_high ), "IsFileTimeValid" );
+
+static_assert( ( CompareSystemTimes_IgnoreDayOfWeek( constexpr_st, constexpr_st_next ) == -1 )
+    && ( CompareSystemTimes_IgnoreDayOfWeek( constexpr_st_next, constexpr_st ) == 1 )
+    && !CompareSystemTimes_IgnoreDayOfWeek( constexpr_st, constexpr_st_bad_dow ),
+    "CompareSystemTimes_IgnoreDayOfWeek" );
+static_assert( ( CompareSystemTimes( constexpr_st, constexpr_st_next ) == -1 )
+    && ( CompareSystemTimes( constexpr_st, constexpr_st_bad_dow ) == -1 )
+    && ( CompareSystemTimes( constexpr_st_bad_dow, constexpr_st ) == 1 )
+    && !CompareSystemTimes( constexpr_st, constexpr_st ), "CompareSystemTimes" );
+#endif
+
+
+
+bool FileTimeSubtract100nsIntervals( FILETIME &ft, const long long intervals )
 {
-    // http://msdn.microsoft.com/en-us/library/windows/desktop/ms724950.aspx
-    if( !IsYearValid( year )
-        || ( ( month < 1 ) || ( month > 12 ) )
-        || ( ( day < 1 ) || ( day > 31 ) )
-    )
+    FileTime x( ft );
+    if( !x.Subtract( Ticks( intervals ) ) )
         return false;
 
-    const unsigned days_in_month[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    ft = x.GetFileTime();
+    return true;
+}
+
+
+bool FileTimeAdd100nsIntervals( FILETIME &ft, const long long intervals )
+{
+    FileTime x( ft );
+    if( !x.Add( Ticks( intervals ) ) )
+        return false;
 
-    return ( day <= days_in_month[ month - 1 ] )
-        || ( ( day == 29 ) && ( month == 2 ) && IsLeapYear( year ) );
+    ft = x.GetFileTime();
+    return true;
 }
 
 
 
-// this should return [0=Sun, 6=Sat]
-unsigned short GetDayOfWeek( const unsigned day, const unsigned month, const unsigned year )
+bool FileTimeSubtractMinutes( FILETIME &ft, const long long minutes )
 {
-#if 0
-    SYSTEMTIME st = { year, month, 0, day, 0, 0, 0, 0 };
-    FILETIME ft = {};
+    FileTime x( ft );
+    if( !x.Subtract( Minutes( minutes ) ) )
+        return false;
 
-    if( !SystemTimeToFileTime( &st, &ft ) || !FileTimeToSystemTime( &ft, &st ) )
-        return 0;
+    ft = x.GetFileTime();
+    return true;
+}
 
-    return st.wDayOfWeek;
-#else
-    // Tomohiko Sakomoto method
-    // http://en.wikipedia.org/wiki/Determination_of_the_day_of_the_week
 
-    if( ( month < 1 ) || ( month > 12 ) )
-        return 0;
+bool FileTimeAddMinutes( FILETIME &ft, const long long minutes )
+{
+    FileTime x( ft );
+    if( !x.Add( Minutes( minutes ) ) )
+        return false;
 
-    const unsigned t[ 12 ] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
-    const unsigned y = year - ( month < 3 );
-    return ( y + ( y / 4 ) - ( y / 100 ) + ( y / 400 ) + t[ month - 1 ] + day ) % 7;
-#endif
+    ft = x.GetFileTime();
+    return true;
 }
 
 
 
-bool IsSystemTimeValid_IgnoreDayOfWeek( const SYSTEMTIME &st )
+bool SystemTimeSubtractMinutes( SYSTEMTIME &st, const long long minutes )
 {
-    // http://msdn.microsoft.com/en-us/library/windows/desktop/ms724950.aspx
-    return IsDateValid( st.wDay, st.wMonth, st.wYear )
-        && ( st.wHour <= 23 )
-        && ( st.wMinute <= 59 )
-        && ( st.wSecond <= 59 )
-        && ( st.wMilliseconds <= 999 );
+    return ( minutes != LLONG_MIN ) && SystemTimeAdd( st, -minutes, TIME_UNIT_MINUTES );
 }
 
 
-bool IsSystemTimeValid( const SYSTEMTIME &st )
+bool SystemTimeAddMinutes( SYSTEMTIME &st, const long long minutes )
 {
-    return IsSystemTimeValid_IgnoreDayOfWeek( st )
-        && ( st.wDayOfWeek == GetDayOfWeek( st.wDay, st.wMonth, st.wYear ) );
+    return SystemTimeAdd( st, minutes, TIME_UNIT_MINUTES );
+}
+
+
+
+bool SystemTimeAdd( SYSTEMTIME &st, const long long amount, const TimeUnit unit )
+{
+    ValidSystemTime valid;
+
+    if( !ValidSystemTime::Create( st, valid ) || !valid.Add( amount, unit ) )
+        return false;
+
+    st = valid;
+    return true;
 }
 
 
 
-bool IsFileTimeValid( const FILETIME &ft )
+bool ValidSystemTime::Create( const SYSTEMTIME &st, ValidSystemTime &valid )
 {
-    // this is the same time as max SYSTEMTIME
-    FILETIME max = { 0xF06C58F0, 0x7FFF35F4 };
+    if( !IsSystemTimeValid( st ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    valid._st = st;
+    return true;
+}
+
 
-    return ( ( ft.dwHighDateTime < max.dwHighDateTime )
-        || ( ( ft.dwHighDateTime == max.dwHighDateTime )
-            && ( ft.dwLowDateTime <= max.dwLowDateTime )
+bool ValidSystemTime::Add( const long long amount, const TimeUnit unit )
+{
+    LONGLONG factor = 0;
+
+    switch( unit )
+    {
+    case TIME_UNIT_MILLISECONDS:
+        factor = 1;
+        break;
+    case TIME_UNIT_SECONDS:
+        factor = 1000;
+        break;
+    case TIME_UNIT_MINUTES:
+        factor = 60 * 1000;
+        break;
+    case TIME_UNIT_HOURS:
+        factor = 60 * 60 * 1000;
+        break;
+    case TIME_UNIT_DAYS:
+    case TIME_UNIT_MONTHS:
+    case TIME_UNIT_YEARS:
+        break;
+    default:
+        return false;
+    }
+
+    SYSTEMTIME temp = _st;
+
+    if( unit == TIME_UNIT_DAYS )
+    {
+        unsigned year = temp.wYear, month = temp.wMonth, day = temp.wDay;
+        if( !DateAddDays( year, month, day, amount ) )
+            return false;
+
+        temp.wYear = (WORD)year;
+        temp.wMonth = (WORD)month;
+        temp.wDay = (WORD)day;
+        temp.wDayOfWeek = AddDaysToDayOfWeek( temp.wDayOfWeek, amount );
+    }
+    else if( unit == TIME_UNIT_MONTHS )
+    {
+        if( !SystemTimeAddMonths( temp, amount ) )
+            return false;
+    }
+    else if( unit == TIME_UNIT_YEARS )
+    {
+        LONGLONG months = 0;
+        if( !CheckedMultiply( amount, 12, months ) || !SystemTimeAddMonths( temp, months ) )
+            return false;
+    }
+    else
+    {
+        LONGLONG milliseconds = 0;
+        if( !CheckedMultiply( amount, factor, milliseconds )
+            || !SystemTimeAddMilliseconds( temp, milliseconds )
         )
-    );
+            return false;
+    }
+
+    _st = temp;
+    return true;
 }
 
 
+ValidSystemTime::ValidSystemTime()
+{
+    // January 1, 1601 is a Monday
+    const SYSTEMTIME first = { 1601, 1, 1, 1, 0, 0, 0, 0 };
+    _st = first;
+}
+
 
-bool FileTimeSubtract100nsIntervals( FILETIME &ft, const long long intervals )
+ValidSystemTime::ValidSystemTime( const ValidFileTime &ft )
+{
+    TimeFields fields;
+    TicksToFields( ft.GetTicks(), fields );
+
+    _st.wYear = (WORD)fields.year;
+    _st.wMonth = (WORD)fields.month;
+    _st.wDayOfWeek = (WORD)fields.day_of_week;
+    _st.wDay = (WORD)fields.day;
+    _st.wHour = (WORD)fields.hour;
+    _st.wMinute = (WORD)fields.minute;
+    _st.wSecond = (WORD)fields.second;
+    _st.wMilliseconds = (WORD)fields.milliseconds;
+}
+
+
+bool ValidFileTime::Create( const FILETIME &ft, ValidFileTime &valid )
 {
     if( !IsFileTimeValid( ft ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
         return false;
+    }
+
+    valid._ft = ft;
+    return true;
+}
 
-    if( !intervals )
-        return true;
 
-    LARGE_INTEGER li = { { ft.dwLowDateTime, (LONG)ft.dwHighDateTime } };
+bool ValidFileTime::Add( const LONGLONG ticks )
+{
+    // the ticks of a valid time are less than LLONG_MAX
+    LONGLONG result = 0;
 
-    if( ( ( intervals > 0 ) && ( li.QuadPart < ( LLONG_MIN + intervals ) ) )
-        || ( ( intervals < 0 ) && ( li.QuadPart > ( LLONG_MAX + intervals ) ) )
-    ) // subtraction would cause overflow
+    if( !CheckedAdd( (LONGLONG)GetTicks(), ticks, result )
+        || ( result < 0 )
+        || ( (ULONGLONG)result > JAY_TIME_MAX_FILETIME_TICKS )
+    )
         return false;
 
-    li.QuadPart = li.QuadPart - intervals;
-    ft.dwLowDateTime = li.LowPart;
-    ft.dwHighDateTime = (DWORD)li.HighPart;
+    TicksToFileTime( (ULONGLONG)result, _ft );
+    return true;
+}
+
 
-    return IsFileTimeValid( ft );
+ValidFileTime::ValidFileTime( const ValidSystemTime &st )
+{
+    const SYSTEMTIME &fields = st;
+
+    TicksToFileTime( FieldsToTicks( fields.wYear, fields.wMonth, fields.wDay, fields.wHour,
+        fields.wMinute, fields.wSecond, fields.wMilliseconds ), _ft );
 }
 
 
-bool FileTimeAdd100nsIntervals( FILETIME &ft, const long long intervals )
+bool SystemTimeAdd( ValidSystemTime &st, const long long amount, const TimeUnit unit )
 {
-    if( ( ( intervals < 0 ) && ( ( LLONG_MAX + intervals ) < 0 ) )
-        || ( ( intervals > 0 ) && ( ( LLONG_MIN + intervals ) > 0 ) )
-    ) // sign change would cause overflow
-        return false;
+    return st.Add( amount, unit );
+}
+
+
+bool SystemTimeSubtractMinutes( ValidSystemTime &st, const long long minutes )
+{
+    return ( minutes != LLONG_MIN ) && st.Add( -minutes, TIME_UNIT_MINUTES );
+}
 
-    return FileTimeSubtract100nsIntervals( ft, -intervals );
+
+bool SystemTimeAddMinutes( ValidSystemTime &st, const long long minutes )
+{
+    return st.Add( minutes, TIME_UNIT_MINUTES );
 }
 
 
+bool FileTimeSubtract100nsIntervals( ValidFileTime &ft, const long long intervals )
+{
+    return ( intervals != LLONG_MIN ) && ft.Add( -intervals );
+}
 
-bool FileTimeSubtractMinutes( FILETIME &ft, const long long minutes )
+
+bool FileTimeAdd100nsIntervals( ValidFileTime &ft, const long long intervals )
 {
-    return FileTimeSubtract100nsIntervals( ft, minutes * 10000 * 1000 * 60 );
+    return ft.Add( intervals );
 }
 
 
-bool FileTimeAddMinutes( FILETIME &ft, const long long minutes )
+bool FileTimeSubtractMinutes( ValidFileTime &ft, const long long minutes )
 {
-    return FileTimeAdd100nsIntervals( ft, minutes * 10000 * 1000 * 60 );
+    Ticks ticks;
+    return Minutes( minutes ).Convert( ticks ) && ( ticks.GetCount() != LLONG_MIN )
+        && ft.Add( -ticks.GetCount() );
 }
 
 
+bool FileTimeAddMinutes( ValidFileTime &ft, const long long minutes )
+{
+    Ticks ticks;
+    return Minutes( minutes ).Convert( ticks ) && ft.Add( ticks.GetCount() );
+}
 
-bool SystemTimeSubtractMinutes( SYSTEMTIME &st, const long long minutes )
+
+
+bool ValidateSystemTimes( const SYSTEMTIME times[], const size_t count, ULONGLONG valid[] )
 {
-    FILETIME ft = {};
+    return ValidateSystemTimeArray( times, count, valid, true );
+}
 
-    return IsSystemTimeValid( st )
-        && SystemTimeToFileTime( &st, &ft )
-        && FileTimeSubtractMinutes( ft, minutes )
-        && FileTimeToSystemTime( &ft, &st );
+bool ValidateSystemTimes_IgnoreDayOfWeek(
+    const SYSTEMTIME times[],
+    const size_t count,
+    ULONGLONG valid[]
+)
+{
+    return ValidateSystemTimeArray( times, count, valid, false );
 }
 
+bool ValidateSystemTimes( const SystemTimeColumns &times, const size_t count, ULONGLONG valid[] )
+{
+    DayOfWeekCache cache;
+    bool all = true;
+    size_t i = 0;
+
+    ZeroBitmask( valid, count );
+
+#ifdef JAY_TIME_HAS_SSE2
+    /* The members of eight times are compared to their ranges at once. Each lane is two bytes of
+    the mask of the comparison. Only the times that are in range and have a day after the 28th, or
+    every time in range if the day of the week is checked, are checked one at a time.
+    */
+    const __m128i zero = _mm_setzero_si128();
+
+    for( ; ( count - i ) >= 8; i += 8 )
+    {
+        __m128i out_of_range = _mm_or_si128(
+            _mm_or_si128( OutOfRange( times.year + i, 1601, 30827 ),
+                OutOfRange( times.month + i, 1, 12 ) ),
+            _mm_or_si128( OutOfRange( times.day + i, 1, 31 ),
+                OutOfRange( times.hour + i, 0, 23 ) ) );
+
+        out_of_range = _mm_or_si128( out_of_range,
+            _mm_or_si128(
+                _mm_or_si128( OutOfRange( times.minute + i, 0, 59 ),
+                    OutOfRange( times.second + i, 0, 59 ) ),
+                OutOfRange( times.milliseconds + i, 0, 999 ) ) );
+
+        const int in_range = _mm_movemask_epi8( _mm_cmpeq_epi16( out_of_range, zero ) );
+
+        const int check = times.day_of_week ? 0xFFFF : _mm_movemask_epi8(
+            _mm_cmpgt_epi16( _mm_loadu_si128( (const __m128i *)( times.day + i ) ),
+                _mm_set1_epi16( 28 ) ) );
+
+        for( unsigned lane = 0; lane < 8; ++lane )
+        {
+            const int bit = 1 << ( lane * 2 );
+
+            const bool ok = ( in_range & bit )
+                && ( !( check & bit ) || IsColumnTimeValid( times, i + lane, cache ) );
+
+            SetBit( valid, i + lane, ok );
+            all &= ok;
+        }
+    }
+#endif
+
+    for( ; i < count; ++i )
+    {
+        const bool ok = IsColumnTimeValid( times, i, cache );
 
-bool SystemTimeAddMinutes( SYSTEMTIME &st, const long long minutes )
+        SetBit( valid, i, ok );
+        all &= ok;
+    }
+
+    return all;
+}
+
+bool ValidateFileTimes( const FILETIME times[], const size_t count, ULONGLONG valid[] )
 {
-    FILETIME ft = {};
+    bool all = true;
+
+    ZeroBitmask( valid, count );
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const bool ok = IsFileTimeValid( times[ i ] );
 
-    return IsSystemTimeValid( st )
-        && SystemTimeToFileTime( &st, &ft )
-        && FileTimeAddMinutes( ft, minutes )
-        && FileTimeToSystemTime( &ft, &st );
+        SetBit( valid, i, ok );
+        all &= ok;
+    }
+
+    return all;
+}
+
+
+
+bool TicksToTimeFields(
+    const ULONGLONG ticks[],
+    const size_t count,
+    const TimeFieldColumns &fields
+)
+{
+    bool all = true;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        // an invalid time is decomposed as 0 and its fields are zeroed out
+        const bool ok = ( ticks[ i ] <= JAY_TIME_MAX_FILETIME_TICKS );
+        const unsigned mask = ok ? 0xFFFF : 0;
+
+        TimeFields time;
+        TicksToFields( ok ? ticks[ i ] : 0, time );
+
+        fields.year[ i ] = (WORD)( time.year & mask );
+        fields.month[ i ] = (WORD)( time.month & mask );
+        fields.day_of_week[ i ] = (WORD)( time.day_of_week & mask );
+        fields.day[ i ] = (WORD)( time.day & mask );
+        fields.hour[ i ] = (WORD)( time.hour & mask );
+        fields.minute[ i ] = (WORD)( time.minute & mask );
+        fields.second[ i ] = (WORD)( time.second & mask );
+        fields.milliseconds[ i ] = (WORD)( time.milliseconds & mask );
+
+        if( fields.day_of_year )
+            fields.day_of_year[ i ] = (WORD)( time.day_of_year & mask );
+
+        all &= ok;
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
+}
+
+bool TimeFieldsToTicks( const SystemTimeColumns &fields, const size_t count, ULONGLONG ticks[] )
+{
+    DayOfWeekCache cache;
+    bool all = true;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const bool ok = IsColumnTimeValid( fields, i, cache );
+
+        ticks[ i ] = ok ? FieldsToTicks( fields.year[ i ], fields.month[ i ], fields.day[ i ],
+            fields.hour[ i ], fields.minute[ i ], fields.second[ i ], fields.milliseconds[ i ] )
+            : 0;
+
+        all &= ok;
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
+}
+
+
+bool FileTimesToSystemTimes(
+    const FILETIME file_times[],
+    SYSTEMTIME system_times[],
+    const size_t count
+)
+{
+    ULONGLONG ticks[ block_size ];
+    WORD columns[ 8 ][ block_size ];
+    const TimeFieldColumns fields = { columns[ 0 ], columns[ 1 ], columns[ 2 ], columns[ 3 ],
+        columns[ 4 ], columns[ 5 ], columns[ 6 ], columns[ 7 ], NULL };
+
+    bool all = true;
+
+    for( size_t begin = 0; begin < count; begin += block_size )
+    {
+        const size_t size = min( block_size, count - begin );
+
+        for( size_t i = 0; i < size; ++i )
+            ticks[ i ] = FileTimeToTicks( file_times[ begin + i ] );
+
+        all &= TicksToTimeFields( ticks, size, fields );
+
+        for( size_t i = 0; i < size; ++i )
+        {
+            SYSTEMTIME &st = system_times[ begin + i ];
+
+            st.wYear = columns[ 0 ][ i ];
+            st.wMonth = columns[ 1 ][ i ];
+            st.wDayOfWeek = columns[ 2 ][ i ];
+            st.wDay = columns[ 3 ][ i ];
+            st.wHour = columns[ 4 ][ i ];
+            st.wMinute = columns[ 5 ][ i ];
+            st.wSecond = columns[ 6 ][ i ];
+            st.wMilliseconds = columns[ 7 ][ i ];
+        }
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
+}
+
+bool SystemTimesToFileTimes(
+    const SYSTEMTIME system_times[],
+    FILETIME file_times[],
+    const size_t count
+)
+{
+    ULONGLONG ticks[ block_size ];
+    WORD columns[ 7 ][ block_size ];
+    const SystemTimeColumns fields = { columns[ 0 ], columns[ 1 ], NULL, columns[ 2 ],
+        columns[ 3 ], columns[ 4 ], columns[ 5 ], columns[ 6 ] };
+
+    bool all = true;
+
+    for( size_t begin = 0; begin < count; begin += block_size )
+    {
+        const size_t size = min( block_size, count - begin );
+
+        for( size_t i = 0; i < size; ++i )
+        {
+            const SYSTEMTIME &st = system_times[ begin + i ];
+
+            columns[ 0 ][ i ] = st.wYear;
+            columns[ 1 ][ i ] = st.wMonth;
+            columns[ 2 ][ i ] = st.wDay;
+            columns[ 3 ][ i ] = st.wHour;
+            columns[ 4 ][ i ] = st.wMinute;
+            columns[ 5 ][ i ] = st.wSecond;
+            columns[ 6 ][ i ] = st.wMilliseconds;
+        }
+
+        all &= TimeFieldsToTicks( fields, size, ticks );
+
+        for( size_t i = 0; i < size; ++i )
+            TicksToFileTime( ticks[ i ], file_times[ begin + i ] );
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
+}
+
+
+
+bool GetIsoWeekDate( const SYSTEMTIME &st, IsoWeekDate &week_date )
+{
+    if( !IsDateValid( st.wDay, st.wMonth, st.wYear ) )
+        return false;
+
+    DaysToIsoWeekDate( (unsigned)DateToDays( st.wDay, st.wMonth, st.wYear ), week_date );
+    return true;
+}
+
+bool GetIsoWeekDate( const ULONGLONG ticks, IsoWeekDate &week_date )
+{
+    if( ticks > JAY_TIME_MAX_FILETIME_TICKS )
+        return false;
+
+    DaysToIsoWeekDate( (unsigned)( ticks / ticks_per_day ), week_date );
+    return true;
+}
+
+
+bool GetOrdinalDate( const SYSTEMTIME &st, unsigned &year, unsigned &day_of_year )
+{
+    if( !IsDateValid( st.wDay, st.wMonth, st.wYear ) )
+        return false;
+
+    year = st.wYear;
+    day_of_year =
+        (unsigned)( DateToDays( st.wDay, st.wMonth, st.wYear ) - DateToDays( 1, 1, st.wYear ) ) + 1;
+    return true;
+}
+
+bool GetOrdinalDate( const ULONGLONG ticks, unsigned &year, unsigned &day_of_year )
+{
+    if( ticks > JAY_TIME_MAX_FILETIME_TICKS )
+        return false;
+
+    TimeFields fields;
+    DaysToFields( (unsigned)( ticks / ticks_per_day ), fields );
+
+    year = fields.year;
+    day_of_year = fields.day_of_year + 1;
+    return true;
+}
+
+
+bool TicksToIsoWeekDates(
+    const ULONGLONG ticks[],
+    const size_t count,
+    IsoWeekDate week_dates[]
+)
+{
+    bool all = true;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        // an invalid time is calculated as 0 and its week date is zeroed out
+        const bool ok = ( ticks[ i ] <= JAY_TIME_MAX_FILETIME_TICKS );
+        const WORD mask = ok ? 0xFFFF : 0;
+
+        IsoWeekDate week_date;
+        DaysToIsoWeekDate( (unsigned)( ( ok ? ticks[ i ] : 0 ) / ticks_per_day ), week_date );
+
+        week_dates[ i ].year = week_date.year & mask;
+        week_dates[ i ].week = week_date.week & mask;
+        week_dates[ i ].day = week_date.day & mask;
+
+        all &= ok;
+    }
+
+    if( !all )
+        SetLastError( ERROR_INVALID_TIME );
+
+    return all;
 }
 
 
@@ -236,7 +1082,7 @@ bool SystemTimeToTm( const SYSTEMTIME &st, const bool st_isdst, tm &tm )
     tm.tm_year = st.wYear - 1900;
     tm.tm_wday = st.wDayOfWeek;
 
-    const int acc[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    static const int acc[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
     tm.tm_yday = acc[ tm.tm_mon ] + tm.tm_mday - 1;
     if( IsLeapYear( st.wYear ) && ( tm.tm_mon > 1 ) )
         ++tm.tm_yday;
@@ -246,32 +1092,5 @@ bool SystemTimeToTm( const SYSTEMTIME &st, const bool st_isdst, tm &tm )
     return true;
 }
 
-
-
-#define RETURN_IF_NOT_EQUAL(a,b)   if( a < b ) return -1; else if( a > b ) return 1;
-
-int CompareSystemTimes_IgnoreDayOfWeek( const SYSTEMTIME &a, const SYSTEMTIME &b )
-{
-    RETURN_IF_NOT_EQUAL( a.wYear, b.wYear );
-    RETURN_IF_NOT_EQUAL( a.wMonth, b.wMonth );
-    RETURN_IF_NOT_EQUAL( a.wDay, b.wDay );
-    RETURN_IF_NOT_EQUAL( a.wHour, b.wHour );
-    RETURN_IF_NOT_EQUAL( a.wMinute, b.wMinute );
-    RETURN_IF_NOT_EQUAL( a.wSecond, b.wSecond );
-    RETURN_IF_NOT_EQUAL( a.wMilliseconds, b.wMilliseconds );
-    return 0;
-}
-
-
-int CompareSystemTimes( const SYSTEMTIME &a, const SYSTEMTIME &b )
-{
-    int x = CompareSystemTimes_IgnoreDayOfWeek( a, b );
-    if( x )
-        return x;
-
-    RETURN_IF_NOT_EQUAL( a.wDayOfWeek, b.wDayOfWeek );
-    return 0;
-}
-
 } // namespace time
 } // namespace jay
@@ -24,6 +24,13 @@ Functions for working with time in Windows.
 
 When a function returns [failure] all output parameters are invalid unless otherwise specified.
 When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+The calendar predicates (IsLeapYear(), IsDateValid(), GetDayOfWeek(), IsSystemTimeValid(),
+IsFileTimeValid() and CompareSystemTimes()) are called several times for each time converted, so
+they are inline in this header and their lookup tables are constant. If the compiler supports C++11
+they are also constexpr (JAY_TIME_CONSTEXPR) and can be evaluated at compile time, which is why each
+of them is a single return statement.
 */
 
 #ifndef _JAY_TIME_TIME_HPP
@@ -36,9 +43,32 @@ When a function returns [success] all output parameters are valid unless otherwi
 
 
 
+/* JAY_TIME_CONSTEXPR is constexpr if the compiler supports C++11 constexpr functions, otherwise
+it's empty and the functions are only inline. JAY_TIME_HAS_CONSTEXPR is defined if it's constexpr.
+*/
+#ifndef JAY_TIME_CONSTEXPR
+#if ( __cplusplus >= 201103L ) || ( defined( _MSC_VER ) && ( _MSC_VER >= 1900 ) )
+#define JAY_TIME_CONSTEXPR constexpr
+#define JAY_TIME_HAS_CONSTEXPR
+#else
+#define JAY_TIME_CONSTEXPR
+#endif
+#endif
+
+
+
 namespace jay {
 namespace time {
 
+// The number of days in each month of a year that isn't a leap year
+static JAY_TIME_CONSTEXPR const unsigned short days_in_month_table[ 12 ] =
+    { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+// The month offsets of the Tomohiko Sakamoto day of week method. Refer to GetDayOfWeek().
+static JAY_TIME_CONSTEXPR const unsigned short day_of_week_table[ 12 ] =
+    { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+
+
 /* ShowSystemTime()
 - Output all data members of a SYSTEMTIME
 */
@@ -51,7 +81,7 @@ void ShowSystemTime( const SYSTEMTIME &st, std::ostream &output = std::cout );
 [ret][failure] (false) : 'year' is invalid
 [ret][success] (true) : 'year' is valid
 */
-inline bool IsYearValid( const unsigned year )
+inline JAY_TIME_CONSTEXPR bool IsYearValid( const unsigned year )
 {
     // http://msdn.microsoft.com/en-us/library/windows/desktop/ms724950.aspx
     return ( year >= 1601 ) && ( year <= 30827 );
@@ -64,7 +94,10 @@ inline bool IsYearValid( const unsigned year )
 [ret][failure] (false) : 'year' is not within range or not a leap year
 [ret][success] (true) : 'year' is a valid Gregorian calendar leap year
 */
-bool IsLeapYear( const unsigned year );
+inline JAY_TIME_CONSTEXPR bool IsLeapYear( const unsigned year )
+{
+    return !( year % 4 ) && ( ( year % 100 ) || !( year % 400 ) );
+}
 
 
 /* IsDateValid()
@@ -73,7 +106,51 @@ bool IsLeapYear( const unsigned year );
 [ret][failure] (false) : The date is invalid
 [ret][success] (true) : The date is valid
 */
-bool IsDateValid( const unsigned day, const unsigned month, const unsigned year );
+inline JAY_TIME_CONSTEXPR bool IsDateValid(
+    const unsigned day,
+    const unsigned month,
+    const unsigned year
+)
+{
+    // http://msdn.microsoft.com/en-us/library/windows/desktop/ms724950.aspx
+    return IsYearValid( year )
+        && ( month >= 1 ) && ( month <= 12 )
+        && ( day >= 1 )
+        && ( ( day <= days_in_month_table[ month - 1 ] )
+            || ( ( day == 29 ) && ( month == 2 ) && IsLeapYear( year ) )
+        );
+}
+
+
+/* GetDaysInMonth()
+- Get the number of days in a month.
+
+[in] 'month' : The month [1, 12]
+[in] 'year' : The year
+[ret][failure] (0) : 'month' is invalid
+[ret][success] (unsigned) : The number of days in the month
+*/
+inline JAY_TIME_CONSTEXPR unsigned GetDaysInMonth( const unsigned month, const unsigned year )
+{
+    return ( ( month < 1 ) || ( month > 12 ) ) ? 0
+        : ( days_in_month_table[ month - 1 ] + ( ( month == 2 ) && IsLeapYear( year ) ) );
+}
+
+
+/* DateToDays()
+* DaysToDate()
+- Convert between a date and its number of days since January 1, 1601.
+
+The days are consecutive across months and years, so dates can be offset and compared with integer
+arithmetic. The validity is not checked.
+
+[in] 'day' / 'month' / 'year' : A valid date
+[in] 'days' : The number of days since January 1, 1601
+[out] 'day' / 'month' / 'year' : The date of 'days'
+[ret] (ULONGLONG) : The number of days since January 1, 1601
+*/
+ULONGLONG DateToDays( const unsigned day, const unsigned month, const unsigned year );
+void DaysToDate( const ULONGLONG days, unsigned &year, unsigned &month, unsigned &day );
 
 
 /* GetDayOfWeek()
@@ -82,7 +159,22 @@ bool IsDateValid( const unsigned day, const unsigned month, const unsigned year
 [ret][failure] (unsigned) : The date is invalid. Any number [0, 6] could be returned.
 [ret][success] (unsigned) : The day of the week. [0=Sun, 6=Sat]
 */
-unsigned short GetDayOfWeek( const unsigned day, const unsigned month, const unsigned year );
+inline JAY_TIME_CONSTEXPR unsigned short GetDayOfWeek(
+    const unsigned day,
+    const unsigned month,
+    const unsigned year
+)
+{
+    // Tomohiko Sakamoto method, where the year begins in March
+    // http://en.wikipedia.org/wiki/Determination_of_the_day_of_the_week
+    return ( ( month < 1 ) || ( month > 12 ) ) ? 0 : (unsigned short)( (
+        ( year - ( month < 3 ) )
+        + ( ( year - ( month < 3 ) ) / 4 )
+        - ( ( year - ( month < 3 ) ) / 100 )
+        + ( ( year - ( month < 3 ) ) / 400 )
+        + day_of_week_table[ month - 1 ]
+        + day ) % 7 );
+}
 
 
 /* IsSystemTimeValid()
@@ -96,8 +188,21 @@ functions ignore the wDayOfWeek member when working with SYSTEMTIME structs.
 [ret][failure] (false) : The time is invalid
 [ret][success] (true) : The time is valid
 */
-bool IsSystemTimeValid_IgnoreDayOfWeek( const SYSTEMTIME &st );
-bool IsSystemTimeValid( const SYSTEMTIME &st );
+inline JAY_TIME_CONSTEXPR bool IsSystemTimeValid_IgnoreDayOfWeek( const SYSTEMTIME &st )
+{
+    // http://msdn.microsoft.com/en-us/library/windows/desktop/ms724950.aspx
+    return IsDateValid( st.wDay, st.wMonth, st.wYear )
+        && ( st.wHour <= 23 )
+        && ( st.wMinute <= 59 )
+        && ( st.wSecond <= 59 )
+        && ( st.wMilliseconds <= 999 );
+}
+
+inline JAY_TIME_CONSTEXPR bool IsSystemTimeValid( const SYSTEMTIME &st )
+{
+    return IsSystemTimeValid_IgnoreDayOfWeek( st )
+        && ( st.wDayOfWeek == GetDayOfWeek( st.wDay, st.wMonth, st.wYear ) );
+}
 
 
 /* IsFileTimeValid()
@@ -107,18 +212,253 @@ bool IsSystemTimeValid( const SYSTEMTIME &st );
 [ret][failure] (false) : The time is invalid
 [ret][success] (true) : The time is valid
 */
-bool IsFileTimeValid( const FILETIME &ft );
+inline JAY_TIME_CONSTEXPR bool IsFileTimeValid( const FILETIME &ft )
+{
+    // the max is the same time as max SYSTEMTIME, { 0xF06C58F0, 0x7FFF35F4 }
+    return ( ft.dwHighDateTime < 0x7FFF35F4 )
+        || ( ( ft.dwHighDateTime == 0x7FFF35F4 ) && ( ft.dwLowDateTime <= 0xF06C58F0 ) );
+}
+
+
+/* struct SystemTimeColumns
+- SYSTEMTIMEs stored as an array for each member (struct of arrays).
+
+Each member points to an array of at least 'count' elements of the function it's passed to.
+'day_of_week' is NULL to ignore the day of the week.
+*/
+struct SystemTimeColumns
+{
+    const WORD *year;
+    const WORD *month;
+    const WORD *day_of_week;
+    const WORD *day;
+    const WORD *hour;
+    const WORD *minute;
+    const WORD *second;
+    const WORD *milliseconds;
+};
+
+
+/* ValidateSystemTimes()
+* ValidateSystemTimes_IgnoreDayOfWeek()
+* ValidateFileTimes()
+- Check an array of times.
+
+Each time is checked the same as IsSystemTimeValid(), IsSystemTimeValid_IgnoreDayOfWeek() or
+IsFileTimeValid(). If the compiler targets SSE2 the members of a SYSTEMTIME, or of eight times in
+columns, are compared to their ranges at once. Then only a day after the 28th and the day of the
+week are checked one time at a time. The day of the week is calculated once for each run of times
+with the same date.
+
+The result is a bitmask: time 'i' is valid if bit 'i % 64' of 'valid[ i / 64 ]' is set. The bits
+after the last time are not set.
+
+[in] 'times' : The times
+[in] 'count' : The number of times
+[out] 'valid' : The bitmask of valid times. It has ( count + 63 ) / 64 elements.
+[ret][failure] (false) : At least one time is invalid
+[ret][success] (true) : Every time is valid
+*/
+bool ValidateSystemTimes( const SYSTEMTIME times[], const size_t count, ULONGLONG valid[] );
+bool ValidateSystemTimes( const SystemTimeColumns &times, const size_t count, ULONGLONG valid[] );
+bool ValidateSystemTimes_IgnoreDayOfWeek(
+    const SYSTEMTIME times[],
+    const size_t count,
+    ULONGLONG valid[]
+);
+bool ValidateFileTimes( const FILETIME times[], const size_t count, ULONGLONG valid[] );
+
+
+/* struct TimeFieldColumns
+- The fields of times output as an array for each field (struct of arrays).
+
+Each member points to an array of at least 'count' elements of the function it's passed to.
+'day_of_year' is the number of days since January 1 [0, 365], the same as tm_yday. It's NULL if it's
+not needed.
+*/
+struct TimeFieldColumns
+{
+    WORD *year;
+    WORD *month;
+    WORD *day_of_week;
+    WORD *day;
+    WORD *hour;
+    WORD *minute;
+    WORD *second;
+    WORD *milliseconds;
+    WORD *day_of_year;
+};
+
+
+/* TicksToTimeFields()
+* TimeFieldsToTicks()
+- Convert between arrays of ticks and the fields of their times.
+
+These are the same conversions as FileTimeToSystemTime() and SystemTimeToFileTime() for each time,
+but they're done with integer arithmetic and without branches so the compiler can vectorize the
+loops. The date is calculated by the Neri-Schneider algorithms, in which every division is by a
+constant and so compiles to a multiply and a shift.
+
+The times that could not be converted are zeroed out in the output, which is an invalid time for
+fields (year 0) and the first time for ticks.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : A time is invalid (refer to IsFileTimeValid() and IsSystemTimeValid()). The day
+of the week of 'fields' is checked unless it's NULL.
+######
+
+[in] 'ticks' : Some points in time in ticks (refer to FileTimeToTicks()), UTC or local
+[out] 'fields' : The fields of each time
+[in] 'count' : The number of times
+[ret][failure] (false) : At least one time could not be converted. An error code was set.
+[ret][success] (true) : Every time was converted
+*/
+bool TicksToTimeFields(
+    const ULONGLONG ticks[],
+    const size_t count,
+    const TimeFieldColumns &fields
+);
+bool TimeFieldsToTicks( const SystemTimeColumns &fields, const size_t count, ULONGLONG ticks[] );
+
+
+/* FileTimesToSystemTimes()
+* SystemTimesToFileTimes()
+- Convert between arrays of FILETIME and SYSTEMTIME.
+
+This is TicksToTimeFields() or TimeFieldsToTicks() for each block of times, refer to them. The
+times that could not be converted are zeroed out. SystemTimesToFileTimes() ignores wDayOfWeek, the
+same as SystemTimeToFileTime().
+
+[in] 'file_times' / 'system_times' : Some points in time, UTC or local
+[out] 'system_times' / 'file_times' : The same points in time
+[in] 'count' : The number of times
+[ret][failure] (false) : At least one time could not be converted. An error code was set.
+[ret][success] (true) : Every time was converted
+*/
+bool FileTimesToSystemTimes(
+    const FILETIME file_times[],
+    SYSTEMTIME system_times[],
+    const size_t count
+);
+bool SystemTimesToFileTimes(
+    const SYSTEMTIME system_times[],
+    FILETIME file_times[],
+    const size_t count
+);
+
+
+/* struct IsoWeekDate
+- An ISO 8601 week date, eg 2013-W32-7 is Sunday, August 11, 2013.
+
+Week 1 of a week-numbering year is the week with the year's first Thursday, and weeks start on
+Monday. The last days of December can be in week 1 of the next year, and the first days of January
+in week 52 or 53 of the year before.
+*/
+struct IsoWeekDate
+{
+    // The week-numbering year [1601, 30828]
+    WORD year;
+
+    // The week of the year [1, 53]
+    WORD week;
+
+    // The day of the week [1 = Monday, 7 = Sunday]
+    WORD day;
+};
+
+
+/* GetIsoWeekDate()
+- Get the ISO 8601 week date of a time.
+
+The week date is calculated from the number of days since January 1, 1601 without tables. The time
+of day and wDayOfWeek are ignored.
+
+[in] 'st' / 'ticks' : Some point in time, UTC or local. The date of 'st' must be valid, and 'ticks'
+must be a valid time (refer to IsFileTimeValid()).
+[out] 'week_date' : The week date of the time
+[ret][failure] (false) : The time is invalid
+[ret][success] (true) : The week date was output
+*/
+bool GetIsoWeekDate( const SYSTEMTIME &st, IsoWeekDate &week_date );
+bool GetIsoWeekDate( const ULONGLONG ticks, IsoWeekDate &week_date );
+
+
+/* GetOrdinalDate()
+- Get the ISO 8601 ordinal date of a time, eg 2013-223 is August 11, 2013.
+
+For arrays of ticks the 'day_of_year' column of TicksToTimeFields() is the ordinal day minus 1.
+
+[in] 'st' / 'ticks' : Some point in time, UTC or local. The date of 'st' must be valid, and 'ticks'
+must be a valid time (refer to IsFileTimeValid()).
+[out] 'year' : The year
+[out] 'day_of_year' : The day of the year [1, 366]
+[ret][failure] (false) : The time is invalid
+[ret][success] (true) : The ordinal date was output
+*/
+bool GetOrdinalDate( const SYSTEMTIME &st, unsigned &year, unsigned &day_of_year );
+bool GetOrdinalDate( const ULONGLONG ticks, unsigned &year, unsigned &day_of_year );
+
+
+/* TicksToIsoWeekDates()
+- Get the ISO 8601 week dates of an array of ticks.
+
+This is GetIsoWeekDate() for each time, without branches so the compiler can vectorize the loop. The
+week dates of the times that are invalid are zeroed out. To bucket times by local week instead refer
+to CALENDAR_WEEK in calendar.hpp.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : A time is invalid (refer to IsFileTimeValid()).
+######
+
+[in] 'ticks' : Some points in time in ticks (refer to FileTimeToTicks()), UTC or local
+[in] 'count' : The number of times
+[out] 'week_dates' : The week date of each time
+[ret][failure] (false) : At least one time is invalid. An error code was set.
+[ret][success] (true) : Every week date was output
+*/
+bool TicksToIsoWeekDates(
+    const ULONGLONG ticks[],
+    const size_t count,
+    IsoWeekDate week_dates[]
+);
+
+
+/* FileTimeToTicks()
+* TicksToFileTime()
+- Convert between a FILETIME and its number of 100ns intervals since January 1, 1601 (ticks).
+
+Ticks can be compared and offset with integer arithmetic. The validity is not checked.
+
+[in] 'ft' / 'ticks' : Some point in time, UTC or local
+[out] 'ft' : The same point in time as 'ticks'
+[ret] (ULONGLONG) : The same point in time as 'ft'
+*/
+inline ULONGLONG FileTimeToTicks( const FILETIME &ft )
+{
+    return ( (ULONGLONG)ft.dwHighDateTime << 32 ) | ft.dwLowDateTime;
+}
+
+inline void TicksToFileTime( const ULONGLONG ticks, FILETIME &ft )
+{
+    ft.dwLowDateTime = (DWORD)ticks;
+    ft.dwHighDateTime = (DWORD)( ticks >> 32 );
+}
 
 
 /* FileTimeAdd100nsIntervals()
 * FileTimeSubtract100nsIntervals()
 - Add or Subtract 100ns intervals from a FILETIME.
 
-The validity of the FILETIME is checked both before and after the addition/subtraction.
+The validity of the FILETIME is checked both before and after the addition/subtraction. Refer to
+FileTime in filetime.hpp.
 
 [in] 'ft' : Some point in time, UTC or local
 [in] 'intervals' : The number of intervals to add or subtract from 'ft'
-[ret][failure] (false) : 'ft' is invalid. 'intervals' may or may not have been added or subtracted.
+[ret][failure] (false) : 'ft' is invalid or the result would be. 'ft' is not modified.
 [ret][success] (true) : 'intervals' has been added or subtracted from 'ft'
 */
 bool FileTimeSubtract100nsIntervals( FILETIME &ft, const long long intervals );
@@ -129,11 +469,13 @@ bool FileTimeAdd100nsIntervals( FILETIME &ft, const long long intervals );
 * FileTimeSubtractMinutes()
 - Add or Subtract minutes from a FILETIME.
 
-The validity of the FILETIME is checked both before and after the addition/subtraction.
+The validity of the FILETIME is checked both before and after the addition/subtraction, and the
+conversion of 'minutes' to 100ns intervals is checked for overflow. Refer to FileTime in
+filetime.hpp.
 
 [in] 'ft' : Some point in time, UTC or local
 [in] 'minutes' : The number of minutes to add or subtract from 'ft'
-[ret][failure] (false) : 'ft' is invalid. 'minutes' may or may not have been added or subtracted.
+[ret][failure] (false) : 'ft' is invalid or the result would be. 'ft' is not modified.
 [ret][success] (true) : 'minutes' has been added or subtracted from 'ft'
 */
 bool FileTimeSubtractMinutes( FILETIME &ft, const long long minutes );
@@ -144,17 +486,70 @@ bool FileTimeAddMinutes( FILETIME &ft, const long long minutes );
 * SystemTimeSubtractMinutes()
 - Add or Subtract minutes from a SYSTEMTIME.
 
-The validity of the SYSTEMTIME is checked both before and after the addition/subtraction.
+The validity of the SYSTEMTIME is checked both before and after the addition/subtraction. This is
+SystemTimeAdd() with TIME_UNIT_MINUTES.
 
 [in] 'st' : Some point in time, UTC or local
 [in] 'minutes' : The number of minutes to add or subtract from 'st'
-[ret][failure] (false) : The time is invalid. The minutes may or may not have been added/subtracted.
+[ret][failure] (false) : The time is invalid or the result would be. 'st' is not modified.
 [ret][success] (true) : The time is valid and the minutes have been added/subtracted.
 */
 bool SystemTimeSubtractMinutes( SYSTEMTIME &st, const long long minutes );
 bool SystemTimeAddMinutes( SYSTEMTIME &st, const long long minutes );
 
 
+/* enum TimeUnit
+- A unit of time for SystemTimeAdd().
+
+TIME_UNIT_MILLISECONDS to TIME_UNIT_DAYS are fixed lengths of time; a day is 24 hours.
+TIME_UNIT_MONTHS and TIME_UNIT_YEARS are calendar months and years.
+*/
+enum TimeUnit
+{
+    TIME_UNIT_MILLISECONDS,
+    TIME_UNIT_SECONDS,
+    TIME_UNIT_MINUTES,
+    TIME_UNIT_HOURS,
+    TIME_UNIT_DAYS,
+    TIME_UNIT_MONTHS,
+    TIME_UNIT_YEARS
+};
+
+
+/* SystemTimeAdd()
+- Add an amount of a unit to a SYSTEMTIME by carrying into its fields.
+
+There is no conversion to FILETIME and no WinAPI call. The fields are in a calendar without a zone,
+so if 'st' is a local time the result is the same wall clock time that many units later and may
+not exist in the zone. To add to a local time in a zone call LocalTimeAdd() in timezone.hpp.
+
+Milliseconds, seconds, minutes and hours are carried through the time of day and then the day, and
+days through the date. An amount that doesn't leave the day, or for days the month, only changes the
+fields it has to. Other dates are calculated from their number of days (refer to DateToDays()).
+
+Months and years change the month and year and keep the day and the time of day, except that a day
+past the end of the resulting month is clamped to its last day:
+
+    2013-01-31 + 1 month = 2013-02-28
+    2012-02-29 + 1 year = 2013-02-28
+    2013-03-31 - 1 month = 2013-02-28
+
+Clamping makes the result depend on how the months are added: adding 1 month to January 31 twice is
+March 28, and adding 2 months once is March 31. Add the total to the original date to step monthly
+without drifting, eg the billing date of month N is 'start' + N months.
+
+The day of the week of the result is set.
+
+[in] 'st' : Some point in time, UTC or local
+[in] 'amount' : The number of units to add. Negative subtracts.
+[in] 'unit' : The unit of 'amount'
+[ret][failure] (false) : 'st' or 'unit' is invalid or the result would be out of range. 'st' is not
+modified.
+[ret][success] (true) : 'amount' units have been added to 'st'
+*/
+bool SystemTimeAdd( SYSTEMTIME &st, const long long amount, const TimeUnit unit );
+
+
 /* SystemTimeToTm()
 - Convert a SYSTEMTIME to a tm struct.
 
@@ -178,8 +573,140 @@ functions ignore the wDayOfWeek member when working with SYSTEMTIME structs.
 [ret] (0) : a == b
 [ret] (1) : a > b
 */
-int CompareSystemTimes_IgnoreDayOfWeek( const SYSTEMTIME &a, const SYSTEMTIME &b );
-int CompareSystemTimes( const SYSTEMTIME &a, const SYSTEMTIME &b );
+inline JAY_TIME_CONSTEXPR int CompareSystemTimeMember( const unsigned a, const unsigned b )
+{
+    return ( a < b ) ? -1 : ( ( a > b ) ? 1 : 0 );
+}
+
+inline JAY_TIME_CONSTEXPR int CompareSystemTimes_IgnoreDayOfWeek(
+    const SYSTEMTIME &a,
+    const SYSTEMTIME &b
+)
+{
+    return ( a.wYear != b.wYear ) ? CompareSystemTimeMember( a.wYear, b.wYear )
+        : ( a.wMonth != b.wMonth ) ? CompareSystemTimeMember( a.wMonth, b.wMonth )
+        : ( a.wDay != b.wDay ) ? CompareSystemTimeMember( a.wDay, b.wDay )
+        : ( a.wHour != b.wHour ) ? CompareSystemTimeMember( a.wHour, b.wHour )
+        : ( a.wMinute != b.wMinute ) ? CompareSystemTimeMember( a.wMinute, b.wMinute )
+        : ( a.wSecond != b.wSecond ) ? CompareSystemTimeMember( a.wSecond, b.wSecond )
+        : CompareSystemTimeMember( a.wMilliseconds, b.wMilliseconds );
+}
+
+inline JAY_TIME_CONSTEXPR int CompareSystemTimes( const SYSTEMTIME &a, const SYSTEMTIME &b )
+{
+    return CompareSystemTimes_IgnoreDayOfWeek( a, b )
+        ? CompareSystemTimes_IgnoreDayOfWeek( a, b )
+        : CompareSystemTimeMember( a.wDayOfWeek, b.wDayOfWeek );
+}
+
+
+
+/* class ValidSystemTime
+* class ValidFileTime
+- A SYSTEMTIME or FILETIME that is known to be valid.
+
+A function that takes a SYSTEMTIME or FILETIME checks it, and often the functions it calls check it
+again: SystemTimeAddMinutes() checks the SYSTEMTIME, and UTCTimeToLocalTime() checks the UTC time
+and then checks each candidate local time as it's calculated. A time that is checked once when it's
+received, eg when a record is read, can be kept as one of these types instead. They can only be made
+by Create(), which checks the time, or from another valid time. The overloads that take them skip
+the checks of the time:
+
+    ValidSystemTime utc;
+    if( !ValidSystemTime::Create( record.utc_st, utc ) )
+        return false;
+
+    SystemTimeAddMinutes( utc, 30 ); // not checked again
+    UTCTimeToLocalTime( utc, local_time, tzi_id ); // refer to timezone.hpp
+
+Each converts implicitly to a const reference to its SYSTEMTIME or FILETIME, so it can be passed to
+any function that takes one. The default is January 1, 1601, which is valid.
+
+ValidTimezone in timezone.hpp is the same for a TIME_ZONE_INFORMATION.
+*/
+class ValidFileTime;
+
+class ValidSystemTime
+{
+public:
+    /* ValidSystemTime::Create()
+    - Make a ValidSystemTime from a SYSTEMTIME if it's valid (refer to IsSystemTimeValid()).
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_TIME : 'st' is invalid.
+    ######
+
+    [in] 'st' : Some point in time, UTC or local
+    [out] 'valid' : The time. It's not modified on failure.
+    [ret][failure] (false) : 'st' is invalid. An error code was set.
+    [ret][success] (true) : 'valid' is 'st'
+    */
+    static bool Create( const SYSTEMTIME &st, ValidSystemTime &valid );
+
+    const SYSTEMTIME &Get() const { return _st; }
+    operator const SYSTEMTIME &() const { return _st; }
+
+    // SystemTimeAdd() without checking the time. Refer to SystemTimeAdd().
+    bool Add( const long long amount, const TimeUnit unit );
+
+    ValidSystemTime();
+
+    // The same point in time as a ValidFileTime
+    explicit ValidSystemTime( const ValidFileTime &ft );
+
+private:
+    SYSTEMTIME _st;
+};
+
+class ValidFileTime
+{
+public:
+    /* ValidFileTime::Create()
+    - Make a ValidFileTime from a FILETIME if it's valid (refer to IsFileTimeValid()).
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_TIME : 'ft' is invalid.
+    ######
+
+    [in] 'ft' : Some point in time, UTC or local
+    [out] 'valid' : The time. It's not modified on failure.
+    [ret][failure] (false) : 'ft' is invalid. An error code was set.
+    [ret][success] (true) : 'valid' is 'ft'
+    */
+    static bool Create( const FILETIME &ft, ValidFileTime &valid );
+
+    const FILETIME &Get() const { return _ft; }
+    operator const FILETIME &() const { return _ft; }
+
+    ULONGLONG GetTicks() const { return FileTimeToTicks( _ft ); }
+
+    // Add ticks, which may be negative. The time is not modified on failure.
+    bool Add( const LONGLONG ticks );
+
+    ValidFileTime() { _ft.dwLowDateTime = _ft.dwHighDateTime = 0; }
+
+    // The same point in time as a ValidSystemTime
+    explicit ValidFileTime( const ValidSystemTime &st );
+
+private:
+    FILETIME _ft;
+};
+
+
+/* The overloads of the arithmetic functions for valid times. They are the same as the overloads for
+SYSTEMTIME and FILETIME except the time is not checked.
+*/
+bool SystemTimeAdd( ValidSystemTime &st, const long long amount, const TimeUnit unit );
+bool SystemTimeSubtractMinutes( ValidSystemTime &st, const long long minutes );
+bool SystemTimeAddMinutes( ValidSystemTime &st, const long long minutes );
+bool FileTimeSubtract100nsIntervals( ValidFileTime &ft, const long long intervals );
+bool FileTimeAdd100nsIntervals( ValidFileTime &ft, const long long intervals );
+bool FileTimeSubtractMinutes( ValidFileTime &ft, const long long minutes );
+bool FileTimeAddMinutes( ValidFileTime &ft, const long long minutes );
 
 } // namespace time
 } // namespace jay
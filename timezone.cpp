@@ -24,17 +24,27 @@ Documentation is in timezone.hpp. Example is in timezone_example.cpp.
 */
 
 #include "timezone.hpp"
+#include "timezone_embedded.hpp"
 #include "time.hpp"
 
 #include <windows.h>
 #include <assert.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
+#include <map>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 
 
+// The zone registry functions need advapi32. g++ (MinGW) links it by default.
+#ifdef _MSC_VER
+#pragma comment( lib, "advapi32.lib" )
+#endif
+
+
 #ifdef DEBUG_ST
 #undef DEBUG_ST
 #define DEBUG_ST(a) cout << endl << #a << ": " << endl; ShowSystemTime( a );
@@ -72,6 +82,471 @@ BOOL ( WINAPI *pfnGetTimeZoneInformationForYear ) ( USHORT, ::DYNAMIC_TIME_ZONE_
     ( BOOL ( WINAPI * ) ( USHORT, ::DYNAMIC_TIME_ZONE_INFORMATION *, TIME_ZONE_INFORMATION * ) )
         GetProcAddress( GetModuleHandleA( "kernel32.dll" ), "GetTimeZoneInformationForYear" );
 
+// http://msdn.microsoft.com/en-us/library/ms725481.aspx
+// The format of the "TZI" value and the "Dynamic DST" year values of a zone in the registry
+typedef struct _REG_TZI_FORMAT {
+    LONG Bias;
+    LONG StandardBias;
+    LONG DaylightBias;
+    SYSTEMTIME StandardDate;
+    SYSTEMTIME DaylightDate;
+} REG_TZI_FORMAT;
+
+const wchar_t time_zones_subkey[] =
+    L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Time Zones\\";
+
+
+// Read a REG_BINARY REG_TZI_FORMAT value
+bool ReadRegistryTzi( HKEY key, const wchar_t *value_name, REG_TZI_FORMAT &tzi )
+{
+    DWORD type = 0, size = sizeof( tzi );
+
+    LONG ret = RegQueryValueExW( key, value_name, NULL, &type, (LPBYTE)&tzi, &size );
+    if( ret != ERROR_SUCCESS )
+    {
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    if( ( type != REG_BINARY ) || ( size != sizeof( tzi ) ) )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    return true;
+}
+
+
+// Read a REG_DWORD value
+bool ReadRegistryDword( HKEY key, const wchar_t *value_name, DWORD &value )
+{
+    DWORD type = 0, size = sizeof( value );
+
+    LONG ret = RegQueryValueExW( key, value_name, NULL, &type, (LPBYTE)&value, &size );
+    if( ret != ERROR_SUCCESS )
+    {
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    if( ( type != REG_DWORD ) || ( size != sizeof( value ) ) )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    return true;
+}
+
+
+// Read a REG_SZ value. The registry does not guarantee the string is null terminated.
+bool ReadRegistryString( HKEY key, const wchar_t *value_name, wstring &value )
+{
+    DWORD type = 0, size = 0;
+
+    LONG ret = RegQueryValueExW( key, value_name, NULL, &type, NULL, &size );
+    if( ret != ERROR_SUCCESS )
+    {
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    if( type != REG_SZ )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    wstring buf( ( size / sizeof( wchar_t ) ) + 1, L'\0' );
+    size = (DWORD)( ( buf.size() - 1 ) * sizeof( wchar_t ) );
+
+    ret = RegQueryValueExW( key, value_name, NULL, &type, (LPBYTE)&buf[ 0 ], &size );
+    if( ret != ERROR_SUCCESS )
+    {
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    value = buf.c_str();
+    return true;
+}
+
+
+// The Timezone handles found so far, by key name (not case sensitive)
+struct LessKeyName
+{
+    bool operator()( const wstring &a, const wstring &b ) const
+    {
+        return _wcsicmp( a.c_str(), b.c_str() ) < 0;
+    }
+};
+
+typedef map<wstring, jay::time::Timezone *, LessKeyName> TimezoneCache;
+
+/* The cache and its lock are zero initialized before any code runs, so Timezone::Find() is usable
+during static initialization as well.
+*/
+TimezoneCache *timezone_cache;
+volatile LONG timezone_cache_lock;
+
+void LockTimezoneCache()
+{
+    while( InterlockedCompareExchange( &timezone_cache_lock, 1, 0 ) )
+        Sleep( 0 );
+}
+
+void UnlockTimezoneCache()
+{
+    InterlockedExchange( &timezone_cache_lock, 0 );
+}
+
+
+jay::time::TimezoneRule RegTziToTimezoneRule( const unsigned year, const REG_TZI_FORMAT &tzi )
+{
+    jay::time::TimezoneRule rule = {};
+
+    rule.year = year;
+    rule.Bias = tzi.Bias;
+    rule.StandardBias = tzi.StandardBias;
+    rule.DaylightBias = tzi.DaylightBias;
+    rule.StandardDate = tzi.StandardDate;
+    rule.DaylightDate = tzi.DaylightDate;
+    return rule;
+}
+
+
+/* If auto-DST is disabled then emulate Windows' behavior. Refer to the comment block at the end of
+GetLocalTimeForTimezone()'s definition for more information on that behavior.
+*/
+void EmulateAutoDSTDisabled( TIME_ZONE_INFORMATION &tzi )
+{
+    tzi.StandardBias = 0;
+    tzi.DaylightBias = 0;
+    ZeroMemory( &tzi.StandardDate, sizeof( tzi.StandardDate ) );
+    ZeroMemory( &tzi.DaylightDate, sizeof( tzi.DaylightDate ) );
+    CopyMemory( tzi.DaylightName, tzi.StandardName, sizeof( tzi.DaylightName ) );
+}
+
+
+
+/* The current timezone's rules, cached while the timezone watcher is running.
+Refer to the comment block above the StartTimezoneWatcher() declaration in timezone.hpp.
+*/
+struct CurrentTimezone
+{
+    wstring key_name;
+    wstring standard_name;
+    wstring daylight_name;
+    vector<jay::time::TimezoneRule> rule_storage;
+
+    // points to the members above
+    jay::time::TimezoneRules rules;
+
+    // Windows' auto-DST setting is disabled
+    bool dst_disabled;
+};
+
+/* The published current timezone, or NULL to call the WinAPI. It's only replaced by swapping the
+pointer. The data that was replaced isn't freed because a reader could still be using it and readers
+aren't tracked; it's small, and only replaced when the timezone information changes.
+*/
+const CurrentTimezone *volatile current_timezone;
+
+void PublishCurrentTimezone( const CurrentTimezone *state )
+{
+    InterlockedExchangePointer( (PVOID volatile *)&current_timezone, (PVOID)state );
+}
+
+// Read the current timezone's rules. NULL if they can't be read.
+const CurrentTimezone *ReadCurrentTimezone()
+{
+    if( !pfnGetDynamicTimeZoneInformation )
+        return NULL;
+
+    ::DYNAMIC_TIME_ZONE_INFORMATION dtzi = {};
+    if( pfnGetDynamicTimeZoneInformation( &dtzi ) == TIME_ZONE_ID_INVALID )
+        return NULL;
+
+    // the key name is not null terminated if it's the maximum length
+    const size_t max_name = ( sizeof( dtzi.TimeZoneKeyName ) / sizeof( wchar_t ) );
+    const wchar_t *end = wmemchr( dtzi.TimeZoneKeyName, 0, max_name );
+
+    CurrentTimezone *state = new CurrentTimezone;
+    state->key_name.assign( dtzi.TimeZoneKeyName,
+        ( end ? (size_t)( end - dtzi.TimeZoneKeyName ) : max_name ) );
+    state->dst_disabled = !!dtzi.DynamicDaylightTimeDisabled;
+
+    if( !jay::time::ReadTimezoneRulesFromRegistry( state->key_name, state->standard_name,
+            state->daylight_name, state->rule_storage )
+    )
+    {
+        delete state;
+        return NULL;
+    }
+
+    state->rules.key_name = state->key_name.c_str();
+    state->rules.standard_name = state->standard_name.c_str();
+    state->rules.daylight_name = state->daylight_name.c_str();
+    state->rules.rules = ( state->rule_storage.empty() ? NULL : &state->rule_storage[ 0 ] );
+    state->rules.count = state->rule_storage.size();
+    return state;
+}
+
+
+
+/* The default timezone provider, or NULL for OSTimezoneProvider. It's only replaced by swapping the
+pointer. Refer to SetTimezoneProvider().
+*/
+const jay::time::TimezoneProvider *volatile timezone_provider;
+
+
+
+/* The timezone watcher. Only one can run at a time. Started and stopped under its lock.
+
+events[ 0 ] is signaled to stop the watcher thread. The other events are signaled by the registry
+when a key of the same index in 'keys' changes.
+*/
+struct TimezoneWatcher
+{
+    HANDLE thread;
+    HANDLE events[ 3 ];
+    HKEY keys[ 2 ];
+};
+
+TimezoneWatcher *timezone_watcher;
+volatile LONG timezone_watcher_lock;
+
+void LockTimezoneWatcher()
+{
+    while( InterlockedCompareExchange( &timezone_watcher_lock, 1, 0 ) )
+        Sleep( 0 );
+}
+
+void UnlockTimezoneWatcher()
+{
+    InterlockedExchange( &timezone_watcher_lock, 0 );
+}
+
+void CloseTimezoneWatcher( TimezoneWatcher *watcher )
+{
+    if( watcher->thread )
+        CloseHandle( watcher->thread );
+
+    for( size_t i = 0; i < ( sizeof( watcher->events ) / sizeof( watcher->events[ 0 ] ) ); ++i )
+    {
+        if( watcher->events[ i ] )
+            CloseHandle( watcher->events[ i ] );
+    }
+
+    for( size_t i = 0; i < ( sizeof( watcher->keys ) / sizeof( watcher->keys[ 0 ] ) ); ++i )
+    {
+        if( watcher->keys[ i ] )
+            RegCloseKey( watcher->keys[ i ] );
+    }
+
+    delete watcher;
+}
+
+DWORD WINAPI TimezoneWatcherThread( LPVOID param )
+{
+    TimezoneWatcher *watcher = (TimezoneWatcher *)param;
+    const DWORD filter = REG_NOTIFY_CHANGE_NAME | REG_NOTIFY_CHANGE_LAST_SET;
+    bool changed = false;
+
+    for( ;; )
+    {
+        /* A notification is only signaled once so it's requested again before each read. That way
+        a change made while reading is not missed, it signals the event and is read next time.
+        */
+        if( ( RegNotifyChangeKeyValue( watcher->keys[ 0 ], TRUE, filter, watcher->events[ 1 ],
+                TRUE ) != ERROR_SUCCESS )
+            || ( RegNotifyChangeKeyValue( watcher->keys[ 1 ], TRUE, filter, watcher->events[ 2 ],
+                TRUE ) != ERROR_SUCCESS )
+        )
+            break;
+
+        PublishCurrentTimezone( ReadCurrentTimezone() );
+
+        if( changed )
+            jay::time::Timezone::ReloadAll();
+
+        const DWORD count = sizeof( watcher->events ) / sizeof( watcher->events[ 0 ] );
+        const DWORD ret = WaitForMultipleObjects( count, watcher->events, FALSE, INFINITE );
+
+        // the stop event is first so it takes precedence over a change
+        if( ( ret < WAIT_OBJECT_0 + 1 ) || ( ret >= WAIT_OBJECT_0 + count ) )
+            break;
+
+        changed = true;
+    }
+
+    PublishCurrentTimezone( NULL );
+    return 0;
+}
+
+
+
+
+/* Parser for the parts of a POSIX TZ string. Refer to the comment block above the
+PosixTZToTimezoneInfo() declaration in timezone.hpp.
+
+On failure the parse functions set the parser's error code, which is only set once so that it's the
+error code of the first failure.
+*/
+class PosixTZParser
+{
+public:
+    explicit PosixTZParser( const char *tz ) : _p( tz ), _error( 0 ) {}
+
+    DWORD GetError() const { return _error ? _error : ERROR_INVALID_DATA; }
+
+    bool AtEnd() const { return !*_p; }
+
+    bool Peek( const char c ) const { return *_p == c; }
+
+    bool Accept( const char c )
+    {
+        if( *_p != c )
+            return false;
+
+        ++_p;
+        return true;
+    }
+
+    // A name of 3 or more letters, or any characters except '>' and ',' in angle brackets
+    bool ParseName( wstring &name )
+    {
+        name.clear();
+
+        if( Accept( '<' ) )
+        {
+            while( *_p && ( *_p != '>' ) && ( *_p != ',' ) )
+                name += (wchar_t)(unsigned char)*_p++;
+
+            if( !Accept( '>' ) )
+                return Fail( ERROR_INVALID_DATA );
+        }
+        else
+        {
+            while( ( ( *_p >= 'A' ) && ( *_p <= 'Z' ) ) || ( ( *_p >= 'a' ) && ( *_p <= 'z' ) ) )
+                name += (wchar_t)*_p++;
+        }
+
+        if( name.size() < 3 )
+            return Fail( ERROR_INVALID_DATA );
+
+        // the most that fits in TIME_ZONE_INFORMATION StandardName/DaylightName
+        if( name.size() > 31 )
+            return Fail( ERROR_NOT_SUPPORTED );
+
+        return true;
+    }
+
+    // An offset [+|-]hh[:mm[:ss]] in minutes, positive west of UTC
+    bool ParseOffset( long &minutes )
+    {
+        long seconds = 0;
+
+        if( !ParseTime( seconds, 24 ) )
+            return false;
+
+        if( seconds % 60 )
+            return Fail( ERROR_NOT_SUPPORTED );
+
+        minutes = seconds / 60;
+        return true;
+    }
+
+    // A rule Mm.w.d[/time] as a relative timezone time
+    bool ParseRule( SYSTEMTIME &tzt )
+    {
+        // Julian day rules
+        if( ( *_p == 'J' ) || ( ( *_p >= '0' ) && ( *_p <= '9' ) ) )
+            return Fail( ERROR_NOT_SUPPORTED );
+
+        unsigned month = 0, week = 0, day = 0;
+
+        if( !Accept( 'M' )
+            || !ParseNumber( month, 2 ) || ( month < 1 ) || ( month > 12 ) || !Accept( '.' )
+            || !ParseNumber( week, 1 ) || ( week < 1 ) || ( week > 5 ) || !Accept( '.' )
+            || !ParseNumber( day, 1 ) || ( day > 6 )
+        )
+            return Fail( ERROR_INVALID_DATA );
+
+        // 02:00:00 unless a time is specified. POSIX allows [-167, 167] hours.
+        long seconds = 2 * 60 * 60;
+
+        if( Accept( '/' ) && !ParseTime( seconds, 167 ) )
+            return false;
+
+        if( ( seconds < 0 ) || ( seconds >= ( 24 * 60 * 60 ) ) )
+            return Fail( ERROR_NOT_SUPPORTED );
+
+        ZeroMemory( &tzt, sizeof( tzt ) );
+        tzt.wMonth = (WORD)month;
+        tzt.wDay = (WORD)week;
+        tzt.wDayOfWeek = (WORD)day;
+        tzt.wHour = (WORD)( seconds / ( 60 * 60 ) );
+        tzt.wMinute = (WORD)( ( seconds / 60 ) % 60 );
+        tzt.wSecond = (WORD)( seconds % 60 );
+        return true;
+    }
+
+private:
+    // A time [+|-]hh[:mm[:ss]] in seconds
+    bool ParseTime( long &seconds, const unsigned max_hours )
+    {
+        const bool negative = Accept( '-' );
+        if( !negative )
+            Accept( '+' );
+
+        unsigned hours = 0, minutes = 0, secs = 0;
+
+        if( !ParseNumber( hours, 3 ) || ( hours > max_hours )
+            || ( Accept( ':' )
+                && ( !ParseNumber( minutes, 2 ) || ( minutes > 59 )
+                    || ( Accept( ':' ) && ( !ParseNumber( secs, 2 ) || ( secs > 59 ) ) )
+                )
+            )
+        )
+            return Fail( ERROR_INVALID_DATA );
+
+        seconds = (long)( ( hours * 60 * 60 ) + ( minutes * 60 ) + secs );
+        if( negative )
+            seconds = -seconds;
+
+        return true;
+    }
+
+    // An unsigned decimal number of at most 'max_digits' digits
+    bool ParseNumber( unsigned &n, const unsigned max_digits )
+    {
+        unsigned digits = 0;
+
+        for( n = 0; ( *_p >= '0' ) && ( *_p <= '9' ); ++_p )
+        {
+            if( ++digits > max_digits )
+                return false;
+
+            n = ( n * 10 ) + (unsigned)( *_p - '0' );
+        }
+
+        return digits > 0;
+    }
+
+    bool Fail( const DWORD error )
+    {
+        if( !_error )
+            _error = error;
+
+        return false;
+    }
+
+    const char *_p;
+    DWORD _error;
+};
+
 } // anonymous namespace
 
 
@@ -176,6 +651,19 @@ bool IsTimezoneInfoValid(
 }
 
 
+bool ValidTimezone::Create( const TIME_ZONE_INFORMATION &tzi, ValidTimezone &valid )
+{
+    if( !IsTimezoneInfoValid( tzi, true ) )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    valid._tzi = tzi;
+    return true;
+}
+
+
 
 bool LocalTimeToRelativeTimezoneTime(
     const SYSTEMTIME &local,
@@ -288,6 +776,18 @@ int CompareLocalTimeToTimezoneTime( const SYSTEMTIME &local, const SYSTEMTIME &t
 
 
 bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year )
+{
+    const TimezoneProvider *provider = timezone_provider;
+
+    return provider ? provider->GetTimezoneForYear( tzi, year )
+        : OSTimezoneProvider().GetTimezoneForYear( tzi, year );
+}
+
+
+bool OSTimezoneProvider::GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year
+) const
 {
     if( !IsYearValid( year ) )
     {
@@ -295,6 +795,19 @@ bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year )
         return false;
     }
 
+    // the current timezone's rules cached by the timezone watcher, if it's running
+    const CurrentTimezone *state = current_timezone;
+    if( state )
+    {
+        if( !jay::time::GetTimezoneForYear( tzi, year, state->rules ) )
+            return false;
+
+        if( state->dst_disabled )
+            EmulateAutoDSTDisabled( tzi );
+
+        return true;
+    }
+
     if( pfnGetDynamicTimeZoneInformation )
     {
         DWORD dtzi_id = TIME_ZONE_ID_INVALID;
@@ -324,17 +837,8 @@ bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year )
             // restore actual DST setting
             dtzi.DynamicDaylightTimeDisabled = save;
 
-            /* If auto-DST is disabled then emulate Windows' behavior. Refer to the comment block at
-            the end of GetLocalTimeForTimezone()'s definition for more information on that behavior.
-            */
             if( dtzi.DynamicDaylightTimeDisabled )
-            {
-                tzi.StandardBias = 0;
-                tzi.DaylightBias = 0;
-                ZeroMemory( &tzi.StandardDate, sizeof( tzi.StandardDate ) );
-                ZeroMemory( &tzi.DaylightDate, sizeof( tzi.DaylightDate ) );
-                CopyMemory( tzi.DaylightName, tzi.StandardName, sizeof( tzi.DaylightName ) );
-            }
+                EmulateAutoDSTDisabled( tzi );
         }
         else
         {
@@ -361,6 +865,29 @@ DWORD GetLocalTimeForTimezone(
     unsigned tzi_year /* = 0 */,
     const bool strict /* = false */
 )
+{
+    ValidTimezone valid_tzi;
+    ValidSystemTime valid_utc_st;
+
+    if( !ValidTimezone::Create( tzi, valid_tzi )
+        || !ValidSystemTime::Create( utc_st, valid_utc_st )
+    )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return TIME_ZONE_ID_INVALID;
+    }
+
+    return GetLocalTimeForTimezone( local_time, valid_tzi, valid_utc_st, tzi_year, strict );
+}
+
+
+DWORD GetLocalTimeForTimezone(
+    SYSTEMTIME &local_time,
+    const ValidTimezone &valid_tzi,
+    const ValidSystemTime &utc_st,
+    unsigned tzi_year /* = 0 */,
+    const bool strict /* = false */
+)
 {
 // function-like macro to set and check 'local_time'
 #define COPY_TO_local_time(newtime)   \
@@ -372,8 +899,10 @@ if( strict && ( local_time.wYear != tzi_year ) ) \
     return TIME_ZONE_ID_INVALID; \
 }
 
+    const TIME_ZONE_INFORMATION &tzi = valid_tzi;
+
     if( !tzi_year )
-        tzi_year = utc_st.wYear;
+        tzi_year = utc_st.Get().wYear;
 
     if( !IsYearValid( tzi_year ) )
     {
@@ -381,16 +910,16 @@ if( strict && ( local_time.wYear != tzi_year ) ) \
         return false;
     }
 
-    DEBUG_ST( utc_st );
+    DEBUG_ST( utc_st.Get() );
     DEBUG_ST( tzi.StandardDate );
     DEBUG_ST( tzi.DaylightDate );
 
-    SYSTEMTIME local_time_if_unknown = utc_st;
-    SYSTEMTIME local_time_if_standard = utc_st;
-    SYSTEMTIME local_time_if_daylight = utc_st;
+    // the candidates are calculated from the valid UTC time, so they aren't checked
+    ValidSystemTime local_time_if_unknown = utc_st;
+    ValidSystemTime local_time_if_standard = utc_st;
+    ValidSystemTime local_time_if_daylight = utc_st;
 
-    if( !IsTimezoneInfoValid( tzi, true )
-        || !SystemTimeSubtractMinutes( local_time_if_unknown, tzi.Bias )
+    if( !SystemTimeSubtractMinutes( local_time_if_unknown, tzi.Bias )
         || !SystemTimeSubtractMinutes( local_time_if_standard, tzi.Bias + tzi.StandardBias )
         || !SystemTimeSubtractMinutes( local_time_if_daylight, tzi.Bias + tzi.DaylightBias )
     )
@@ -405,9 +934,9 @@ if( strict && ( local_time.wYear != tzi_year ) ) \
     continuing.
     */
     if( strict
-        && ( local_time_if_unknown.wYear != tzi_year )
-        && ( local_time_if_standard.wYear != tzi_year )
-        && ( local_time_if_daylight.wYear != tzi_year )
+        && ( local_time_if_unknown.Get().wYear != tzi_year )
+        && ( local_time_if_standard.Get().wYear != tzi_year )
+        && ( local_time_if_daylight.Get().wYear != tzi_year )
     )
     {
         SetLastError( ERROR_NOT_SUPPORTED );
@@ -440,8 +969,8 @@ if( strict && ( local_time.wYear != tzi_year ) ) \
     DEBUG_ST( utc_standard_start );
     DEBUG_ST( utc_daylight_start );
 
-    DEBUG_ST( local_time_if_standard );
-    DEBUG_ST( local_time_if_daylight );
+    DEBUG_ST( local_time_if_standard.Get() );
+    DEBUG_ST( local_time_if_daylight.Get() );
 #endif
 
     const bool is_standard_time_before_daylight_start =
@@ -549,19 +1078,66 @@ DWORD GetLocalTimeForTimezone( SYSTEMTIME &local_time, const TIME_ZONE_INFORMATI
 
 
 
-bool UTCTimeToLocalTime(
-    const SYSTEMTIME &utc_st,
-    SYSTEMTIME &local_time,
-    DWORD &tzi_id,
-    TIME_ZONE_INFORMATION &tzi
+namespace {
+
+// GetTimezoneForYear() from 'provider', or from the current timezone if 'provider' is NULL
+bool GetTimezoneForYearFromProvider(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year,
+    const TimezoneProvider *provider
 )
 {
-    if( !IsSystemTimeValid( utc_st ) )
+    return provider ? provider->GetTimezoneForYear( tzi, year ) : GetTimezoneForYear( tzi, year );
+}
+
+
+// A zone's rules as a provider, for the TimezoneRules overloads
+class RulesTimezoneProvider : public TimezoneProvider
+{
+public:
+    explicit RulesTimezoneProvider( const TimezoneRules &zone ) : _zone( zone ) {}
+
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const
+    {
+        return jay::time::GetTimezoneForYear( tzi, year, _zone );
+    }
+
+private:
+    const TimezoneRules &_zone;
+};
+
+
+// GetLocalTimeForTimezone() for timezone information from a provider, which is checked once
+DWORD GetLocalTimeForTzi(
+    SYSTEMTIME &local_time,
+    const TIME_ZONE_INFORMATION &tzi,
+    const ValidSystemTime &utc_st,
+    const unsigned tzi_year,
+    const bool strict
+)
+{
+    ValidTimezone valid_tzi;
+
+    if( !ValidTimezone::Create( tzi, valid_tzi ) )
     {
         SetLastError( ERROR_INVALID_TIME );
-        return false;
+        return TIME_ZONE_ID_INVALID;
     }
 
+    return GetLocalTimeForTimezone( local_time, valid_tzi, utc_st, tzi_year, strict );
+}
+
+
+// UTCTimeToLocalTime() for 'provider', or for the current timezone if 'provider' is NULL
+bool UTCTimeToLocalTimeForZone(
+    const ValidSystemTime &valid_utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider *provider
+)
+{
+    const SYSTEMTIME &utc_st = valid_utc_st;
     const unsigned current_year = utc_st.wYear;
     const unsigned previous_year = current_year - 1;
     const unsigned next_year = current_year + 1;
@@ -570,34 +1146,34 @@ bool UTCTimeToLocalTime(
 
     if( ( utc_st.wMonth == 1 ) && ( utc_st.wDay == 1 ) )
     { // edge case
-        if( GetTimezoneForYear( tzi, previous_year ) )
+        if( GetTimezoneForYearFromProvider( tzi, previous_year, provider ) )
         {
-            tzi_id = GetLocalTimeForTimezone( local_time, tzi, utc_st, previous_year, true );
+            tzi_id = GetLocalTimeForTzi( local_time, tzi, valid_utc_st, previous_year, true );
             if( tzi_id != TIME_ZONE_ID_INVALID )
                 return true;
         }
 
-        if( GetTimezoneForYear( tzi, current_year ) )
+        if( GetTimezoneForYearFromProvider( tzi, current_year, provider ) )
         {
-            tzi_id = GetLocalTimeForTimezone( local_time, tzi, utc_st, current_year, false );
+            tzi_id = GetLocalTimeForTzi( local_time, tzi, valid_utc_st, current_year, false );
             if( tzi_id != TIME_ZONE_ID_INVALID )
                 return true;
         }
     }
     else
     {
-        if( GetTimezoneForYear( tzi, current_year ) )
+        if( GetTimezoneForYearFromProvider( tzi, current_year, provider ) )
         {
-            tzi_id = GetLocalTimeForTimezone( local_time, tzi, utc_st, current_year, true );
+            tzi_id = GetLocalTimeForTzi( local_time, tzi, valid_utc_st, current_year, true );
             if( tzi_id != TIME_ZONE_ID_INVALID )
                 return true;
         }
 
         if( ( utc_st.wMonth == 12 ) && ( utc_st.wDay == 31 ) )
         { // edge case
-            if( GetTimezoneForYear( tzi, next_year ) )
+            if( GetTimezoneForYearFromProvider( tzi, next_year, provider ) )
             {
-                tzi_id = GetLocalTimeForTimezone( local_time, tzi, utc_st, next_year, false );
+                tzi_id = GetLocalTimeForTzi( local_time, tzi, valid_utc_st, next_year, false );
                 if( tzi_id != TIME_ZONE_ID_INVALID )
                     return true;
             }
@@ -611,6 +1187,35 @@ bool UTCTimeToLocalTime(
 }
 
 
+
+bool UTCTimeToLocalTimeForZone(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider *provider
+)
+{
+    ValidSystemTime valid_utc_st;
+
+    return ValidSystemTime::Create( utc_st, valid_utc_st )
+        && UTCTimeToLocalTimeForZone( valid_utc_st, local_time, tzi_id, tzi, provider );
+}
+
+} // anonymous namespace
+
+
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, NULL );
+}
+
+
 bool UTCTimeToLocalTime( const SYSTEMTIME &utc_st, SYSTEMTIME &local_time, DWORD &tzi_id )
 {
     TIME_ZONE_INFORMATION tzi = {};
@@ -625,5 +1230,1386 @@ bool UTCTimeToLocalTime( const SYSTEMTIME &utc_st, SYSTEMTIME &local_time )
     return UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi );
 }
 
+
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, NULL );
+}
+
+
+bool UTCTimeToLocalTime( const ValidSystemTime &utc_st, SYSTEMTIME &local_time, DWORD &tzi_id )
+{
+    TIME_ZONE_INFORMATION tzi = {};
+    return UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi );
+}
+
+
+
+const TimezoneRule *FindTimezoneRuleForYear( const TimezoneRules &zone, const unsigned year )
+{
+    if( !IsYearValid( year ) || !zone.rules || !zone.count )
+        return NULL;
+
+    // find the first rule that begins after 'year'
+    size_t first = 0, last = zone.count;
+    while( first < last )
+    {
+        const size_t middle = first + ( ( last - first ) / 2 );
+
+        if( zone.rules[ middle ].year <= year )
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    // the rule before that one, or the first rule if 'year' is before all of them
+    return &zone.rules[ first ? ( first - 1 ) : 0 ];
+}
+
+
+
+bool TimezoneRuleToTimezoneInfo(
+    const TimezoneRules &zone,
+    const TimezoneRule &rule,
+    TIME_ZONE_INFORMATION &tzi
+)
+{
+    const size_t max_name = ( sizeof( tzi.StandardName ) / sizeof( wchar_t ) ) - 1;
+
+    const WCHAR *standard_name = ( zone.standard_name ? zone.standard_name : L"" );
+    const WCHAR *daylight_name = ( zone.daylight_name ? zone.daylight_name : L"" );
+
+    if( ( wcslen( standard_name ) > max_name ) || ( wcslen( daylight_name ) > max_name ) )
+        return false;
+
+    ZeroMemory( &tzi, sizeof( tzi ) );
+    tzi.Bias = rule.Bias;
+    tzi.StandardBias = rule.StandardBias;
+    tzi.DaylightBias = rule.DaylightBias;
+    tzi.StandardDate = rule.StandardDate;
+    tzi.DaylightDate = rule.DaylightDate;
+    wcscpy( tzi.StandardName, standard_name );
+    wcscpy( tzi.DaylightName, daylight_name );
+
+    return IsTimezoneInfoValid( tzi, true );
+}
+
+
+
+bool ReadTimezoneRulesFromRegistry(
+    const std::wstring &key_name,
+    std::wstring &standard_name,
+    std::wstring &daylight_name,
+    std::vector<TimezoneRule> &rules
+)
+{
+    rules.clear();
+
+    if( key_name.empty() )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    HKEY key = NULL;
+    LONG ret = RegOpenKeyExW( HKEY_LOCAL_MACHINE, ( time_zones_subkey + key_name ).c_str(), 0,
+        KEY_READ, &key );
+    if( ret != ERROR_SUCCESS )
+    {
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    REG_TZI_FORMAT tzi = {};
+    bool success = ReadRegistryTzi( key, L"TZI", tzi )
+        && ReadRegistryString( key, L"Std", standard_name )
+        && ReadRegistryString( key, L"Dlt", daylight_name );
+
+    HKEY dynamic_key = NULL;
+    if( success
+        && ( RegOpenKeyExW( key, L"Dynamic DST", 0, KEY_READ, &dynamic_key ) == ERROR_SUCCESS )
+    )
+    {
+        DWORD first_entry = 0, last_entry = 0;
+
+        success = ReadRegistryDword( dynamic_key, L"FirstEntry", first_entry )
+            && ReadRegistryDword( dynamic_key, L"LastEntry", last_entry );
+
+        if( success
+            && ( !IsYearValid( first_entry ) || !IsYearValid( last_entry )
+                || ( first_entry > last_entry )
+            )
+        )
+        {
+            SetLastError( ERROR_INVALID_DATA );
+            success = false;
+        }
+
+        for( DWORD year = first_entry; success && ( year <= last_entry ); ++year )
+        {
+            wstringstream ss_year;
+            ss_year << year;
+
+            REG_TZI_FORMAT year_tzi = {};
+            success = ReadRegistryTzi( dynamic_key, ss_year.str().c_str(), year_tzi );
+            if( success )
+                rules.push_back( RegTziToTimezoneRule( year, year_tzi ) );
+        }
+
+        RegCloseKey( dynamic_key );
+    }
+    else if( success )
+    {
+        rules.push_back( RegTziToTimezoneRule( 0, tzi ) );
+    }
+
+    RegCloseKey( key );
+
+    if( !success )
+        rules.clear();
+
+    return success;
+}
+
+
+
+bool GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year,
+    const TimezoneRules &zone
+)
+{
+    if( !IsYearValid( year ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    const TimezoneRule *rule = FindTimezoneRuleForYear( zone, year );
+    if( !rule || !TimezoneRuleToTimezoneInfo( zone, *rule, tzi ) )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneRules &zone
+)
+{
+    const RulesTimezoneProvider provider( zone );
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, &provider );
+}
+
+
+
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider &provider
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, &provider );
+}
+
+
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider &provider
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, &provider );
+}
+
+
+
+bool CurrentTimezoneProvider::GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year
+) const
+{
+    return jay::time::GetTimezoneForYear( tzi, year );
+}
+
+
+
+const TimezoneProvider *SetTimezoneProvider( const TimezoneProvider *provider )
+{
+    return (const TimezoneProvider *)InterlockedExchangePointer(
+        (PVOID volatile *)&timezone_provider, (PVOID)provider );
+}
+
+
+
+void CachedTimezoneProvider::Lock() const
+{
+    while( InterlockedCompareExchange( &_lock, 1, 0 ) )
+        Sleep( 0 );
+}
+
+
+void CachedTimezoneProvider::Unlock() const
+{
+    InterlockedExchange( &_lock, 0 );
+}
+
+
+bool CachedTimezoneProvider::GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year
+) const
+{
+    bool found = false;
+
+    Lock();
+    map<unsigned, TIME_ZONE_INFORMATION>::const_iterator it = _cache.find( year );
+    if( it != _cache.end() )
+    {
+        tzi = it->second;
+        found = true;
+    }
+    Unlock();
+
+    if( found )
+        return true;
+
+    // the source is called without holding the lock
+    if( !_source.GetTimezoneForYear( tzi, year ) )
+        return false;
+
+    Lock();
+    _cache[ year ] = tzi;
+    Unlock();
+
+    return true;
+}
+
+
+void CachedTimezoneProvider::Clear()
+{
+    Lock();
+    _cache.clear();
+    Unlock();
+}
+
+
+
+bool MemoryTimezoneProvider::GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year
+) const
+{
+    if( !IsYearValid( year ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    if( _table.empty() )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    // the last entry that begins on or before 'year', or the first entry if there is none
+    map<unsigned, TIME_ZONE_INFORMATION>::const_iterator it = _table.upper_bound( year );
+    if( it != _table.begin() )
+        --it;
+
+    tzi = it->second;
+    return true;
+}
+
+
+bool MemoryTimezoneProvider::Set( const unsigned year, const TIME_ZONE_INFORMATION &tzi )
+{
+    if( !IsTimezoneInfoValid( tzi, true ) )
+        return false;
+
+    _table[ year ] = tzi;
+    return true;
+}
+
+
+
+Timezone::Timezone( const std::wstring &key_name, const bool fixed ) :
+    _key_name( key_name ),
+    _fixed( fixed ),
+    _data( NULL )
+{
+}
+
+
+// Only called for a handle that was never cached, so no reader can be using its data
+Timezone::~Timezone()
+{
+    delete _data;
+}
+
+
+void Timezone::Publish(
+    const std::wstring &standard_name,
+    const std::wstring &daylight_name,
+    const std::vector<TimezoneRule> &rules
+)
+{
+    Data *data = new Data;
+    data->standard_name = standard_name;
+    data->daylight_name = daylight_name;
+    data->rule_storage = rules;
+
+    data->rules.key_name = _key_name.c_str();
+    data->rules.standard_name = data->standard_name.c_str();
+    data->rules.daylight_name = data->daylight_name.c_str();
+    data->rules.rules = ( data->rule_storage.empty() ? NULL : &data->rule_storage[ 0 ] );
+    data->rules.count = data->rule_storage.size();
+
+    /* The data that was replaced isn't freed because a reader could still be using it and readers
+    aren't tracked. It's only replaced when the timezone information changes.
+    */
+    InterlockedExchangePointer( (PVOID volatile *)&_data, (PVOID)data );
+}
+
+
+const Timezone *Timezone::Find( const std::wstring &key_name )
+{
+    const Timezone *tz = NULL;
+
+    LockTimezoneCache();
+    if( timezone_cache )
+    {
+        TimezoneCache::const_iterator it = timezone_cache->find( key_name );
+        if( it != timezone_cache->end() )
+            tz = it->second;
+    }
+    UnlockTimezoneCache();
+
+    if( tz )
+        return tz;
+
+    /* The zone isn't cached. Its rules are read without holding the lock. If another thread caches
+    the same zone in the meantime then that handle is returned and this one is discarded.
+    */
+    Timezone *new_tz = NULL;
+
+    const TimezoneRules *embedded = FindEmbeddedTimezone( key_name.c_str() );
+    if( embedded )
+    {
+        new_tz = new Timezone( embedded->key_name, true );
+        new_tz->Publish( embedded->standard_name, embedded->daylight_name,
+            vector<TimezoneRule>( embedded->rules, embedded->rules + embedded->count ) );
+    }
+    else
+    {
+        wstring standard_name, daylight_name;
+        vector<TimezoneRule> rules;
+
+        if( !ReadTimezoneRulesFromRegistry( key_name, standard_name, daylight_name, rules ) )
+            return NULL;
+
+        new_tz = new Timezone( key_name, false );
+        new_tz->Publish( standard_name, daylight_name, rules );
+    }
+
+    LockTimezoneCache();
+    if( !timezone_cache )
+        timezone_cache = new TimezoneCache;
+
+    pair<TimezoneCache::iterator, bool> ret =
+        timezone_cache->insert( TimezoneCache::value_type( key_name, new_tz ) );
+    tz = ret.first->second;
+    UnlockTimezoneCache();
+
+    if( !ret.second )
+        delete new_tz;
+
+    return tz;
+}
+
+
+const Timezone *Timezone::Add( const TimezoneRules &zone )
+{
+    if( !zone.key_name || !*zone.key_name || !zone.standard_name || !zone.daylight_name
+        || !zone.rules || !zone.count
+    )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return NULL;
+    }
+
+    const wstring key_name( zone.key_name );
+    const vector<TimezoneRule> rules( zone.rules, zone.rules + zone.count );
+
+    // a new handle is published before it's cached since Find() may return it right away
+    Timezone *new_tz = new Timezone( key_name, true );
+    new_tz->Publish( zone.standard_name, zone.daylight_name, rules );
+
+    LockTimezoneCache();
+    if( !timezone_cache )
+        timezone_cache = new TimezoneCache;
+
+    pair<TimezoneCache::iterator, bool> ret =
+        timezone_cache->insert( TimezoneCache::value_type( key_name, new_tz ) );
+    Timezone *tz = ret.first->second;
+    tz->_fixed = true;
+    UnlockTimezoneCache();
+
+    if( !ret.second )
+    {
+        delete new_tz;
+        tz->Publish( zone.standard_name, zone.daylight_name, rules );
+    }
+
+    return tz;
+}
+
+
+bool Timezone::ReloadAll()
+{
+    // Handles are never removed from the cache so they can be used after the lock is released
+    vector<Timezone *> handles;
+
+    LockTimezoneCache();
+    if( timezone_cache )
+    {
+        for( TimezoneCache::const_iterator it = timezone_cache->begin();
+            it != timezone_cache->end();
+            ++it
+        )
+        {
+            if( !it->second->_fixed )
+                handles.push_back( it->second );
+        }
+    }
+    UnlockTimezoneCache();
+
+    bool success = true;
+    DWORD gle = 0;
+
+    for( size_t i = 0; i < handles.size(); ++i )
+    {
+        wstring standard_name, daylight_name;
+        vector<TimezoneRule> rules;
+
+        const bool read = ReadTimezoneRulesFromRegistry( handles[ i ]->_key_name, standard_name,
+            daylight_name, rules );
+        const DWORD read_error = ( read ? 0 : GetLastError() );
+
+        /* Add() may have replaced the zone's rules since the handles were collected. That's
+        checked again under the lock, and the rules read are published under it, so they're never
+        published over rules that were added.
+        */
+        LockTimezoneCache();
+        const bool fixed = handles[ i ]->_fixed;
+        if( read && !fixed )
+            handles[ i ]->Publish( standard_name, daylight_name, rules );
+        UnlockTimezoneCache();
+
+        if( !read && !fixed && success )
+        {
+            gle = read_error;
+            success = false;
+        }
+    }
+
+    if( !success )
+        SetLastError( gle );
+
+    return success;
+}
+
+
+bool Timezone::GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const
+{
+    return jay::time::GetTimezoneForYear( tzi, year, GetRules() );
+}
+
+
+
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const Timezone &tz
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, &tz );
+}
+
+
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const Timezone &tz
+)
+{
+    return UTCTimeToLocalTimeForZone( utc_st, local_time, tzi_id, tzi, &tz );
+}
+
+
+
+namespace {
+
+const LONGLONG ticks_per_minute = 10000LL * 1000 * 60;
+const LONGLONG ticks_per_day = ticks_per_minute * 60 * 24;
+
+
+// The ticks of a valid SYSTEMTIME (refer to FileTimeToTicks())
+LONGLONG SystemTimeToTicks( const SYSTEMTIME &st )
+{
+    const LONGLONG ms = ( ( ( ( st.wHour * 60LL ) + st.wMinute ) * 60 ) + st.wSecond ) * 1000
+        + st.wMilliseconds;
+
+    return ( (LONGLONG)DateToDays( st.wDay, st.wMonth, st.wYear ) * ticks_per_day )
+        + ( ms * 10000 );
+}
+
+} // anonymous namespace
+
+
+PreparedTimezone::PreparedTimezone() :
+    _tz( NULL ),
+    _year( 0 ),
+    _tzi(),
+    _begin( 0 ),
+    _end( 0 ),
+    _transition_begin( 0 ),
+    _transition_end( 0 ),
+    _inside_id( TIME_ZONE_ID_UNKNOWN ),
+    _outside_id( TIME_ZONE_ID_UNKNOWN )
+{
+}
+
+
+bool PreparedTimezone::Prepare( const unsigned year )
+{
+    return PrepareZone( year, NULL );
+}
+
+
+bool PreparedTimezone::Prepare( const unsigned year, const Timezone &tz )
+{
+    return PrepareZone( year, &tz );
+}
+
+
+bool PreparedTimezone::PrepareZone( const unsigned year, const Timezone *tz )
+{
+    *this = PreparedTimezone();
+
+    if( !IsYearValid( year ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    TIME_ZONE_INFORMATION tzi = {};
+    ValidTimezone valid_tzi;
+
+    if( !GetTimezoneForYearFromProvider( tzi, year, tz )
+        || !ValidTimezone::Create( tzi, valid_tzi )
+    )
+        return false;
+
+    const LONGLONG standard_bias = tzi.Bias + tzi.StandardBias;
+    const LONGLONG daylight_bias = tzi.Bias + tzi.DaylightBias;
+    const LONGLONG min_bias = min( (LONGLONG)tzi.Bias, min( standard_bias, daylight_bias ) );
+    const LONGLONG max_bias = max( (LONGLONG)tzi.Bias, max( standard_bias, daylight_bias ) );
+
+    /* The UTC times that aren't January 1 or December 31 and whose local time is in the year for
+    every bias. UTCTimeToLocalTime() uses this year's timezone information for all of them.
+    */
+    const LONGLONG year_begin = (LONGLONG)DateToDays( 1, 1, year ) * ticks_per_day;
+    const LONGLONG year_end = year_begin + ( ( IsLeapYear( year ) ? 366 : 365 ) * ticks_per_day );
+    const LONGLONG begin =
+        max( year_begin + ticks_per_day, year_begin + ( max_bias * ticks_per_minute ) );
+    const LONGLONG end =
+        min( year_end - ticks_per_day, year_end + ( min_bias * ticks_per_minute ) );
+
+    DWORD inside_id = TIME_ZONE_ID_UNKNOWN, outside_id = TIME_ZONE_ID_UNKNOWN;
+    LONGLONG transition_begin = 0, transition_end = 0;
+    SYSTEMTIME standard_start = {}, daylight_start = {};
+
+    /* The same determination as GetLocalTimeForTimezone(). The start of DST is a local standard
+    time and the start of standard time is a local daylight time.
+    */
+    if( TimezoneTimeToLocalTime( tzi.StandardDate, year, standard_start )
+        && TimezoneTimeToLocalTime( tzi.DaylightDate, year, daylight_start )
+    )
+    {
+        const LONGLONG utc_daylight_start =
+            SystemTimeToTicks( daylight_start ) + ( standard_bias * ticks_per_minute );
+        const LONGLONG utc_standard_start =
+            SystemTimeToTicks( standard_start ) + ( daylight_bias * ticks_per_minute );
+        const int cmp_standard_start_to_daylight_start =
+            CompareSystemTimes( standard_start, daylight_start );
+
+        if( cmp_standard_start_to_daylight_start > 0 )
+        {
+            transition_begin = utc_daylight_start;
+            transition_end = utc_standard_start;
+            inside_id = TIME_ZONE_ID_DAYLIGHT;
+            outside_id = TIME_ZONE_ID_STANDARD;
+        }
+        else if( cmp_standard_start_to_daylight_start < 0 )
+        {
+            transition_begin = utc_standard_start;
+            transition_end = utc_daylight_start;
+            inside_id = TIME_ZONE_ID_STANDARD;
+            outside_id = TIME_ZONE_ID_DAYLIGHT;
+        }
+        else if( tzi.DaylightBias ) // DST is year round
+        {
+            outside_id = TIME_ZONE_ID_DAYLIGHT;
+        }
+    }
+
+    // no UTC time is in an empty or negative range
+    if( transition_begin < 0 )
+        transition_begin = 0;
+
+    if( transition_end < transition_begin )
+        transition_end = transition_begin;
+
+    _tz = tz;
+    _year = year;
+    _tzi = tzi;
+    _begin = (ULONGLONG)begin;
+    _end = (ULONGLONG)( ( end < begin ) ? begin : end );
+    _transition_begin = (ULONGLONG)transition_begin;
+    _transition_end = (ULONGLONG)transition_end;
+    _inside_id = inside_id;
+    _outside_id = outside_id;
+    return true;
+}
+
+
+
+namespace {
+
+/* LocalTimeResolver
+- Resolve local times in a year to UTC times.
+
+The timezone information and transitions for the year are retrieved and calculated once by
+SetYear(). Resolve() then only compares and adds.
+
+'standard_start' is in local daylight time and 'daylight_start' is in local standard time, the same
+as StandardDate and DaylightDate. Refer to GetLocalTimeForTimezone().
+*/
+class LocalTimeResolver
+{
+public:
+    LocalTimeResolver() : _year( 0 ), _valid( false ), _error( 0 ) {}
+
+    unsigned GetYear() const { return _year; }
+
+    // [ret][failure] (false) : The year could not be set. The error code is set again each call.
+    bool SetYear( const unsigned year, const TimezoneProvider *provider )
+    {
+        _year = year;
+        _valid = false;
+        _error = ERROR_INVALID_TIME;
+
+        if( !GetTimezoneForYearFromProvider( _tzi, year, provider ) )
+        {
+            if( GetLastError() )
+                _error = GetLastError();
+            SetLastError( _error );
+            return false;
+        }
+
+        if( !IsTimezoneInfoValid( _tzi, true ) )
+        {
+            SetLastError( _error );
+            return false;
+        }
+
+        _cmp_standard_start_to_daylight_start = 0;
+        _has_transitions =
+            TimezoneTimeToLocalTime( _tzi.StandardDate, year, _standard_start )
+            && TimezoneTimeToLocalTime( _tzi.DaylightDate, year, _daylight_start );
+
+        if( _has_transitions )
+        {
+            _cmp_standard_start_to_daylight_start =
+                CompareSystemTimes_IgnoreDayOfWeek( _standard_start, _daylight_start );
+        }
+
+        _valid = true;
+        _error = 0;
+        return true;
+    }
+
+    bool Resolve(
+        const SYSTEMTIME &local_time,
+        SYSTEMTIME &utc_st,
+        DWORD &tzi_id,
+        const LocalTimePolicy nonexistent,
+        const LocalTimePolicy ambiguous
+    ) const
+    {
+        if( !_valid )
+        {
+            SetLastError( _error );
+            return false;
+        }
+
+        if( !IsSystemTimeValid_IgnoreDayOfWeek( local_time ) || ( local_time.wYear != _year ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        SYSTEMTIME local = local_time;
+        local.wDayOfWeek = GetDayOfWeek( local.wDay, local.wMonth, local.wYear );
+
+        const long standard_bias = _tzi.Bias + _tzi.StandardBias;
+        const long daylight_bias = _tzi.Bias + _tzi.DaylightBias;
+        long bias = 0;
+
+        if( !_cmp_standard_start_to_daylight_start )
+        {
+            // Same as GetLocalTimeForTimezone(): DST is year round, not observed or auto-DST is off
+            if( _has_transitions && _tzi.DaylightBias )
+            {
+                tzi_id = TIME_ZONE_ID_DAYLIGHT;
+                bias = daylight_bias;
+            }
+            else
+            {
+                tzi_id = TIME_ZONE_ID_UNKNOWN;
+                bias = _tzi.Bias;
+            }
+        }
+        else
+        {
+            // the minutes the clocks are set forward at the start of DST
+            const long delta = _tzi.StandardBias - _tzi.DaylightBias;
+
+            SYSTEMTIME local_plus_delta = local, local_minus_delta = local;
+            if( !SystemTimeAddMinutes( local_plus_delta, delta )
+                || !SystemTimeSubtractMinutes( local_minus_delta, delta )
+            )
+            {
+                SetLastError( ERROR_INVALID_TIME );
+                return false;
+            }
+
+            /* 'local' as standard time is valid if the UTC time it would be is in standard time,
+            and 'local' as daylight time is valid if the UTC time it would be is in daylight time.
+            */
+            const bool standard_valid = !IsDaylight( local, local_plus_delta );
+            const bool daylight_valid = IsDaylight( local_minus_delta, local );
+
+            bool use_standard = standard_valid;
+
+            if( standard_valid == daylight_valid )
+            {
+                // both valid: ambiguous. neither valid: nonexistent.
+                const LocalTimePolicy policy = ( standard_valid ? ambiguous : nonexistent );
+                const bool standard_is_earlier = ( standard_bias < daylight_bias );
+
+                switch( policy )
+                {
+                case LOCAL_TIME_EARLIER:
+                    use_standard = standard_is_earlier;
+                    break;
+                case LOCAL_TIME_LATER:
+                    use_standard = !standard_is_earlier;
+                    break;
+                case LOCAL_TIME_SHIFT:
+                    if( standard_valid ) // ambiguous, same as LOCAL_TIME_LATER
+                    {
+                        use_standard = !standard_is_earlier;
+                        break;
+                    }
+
+                    // nonexistent. the UTC time is the transition at the start of the gap.
+                    if( delta > 0 )
+                    {
+                        utc_st = _daylight_start;
+                        tzi_id = TIME_ZONE_ID_DAYLIGHT;
+                        bias = standard_bias;
+                    }
+                    else
+                    {
+                        utc_st = _standard_start;
+                        tzi_id = TIME_ZONE_ID_STANDARD;
+                        bias = daylight_bias;
+                    }
+
+                    if( !SystemTimeAddMinutes( utc_st, bias ) )
+                    {
+                        SetLastError( ERROR_INVALID_TIME );
+                        return false;
+                    }
+
+                    return true;
+                default:
+                    SetLastError( ERROR_INVALID_TIME );
+                    return false;
+                }
+            }
+
+            /* The ID is of the UTC time. For a nonexistent time the bias applied is not valid for
+            the UTC time it gives, so that time is in the other of standard and daylight time.
+            */
+            const bool is_standard = ( use_standard ? standard_valid : !daylight_valid );
+
+            tzi_id = ( is_standard ? TIME_ZONE_ID_STANDARD : TIME_ZONE_ID_DAYLIGHT );
+            bias = ( use_standard ? standard_bias : daylight_bias );
+        }
+
+        utc_st = local;
+        if( !SystemTimeAddMinutes( utc_st, bias ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        return true;
+    }
+
+private:
+    // The same determination as GetLocalTimeForTimezone() for the candidate local times of a UTC
+    // time
+    bool IsDaylight(
+        const SYSTEMTIME &local_if_standard,
+        const SYSTEMTIME &local_if_daylight
+    ) const
+    {
+        const bool is_standard_time_before_daylight_start =
+            ( CompareSystemTimes_IgnoreDayOfWeek( local_if_standard, _daylight_start ) < 0 );
+
+        const bool is_daylight_time_before_standard_start =
+            ( CompareSystemTimes_IgnoreDayOfWeek( local_if_daylight, _standard_start ) < 0 );
+
+        if( _cmp_standard_start_to_daylight_start < 0 )
+        {
+            return !( !is_daylight_time_before_standard_start
+                && is_standard_time_before_daylight_start );
+        }
+        else
+        {
+            return ( !is_standard_time_before_daylight_start
+                && is_daylight_time_before_standard_start );
+        }
+    }
+
+    unsigned _year;
+    bool _valid;
+    DWORD _error;
+    TIME_ZONE_INFORMATION _tzi;
+    bool _has_transitions;
+    int _cmp_standard_start_to_daylight_start;
+    SYSTEMTIME _standard_start, _daylight_start;
+};
+
+
+bool LocalTimeToUTCTimeForZone(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider *provider
+)
+{
+    if( !IsSystemTimeValid_IgnoreDayOfWeek( local_time ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    LocalTimeResolver resolver;
+
+    return resolver.SetYear( local_time.wYear, provider )
+        && resolver.Resolve( local_time, utc_st, tzi_id, nonexistent, ambiguous );
+}
+
+
+bool LocalTimesToUTCTimesForZone(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider *provider
+)
+{
+    LocalTimeResolver resolver;
+    bool year_set = false;
+    DWORD error = 0;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        DWORD tzi_id = 0;
+        bool success = IsSystemTimeValid_IgnoreDayOfWeek( local_times[ i ] );
+
+        if( !success )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+        }
+        else
+        {
+            // the transitions are only calculated again when the year changes
+            if( !year_set || ( resolver.GetYear() != local_times[ i ].wYear ) )
+            {
+                resolver.SetYear( local_times[ i ].wYear, provider );
+                year_set = true;
+            }
+
+            success = resolver.Resolve( local_times[ i ], utc_times[ i ], tzi_id, nonexistent,
+                ambiguous );
+        }
+
+        if( !success )
+        {
+            if( !error )
+                error = GetLastError();
+
+            ZeroMemory( &utc_times[ i ], sizeof( utc_times[ i ] ) );
+        }
+    }
+
+    if( error )
+    {
+        SetLastError( error );
+        return false;
+    }
+
+    return true;
+}
+
+
+// LocalTimeAdd() for 'provider', or for the current timezone if 'provider' is NULL
+bool LocalTimeAddForZone(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &result,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const long long amount,
+    const TimeUnit unit,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider *provider
+)
+{
+    if( ( unit < TIME_UNIT_MILLISECONDS ) || ( unit > TIME_UNIT_YEARS )
+        || ( ( arithmetic != LOCAL_TIME_WALL_CLOCK ) && ( arithmetic != LOCAL_TIME_ELAPSED ) )
+        || ( ( arithmetic == LOCAL_TIME_ELAPSED ) && ( unit >= TIME_UNIT_MONTHS ) )
+    )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    if( !IsSystemTimeValid_IgnoreDayOfWeek( local_time ) )
+    {
+        SetLastError( ERROR_INVALID_TIME );
+        return false;
+    }
+
+    // SystemTimeAdd() checks the day of the week, which is ignored in 'local_time'
+    SYSTEMTIME local = local_time;
+    local.wDayOfWeek = GetDayOfWeek( local.wDay, local.wMonth, local.wYear );
+
+    SYSTEMTIME utc = {};
+    DWORD id = 0;
+
+    if( arithmetic == LOCAL_TIME_WALL_CLOCK )
+    {
+        if( !SystemTimeAdd( local, amount, unit ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+
+        if( !LocalTimeToUTCTimeForZone( local, utc, id, nonexistent, ambiguous, provider ) )
+            return false;
+    }
+    else
+    {
+        if( !LocalTimeToUTCTimeForZone( local, utc, id, nonexistent, ambiguous, provider ) )
+            return false;
+
+        if( !SystemTimeAdd( utc, amount, unit ) )
+        {
+            SetLastError( ERROR_INVALID_TIME );
+            return false;
+        }
+    }
+
+    // the local time of the UTC time, which differs if the result was nonexistent and shifted
+    TIME_ZONE_INFORMATION tzi;
+    if( !UTCTimeToLocalTimeForZone( utc, local, id, tzi, provider ) )
+        return false;
+
+    result = local;
+    utc_st = utc;
+    tzi_id = id;
+    return true;
+}
+
+} // anonymous namespace
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+)
+{
+    return LocalTimeToUTCTimeForZone( local_time, utc_st, tzi_id, nonexistent, ambiguous, NULL );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const Timezone &tz
+)
+{
+    return LocalTimeToUTCTimeForZone( local_time, utc_st, tzi_id, nonexistent, ambiguous, &tz );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneRules &zone
+)
+{
+    const RulesTimezoneProvider provider( zone );
+    return LocalTimeToUTCTimeForZone( local_time, utc_st, tzi_id, nonexistent, ambiguous,
+        &provider );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+)
+{
+    return LocalTimeToUTCTimeForZone( local_time, utc_st, tzi_id, nonexistent, ambiguous,
+        &provider );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+)
+{
+    return LocalTimesToUTCTimesForZone( local_times, utc_times, count, nonexistent, ambiguous,
+        NULL );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const Timezone &tz
+)
+{
+    return LocalTimesToUTCTimesForZone( local_times, utc_times, count, nonexistent, ambiguous,
+        &tz );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneRules &zone
+)
+{
+    const RulesTimezoneProvider provider( zone );
+    return LocalTimesToUTCTimesForZone( local_times, utc_times, count, nonexistent, ambiguous,
+        &provider );
+}
+
+
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+)
+{
+    return LocalTimesToUTCTimesForZone( local_times, utc_times, count, nonexistent, ambiguous,
+        &provider );
+}
+
+
+
+bool LocalTimeAdd(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &result,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const long long amount,
+    const TimeUnit unit,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+)
+{
+    return LocalTimeAddForZone( local_time, result, utc_st, tzi_id, amount, unit, arithmetic,
+        nonexistent, ambiguous, NULL );
+}
+
+
+bool LocalTimeAdd(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &result,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const long long amount,
+    const TimeUnit unit,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+)
+{
+    return LocalTimeAddForZone( local_time, result, utc_st, tzi_id, amount, unit, arithmetic,
+        nonexistent, ambiguous, &provider );
+}
+
+
+
+bool StartTimezoneWatcher()
+{
+    LockTimezoneWatcher();
+
+    if( timezone_watcher )
+    {
+        /* The thread exits on its own if a registry notification can't be requested or the wait
+        fails. In that case nothing is watching so it's cleaned up and a new watcher is started.
+        */
+        if( WaitForSingleObject( timezone_watcher->thread, 0 ) == WAIT_TIMEOUT )
+        {
+            UnlockTimezoneWatcher();
+            return true;
+        }
+
+        CloseTimezoneWatcher( timezone_watcher );
+        timezone_watcher = NULL;
+    }
+
+    TimezoneWatcher *watcher = new TimezoneWatcher();
+    LONG ret = ERROR_SUCCESS;
+
+    // a manual reset event to stop the thread and auto reset events for the registry notifications
+    watcher->events[ 0 ] = CreateEventW( NULL, TRUE, FALSE, NULL );
+    watcher->events[ 1 ] = CreateEventW( NULL, FALSE, FALSE, NULL );
+    watcher->events[ 2 ] = CreateEventW( NULL, FALSE, FALSE, NULL );
+
+    if( !watcher->events[ 0 ] || !watcher->events[ 1 ] || !watcher->events[ 2 ] )
+        ret = (LONG)GetLastError();
+
+    if( ret == ERROR_SUCCESS )
+    {
+        ret = RegOpenKeyExW( HKEY_LOCAL_MACHINE,
+            L"SYSTEM\\CurrentControlSet\\Control\\TimeZoneInformation", 0, KEY_NOTIFY,
+            &watcher->keys[ 0 ] );
+    }
+
+    if( ret == ERROR_SUCCESS )
+    {
+        // without the trailing backslash
+        const wstring time_zones_key( time_zones_subkey,
+            ( sizeof( time_zones_subkey ) / sizeof( wchar_t ) ) - 2 );
+
+        ret = RegOpenKeyExW( HKEY_LOCAL_MACHINE, time_zones_key.c_str(), 0, KEY_NOTIFY,
+            &watcher->keys[ 1 ] );
+    }
+
+    if( ret == ERROR_SUCCESS )
+    {
+        watcher->thread = CreateThread( NULL, 0, TimezoneWatcherThread, watcher, 0, NULL );
+        if( !watcher->thread )
+            ret = (LONG)GetLastError();
+    }
+
+    if( ret != ERROR_SUCCESS )
+    {
+        CloseTimezoneWatcher( watcher );
+        UnlockTimezoneWatcher();
+        SetLastError( (DWORD)ret );
+        return false;
+    }
+
+    timezone_watcher = watcher;
+    UnlockTimezoneWatcher();
+    return true;
+}
+
+
+void StopTimezoneWatcher()
+{
+    LockTimezoneWatcher();
+
+    if( timezone_watcher )
+    {
+        SetEvent( timezone_watcher->events[ 0 ] );
+        WaitForSingleObject( timezone_watcher->thread, INFINITE );
+
+        CloseTimezoneWatcher( timezone_watcher );
+        timezone_watcher = NULL;
+    }
+
+    UnlockTimezoneWatcher();
+}
+
+
+
+
+bool PosixTZToTimezoneInfo( const char *tz, TIME_ZONE_INFORMATION &tzi )
+{
+    if( !tz )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    // the meaning of a TZ string that begins with ':' is implementation defined, usually a file
+    if( *tz == ':' )
+    {
+        SetLastError( ERROR_NOT_SUPPORTED );
+        return false;
+    }
+
+    PosixTZParser parser( tz );
+    wstring standard_name, daylight_name;
+    long standard_offset = 0, daylight_offset = 0;
+    TIME_ZONE_INFORMATION temp = {};
+
+    if( !parser.ParseName( standard_name ) || !parser.ParseOffset( standard_offset ) )
+    {
+        SetLastError( parser.GetError() );
+        return false;
+    }
+
+    temp.Bias = standard_offset;
+
+    if( parser.AtEnd() )
+    {
+        // DST is not observed
+        daylight_name = standard_name;
+    }
+    else
+    {
+        if( !parser.ParseName( daylight_name ) )
+        {
+            SetLastError( parser.GetError() );
+            return false;
+        }
+
+        daylight_offset = standard_offset - 60;
+
+        if( !parser.AtEnd() && !parser.Peek( ',' ) && !parser.ParseOffset( daylight_offset ) )
+        {
+            SetLastError( parser.GetError() );
+            return false;
+        }
+
+        temp.DaylightBias = daylight_offset - standard_offset;
+
+        if( parser.AtEnd() )
+        {
+            // the US rules, the same default as most POSIX systems: M3.2.0,M11.1.0
+            PosixTZParser( "M3.2.0" ).ParseRule( temp.DaylightDate );
+            PosixTZParser( "M11.1.0" ).ParseRule( temp.StandardDate );
+        }
+        else if( !parser.Accept( ',' ) || !parser.ParseRule( temp.DaylightDate )
+            || !parser.Accept( ',' ) || !parser.ParseRule( temp.StandardDate )
+            || !parser.AtEnd()
+        )
+        {
+            SetLastError( parser.GetError() );
+            return false;
+        }
+    }
+
+    wcscpy( temp.StandardName, standard_name.c_str() );
+    wcscpy( temp.DaylightName, daylight_name.c_str() );
+
+    if( !IsTimezoneInfoValid( temp, true ) )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    tzi = temp;
+    return true;
+}
+
+
+
+bool GetTimezoneInfoFromTZEnvironment( TIME_ZONE_INFORMATION &tzi )
+{
+    DWORD size = GetEnvironmentVariableA( "TZ", NULL, 0 );
+    if( !size )
+        return false;
+
+    // 'buf' is zero initialized so an empty variable is an empty string
+    vector<char> buf( size );
+    DWORD len = GetEnvironmentVariableA( "TZ", &buf[ 0 ], size );
+    if( len >= size )
+    {
+        // the variable was changed between the calls
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    return PosixTZToTimezoneInfo( &buf[ 0 ], tzi );
+}
+
 } // namespace time
 } // namespace jay
@@ -44,8 +44,13 @@ GetTimezoneForYear() and UTCTimeToLocalTime().
 #ifndef _JAY_TIME_TIMEZONE_HPP
 #define _JAY_TIME_TIMEZONE_HPP
 
+#include "time.hpp"
+
 #include <windows.h>
 
+#include <string>
+#include <vector>
+#include <map>
 #include <iostream>
 
 
@@ -146,6 +151,43 @@ bool IsTimezoneInfoValid(
 );
 
 
+/* class ValidTimezone
+- A TIME_ZONE_INFORMATION that is known to be valid.
+
+This is the same as ValidSystemTime in time.hpp for timezone information. It's checked by
+IsTimezoneInfoValid() with 'allow_ignored_dates', which is what GetLocalTimeForTimezone() accepts,
+so the GetLocalTimeForTimezone() overload that takes it and a ValidSystemTime checks neither. The
+default is all zeroes, which is valid (UTC).
+*/
+class ValidTimezone
+{
+public:
+    /* ValidTimezone::Create()
+    - Make a ValidTimezone from a TIME_ZONE_INFORMATION if it's valid.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_DATA : 'tzi' is invalid.
+    ######
+
+    [in] 'tzi' : Timezone information
+    [out] 'valid' : The timezone information. It's not modified on failure.
+    [ret][failure] (false) : 'tzi' is invalid. An error code was set.
+    [ret][success] (true) : 'valid' is 'tzi'
+    */
+    static bool Create( const TIME_ZONE_INFORMATION &tzi, ValidTimezone &valid );
+
+    const TIME_ZONE_INFORMATION &Get() const { return _tzi; }
+    operator const TIME_ZONE_INFORMATION &() const { return _tzi; }
+
+    ValidTimezone() : _tzi() {}
+
+private:
+    TIME_ZONE_INFORMATION _tzi;
+};
+
+
 /* LocalTimeToRelativeTimezoneTime()
 - Convert a local time to a relative timezone time (StandardDate/DaylightDate).
 
@@ -219,6 +261,10 @@ int CompareLocalTimeToTimezoneTime( const SYSTEMTIME &local, const SYSTEMTIME &t
 This is a wrapper for the WinAPI get TimeZone calls. 'tzi' will receive timezone information from
 ::GetTimeZoneInformationForYear(), ::GetDynamicTimeZoneInformation() or ::GetTimeZoneInformation().
 
+That is OSTimezoneProvider, the default timezone provider. If the default provider was changed by
+SetTimezoneProvider() then 'tzi' receives timezone information from that provider instead. Refer to
+the comment block above the TimezoneProvider class declaration.
+
 DST transition times in a timezone can vary from year to year. Microsoft calls this "dynamic"
 timezone information. Windows versions < Vista SP1 may receive dynamic timezone information updates
 but likely will not have the supporting ::GetTimeZoneInformationForYear() to access that
@@ -356,6 +402,20 @@ DWORD GetLocalTimeForTimezone(
 );
 DWORD GetLocalTimeForTimezone( SYSTEMTIME &local_time, const TIME_ZONE_INFORMATION &tzi );
 
+/* GetLocalTimeForTimezone()
+- Overload for valid timezone information and a valid UTC time.
+
+This is the same as the original overload except neither is checked, nor are the candidate local
+times calculated from them.
+*/
+DWORD GetLocalTimeForTimezone(
+    SYSTEMTIME &local_time,
+    const ValidTimezone &tzi,
+    const ValidSystemTime &utc_st,
+    unsigned tzi_year = 0, // default: utc_st.wYear
+    const bool strict = false
+);
+
 
 /* UTCTimeToLocalTime()
 - Get the local time, timezone and timezone ID for a UTC time.
@@ -401,6 +461,878 @@ bool UTCTimeToLocalTime(
 bool UTCTimeToLocalTime( const SYSTEMTIME &utc_st, SYSTEMTIME &local_time, DWORD &tzi_id );
 bool UTCTimeToLocalTime( const SYSTEMTIME &utc_st, SYSTEMTIME &local_time );
 
+
+/* struct TimezoneRule
+- The timezone information for a zone beginning with a year.
+
+The members after 'year' are in the order of REG_TZI_FORMAT, which is how Windows stores the "TZI"
+value and the "Dynamic DST" year values for each zone in the registry:
+HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Windows NT\CurrentVersion\Time Zones\<zone>
+
+This is a POD type so that tables of rules can be constant initialized and compiled into a program.
+*/
+struct TimezoneRule
+{
+    // The first year the rule applies to, or 0 if the zone has no "Dynamic DST" entries.
+    unsigned year;
+
+    LONG Bias;
+    LONG StandardBias;
+    LONG DaylightBias;
+    SYSTEMTIME StandardDate;
+    SYSTEMTIME DaylightDate;
+};
+
+
+/* struct TimezoneRules
+- A zone's names and its rules, sorted by year in ascending order.
+
+This is a POD type that does not own what it points to. The rules may be in a table compiled into
+the program (refer to timezone_embedded.hpp) or in storage owned by some other object.
+*/
+struct TimezoneRules
+{
+    // The Windows registry key name of the zone, eg "Eastern Standard Time"
+    const WCHAR *key_name;
+
+    // The names copied to TIME_ZONE_INFORMATION StandardName/DaylightName
+    const WCHAR *standard_name;
+    const WCHAR *daylight_name;
+
+    const TimezoneRule *rules;
+    size_t count;
+};
+
+
+/* FindTimezoneRuleForYear()
+- Find a zone's rule for the closest available and appropriate year.
+
+This is the same selection made by ::GetTimeZoneInformationForYear() from a zone's "Dynamic DST"
+entries: If 'year' is before the first rule then the first rule is found. Otherwise the last rule
+that begins on or before 'year' is found. For more information refer to the comment block above the
+GetTimezoneForYear() declaration.
+
+The rules are binary searched.
+
+[in] 'zone' : The zone's rules
+[in] 'year' : The year requested, expressed as a local time value
+[ret][failure] (NULL) : 'year' is invalid or 'zone' has no rules
+[ret][success] (const TimezoneRule *) : The rule for the closest available and appropriate year
+*/
+const TimezoneRule *FindTimezoneRuleForYear( const TimezoneRules &zone, const unsigned year );
+
+
+/* TimezoneRuleToTimezoneInfo()
+- Copy a zone's rule and names to a TIME_ZONE_INFORMATION.
+
+[in] 'zone' : The zone's names
+[in] 'rule' : One of the zone's rules
+[out] 'tzi' : Timezone information
+[ret][failure] (false) : A name is too long or the timezone information is invalid
+[ret][success] (true) : Timezone information was output
+*/
+bool TimezoneRuleToTimezoneInfo(
+    const TimezoneRules &zone,
+    const TimezoneRule &rule,
+    TIME_ZONE_INFORMATION &tzi
+);
+
+
+/* ReadTimezoneRulesFromRegistry()
+- Read a zone's names and rules from the Windows registry.
+
+The zone is read from:
+HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Windows NT\CurrentVersion\Time Zones\<key_name>
+
+If the zone has "Dynamic DST" entries then there is one rule for each year in the range
+[FirstEntry, LastEntry]. Otherwise there is one rule with year 0 from the "TZI" value.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_DATA : The zone's registry data is malformed.
+
+If a failure occurs in a WinAPI function the error code will likely be different from the above.
+######
+
+[in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+[out] 'standard_name' : The zone's "Std" value
+[out] 'daylight_name' : The zone's "Dlt" value
+[out] 'rules' : The zone's rules, sorted by year in ascending order
+[ret][failure] (false) : Failed to read the zone. An error code was set.
+[ret][success] (true) : The zone was read
+*/
+bool ReadTimezoneRulesFromRegistry(
+    const std::wstring &key_name,
+    std::wstring &standard_name,
+    std::wstring &daylight_name,
+    std::vector<TimezoneRule> &rules
+);
+
+
+/* GetTimezoneForYear()
+* UTCTimeToLocalTime()
+- Overloads that use a zone's rules instead of the current timezone.
+
+These are the same as their counterparts above except that the timezone information comes from
+'zone' instead of the WinAPI. There is no file or registry access. Windows' auto-DST setting is not
+applied since it is a setting for the current timezone only.
+
+::GetLastError() codes set by GetTimezoneForYear():
+
+ERROR_INVALID_TIME : 'year' is invalid.
+ERROR_INVALID_DATA : 'zone' has no rules or its timezone information is invalid.
+*/
+bool GetTimezoneForYear(
+    TIME_ZONE_INFORMATION &tzi,
+    const unsigned year,
+    const TimezoneRules &zone
+);
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneRules &zone
+);
+
+
+
+/* class TimezoneProvider
+- A source of timezone information by year.
+
+The current timezone's information is from the default provider. Unless SetTimezoneProvider() is
+called that's OSTimezoneProvider, which gets it from the WinAPI as described in the comment block
+above the GetTimezoneForYear() declaration. Everything that converts a time in the current timezone
+gets its timezone information by calling GetTimezoneForYear(), so changing the default provider
+changes the current timezone for all of them. For example a benchmark or test can use a
+MemoryTimezoneProvider with fixed rules so that its results don't depend on the machine's settings:
+
+    MemoryTimezoneProvider fixed( tzi ); // 'tzi' from PosixTZToTimezoneInfo( "EST5EDT" )
+    const TimezoneProvider *previous = SetTimezoneProvider( &fixed );
+    ...
+    SetTimezoneProvider( previous );
+
+A provider can also be passed to the conversion functions instead of changing the default.
+
+TimezoneProvider::GetTimezoneForYear() must be safe to call from multiple threads at the same time.
+*/
+class TimezoneProvider
+{
+public:
+    /* TimezoneProvider::GetTimezoneForYear()
+    - Get the timezone information for the closest available and appropriate year.
+
+    [out] 'tzi' : Timezone information for the closest available and appropriate year
+    [in] 'year' : The year requested, expressed as a local time value
+    [ret][failure] (false) : Failed to get timezone information. An error code was set.
+    [ret][success] (true) : Timezone information was output
+    */
+    virtual bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const = 0;
+
+    virtual ~TimezoneProvider() {}
+};
+
+
+/* class OSTimezoneProvider
+- The WinAPI's timezone information for the current timezone.
+
+This is the default provider. Refer to the comment block above the GetTimezoneForYear() declaration.
+*/
+class OSTimezoneProvider : public TimezoneProvider
+{
+public:
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const;
+};
+
+
+/* class CurrentTimezoneProvider
+- The current timezone's information from whichever provider is the default when it's called.
+
+This is the same as calling GetTimezoneForYear(). It's for passing the current timezone where a
+provider is expected, for example as the source of a CachedTimezoneProvider.
+*/
+class CurrentTimezoneProvider : public TimezoneProvider
+{
+public:
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const;
+};
+
+
+/* class CachedTimezoneProvider
+- Caches the timezone information of another provider by year.
+
+The first request for a year is passed to the source provider and a successful result is cached.
+After that the year's timezone information is copied from the cache. A failure is not cached.
+
+The source provider must remain valid for the life of this object.
+*/
+class CachedTimezoneProvider : public TimezoneProvider
+{
+public:
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const;
+
+    // Remove all cached timezone information
+    void Clear();
+
+    explicit CachedTimezoneProvider( const TimezoneProvider &source ) :
+        _source( source ), _lock( 0 ) {}
+
+private:
+    // not copyable
+    CachedTimezoneProvider( const CachedTimezoneProvider & );
+    CachedTimezoneProvider &operator=( const CachedTimezoneProvider & );
+
+    void Lock() const;
+    void Unlock() const;
+
+    const TimezoneProvider &_source;
+    mutable std::map<unsigned, TIME_ZONE_INFORMATION> _cache;
+    mutable volatile LONG _lock;
+};
+
+
+/* class MemoryTimezoneProvider
+- Timezone information by year from a table in memory.
+
+Each entry is the timezone information beginning with a year. The entry for a year is selected the
+same way as a TimezoneRule is selected by FindTimezoneRuleForYear(): If the year is before the first
+entry then the first entry, otherwise the last entry that begins on or before the year.
+
+The table is not safe to modify while another thread is getting timezone information from it.
+
+::GetLastError() codes set by GetTimezoneForYear():
+
+ERROR_INVALID_TIME : 'year' is invalid.
+ERROR_INVALID_DATA : The table is empty.
+*/
+class MemoryTimezoneProvider : public TimezoneProvider
+{
+public:
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const;
+
+    /* MemoryTimezoneProvider::Set()
+    - Set the timezone information beginning with a year.
+
+    [in] 'year' : The first year of 'tzi'. Use 0 for all years before the next entry.
+    [in] 'tzi' : The timezone information
+    [ret][failure] (false) : 'tzi' is invalid
+    [ret][success] (true) : The entry was set
+    */
+    bool Set( const unsigned year, const TIME_ZONE_INFORMATION &tzi );
+
+    // Remove all entries
+    void Clear() { _table.clear(); }
+
+    MemoryTimezoneProvider() {}
+
+    // The same timezone information for all years
+    explicit MemoryTimezoneProvider( const TIME_ZONE_INFORMATION &tzi ) { Set( 0, tzi ); }
+
+private:
+    std::map<unsigned, TIME_ZONE_INFORMATION> _table;
+};
+
+
+/* SetTimezoneProvider()
+- Set the default timezone provider, the source of the current timezone's information.
+
+The provider must remain valid until it is replaced.
+
+[in] 'provider' : The new default provider, or NULL for OSTimezoneProvider
+[ret] (const TimezoneProvider *) : The previous default provider. NULL for OSTimezoneProvider.
+*/
+const TimezoneProvider *SetTimezoneProvider( const TimezoneProvider *provider );
+
+
+/* UTCTimeToLocalTime()
+- Overload that uses a timezone provider instead of the current timezone.
+
+This is the same as the original overload, with the timezone information from 'provider'.
+*/
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider &provider
+);
+
+
+
+/* class Timezone
+- A handle to a zone identified by name.
+
+Timezone::Find() returns the handle for a zone. A handle is created the first time its zone is
+found and is cached for the life of the program, so every call to Find() for the same zone returns
+the same handle. A handle can't be copied or destroyed. It is safe to share handles between threads
+without synchronization.
+
+Finding a zone is the expensive part. It takes a lock and the first time a zone is found its rules
+are read. After that converting a time with the handle only uses the rules already in memory, so a
+program that renders times in many zones should find each zone once and keep the handle:
+
+    const Timezone *tz = Timezone::Find( L"Eastern Standard Time" );
+    if( tz && UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi, *tz ) )
+        ...
+
+The rules for a zone are from the embedded zones if it's embedded (refer to timezone_embedded.hpp),
+otherwise they are read from the registry with ReadTimezoneRulesFromRegistry(). Zones can also be
+added from elsewhere with Timezone::Add(), eg on a machine that has no Windows registry.
+
+A zone can also be found by its IANA id, eg "America/New_York". Refer to FindTimezoneByIANA() in
+timezone_iana.hpp.
+
+The rules of a zone read from the registry are read again by Timezone::ReloadAll(), which is called
+by the timezone watcher when the registry changes (refer to StartTimezoneWatcher()). New rules are
+published by swapping a pointer; a conversion that is using the old rules finishes with them and the
+old rules are kept in memory until the program exits. Readers never take a lock.
+
+Windows' auto-DST setting is not applied to a zone found by name since it is a setting for the
+current timezone only.
+
+A handle is also a TimezoneProvider of its zone's timezone information.
+*/
+class Timezone : public TimezoneProvider
+{
+public:
+    /* Timezone::Find()
+    - Find a zone by its Windows registry key name.
+
+    The name is not case sensitive, the same as a registry key name.
+
+    [in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+    [ret][failure] (NULL) : The zone was not found or could not be read. An error code was set.
+    [ret][success] (const Timezone *) : The handle. It is valid for the life of the program.
+    */
+    static const Timezone *Find( const std::wstring &key_name );
+
+    /* Timezone::Add()
+    - Add a zone from its rules, eg from a .reg file (refer to timezone_regfile.hpp).
+
+    The names and rules are copied. Find() returns the zone's handle from then on instead of reading
+    the zone from the registry. If the zone already has a handle then its names and rules are
+    replaced, the same way as ReloadAll() replaces them, and it's the same handle. A zone that was
+    added is not read again by ReloadAll(), even by a ReloadAll() that is already running.
+
+    [in] 'zone' : The zone's key name, names and rules. It must have at least one rule.
+    [ret][failure] (NULL) : 'zone' is invalid. An error code was set.
+    [ret][success] (const Timezone *) : The handle. It is valid for the life of the program.
+    */
+    static const Timezone *Add( const TimezoneRules &zone );
+
+    /* Timezone::ReloadAll()
+    - Read the rules of every zone handle that was read from the registry again.
+
+    A zone whose rules could not be read again keeps its current rules.
+
+    [ret][failure] (false) : The rules of a zone could not be read again. An error code was set.
+    [ret][success] (true) : The rules of every zone read from the registry were read again
+    */
+    static bool ReloadAll();
+
+    // The Windows registry key name of the zone, eg "Eastern Standard Time"
+    const std::wstring &GetKeyName() const { return _key_name; }
+
+    /* The zone's names and rules, which are the most recently published. The rules returned are
+    valid for the life of the program even after newer rules are published.
+    */
+    const TimezoneRules &GetRules() const { return _data->rules; }
+
+    // Same as the GetTimezoneForYear() overload for TimezoneRules, for the handle's rules
+    bool GetTimezoneForYear( TIME_ZONE_INFORMATION &tzi, const unsigned year ) const;
+
+private:
+    // The zone's names and rules. Published as a whole and never modified after.
+    struct Data
+    {
+        std::wstring standard_name;
+        std::wstring daylight_name;
+        std::vector<TimezoneRule> rule_storage;
+
+        // points to the members above and the handle's key name
+        TimezoneRules rules;
+    };
+
+    Timezone( const std::wstring &key_name, const bool fixed );
+    ~Timezone();
+
+    // not copyable
+    Timezone( const Timezone & );
+    Timezone &operator=( const Timezone & );
+
+    // Publish new names and rules
+    void Publish(
+        const std::wstring &standard_name,
+        const std::wstring &daylight_name,
+        const std::vector<TimezoneRule> &rules
+    );
+
+    std::wstring _key_name;
+
+    /* The rules are from the embedded zones or were added, not read from the registry, so they are
+    never reloaded. Only modified under the cache lock.
+    */
+    bool _fixed;
+
+    // The published names and rules
+    const Data *volatile _data;
+};
+
+
+/* UTCTimeToLocalTime()
+- Overload that uses a zone handle instead of the current timezone.
+
+This is the same as the TimezoneRules overload above, for the handle's rules.
+*/
+bool UTCTimeToLocalTime(
+    const SYSTEMTIME &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const Timezone &tz
+);
+
+
+/* UTCTimeToLocalTime()
+- Overloads for a valid UTC time.
+
+These are the same as the overloads above for the current timezone, a timezone provider and a zone
+handle, except the UTC time is not checked. The timezone information of each year is checked once,
+and the local time is calculated from it by the GetLocalTimeForTimezone() overload for valid times.
+*/
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi
+);
+bool UTCTimeToLocalTime( const ValidSystemTime &utc_st, SYSTEMTIME &local_time, DWORD &tzi_id );
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const TimezoneProvider &provider
+);
+bool UTCTimeToLocalTime(
+    const ValidSystemTime &utc_st,
+    SYSTEMTIME &local_time,
+    DWORD &tzi_id,
+    TIME_ZONE_INFORMATION &tzi,
+    const Timezone &tz
+);
+
+
+
+/* class PreparedTimezone
+- A zone's timezone information for a year and its transitions, for converting many UTC times.
+
+UTCTimeToLocalTime() gets the timezone information and calculates the transitions for every time
+it converts. A prepared zone does that once for a year. It holds the year's timezone information and
+the UTC times that daylight and standard time start, so the TIME_ZONE_ID of a UTC time is one
+comparison and the local time is the UTC time minus the bias for that ID.
+
+A zone is prepared for the UTC times in its year whose local times are also in that year, except
+January 1 and December 31 UTC. For those UTCTimeToLocalTime() may use the timezone information of
+the year before or after, so they're converted the usual way (refer to IsPrepared()). For the times
+it's prepared for the TIME_ZONE_ID and bias are the same as UTCTimeToLocalTime().
+
+    PreparedTimezone zone;
+    if( zone.Prepare( 2024, *Timezone::Find( L"Eastern Standard Time" ) )
+        && zone.IsPrepared( utc_ticks ) )
+    {
+        const DWORD tzi_id = zone.GetTimezoneId( utc_ticks );
+        const long bias = zone.GetBias( tzi_id );
+        ...
+    }
+
+A prepared zone is not updated if the zone's rules are reloaded. Prepare it again to use them.
+*/
+class PreparedTimezone
+{
+public:
+    /* PreparedTimezone::Prepare()
+    - Prepare the timezone information of a year.
+
+    If a failure occurs the zone is not prepared for any time.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_INVALID_PARAMETER : 'year' is invalid.
+    ERROR_INVALID_DATA : The timezone information is invalid.
+
+    If a failure occurs getting the timezone information the error code may be different from the
+    above.
+    ######
+
+    [in] 'year' : The year of the UTC times to prepare for
+    [in][opt] 'tz' : The zone. If not passed then the current timezone.
+    [ret][failure] (false) : The zone could not be prepared. An error code was set.
+    [ret][success] (true) : The zone was prepared
+    */
+    bool Prepare( const unsigned year );
+    bool Prepare( const unsigned year, const Timezone &tz );
+
+    // Whether or not the zone is prepared for a UTC time in ticks (refer to FileTimeToTicks())
+    bool IsPrepared( const ULONGLONG utc_ticks ) const
+    {
+        return ( utc_ticks - _begin ) < ( _end - _begin );
+    }
+
+    /* The TIME_ZONE_ID of a UTC time in ticks that the zone is prepared for: TIME_ZONE_ID_DAYLIGHT,
+    TIME_ZONE_ID_STANDARD or TIME_ZONE_ID_UNKNOWN
+    */
+    DWORD GetTimezoneId( const ULONGLONG utc_ticks ) const
+    {
+        return ( ( utc_ticks - _transition_begin ) < ( _transition_end - _transition_begin ) ) ?
+            _inside_id : _outside_id;
+    }
+
+    // The bias in minutes for a TIME_ZONE_ID returned by GetTimezoneId()
+    long GetBias( const DWORD tzi_id ) const
+    {
+        return _tzi.Bias + ( ( tzi_id == TIME_ZONE_ID_DAYLIGHT ) ? _tzi.DaylightBias
+            : ( ( tzi_id == TIME_ZONE_ID_STANDARD ) ? _tzi.StandardBias : 0 ) );
+    }
+
+    // The year and its timezone information
+    unsigned GetYear() const { return _year; }
+    const TIME_ZONE_INFORMATION &GetTimezoneInformation() const { return _tzi; }
+
+    // The zone, or NULL for the current timezone
+    const Timezone *GetTimezone() const { return _tz; }
+
+    // Not prepared for any time. The zone is the current timezone.
+    PreparedTimezone();
+
+private:
+    bool PrepareZone( const unsigned year, const Timezone *tz );
+
+    const Timezone *_tz;
+    unsigned _year;
+    TIME_ZONE_INFORMATION _tzi;
+
+    // The UTC ticks [begin, end) the zone is prepared for
+    ULONGLONG _begin;
+    ULONGLONG _end;
+
+    // The UTC ticks [begin, end) between the transitions, which are in '_inside_id', and the ID of
+    // the UTC ticks outside of them
+    ULONGLONG _transition_begin;
+    ULONGLONG _transition_end;
+    DWORD _inside_id;
+    DWORD _outside_id;
+};
+
+
+
+/* enum LocalTimePolicy
+- How LocalTimeToUTCTime() resolves a local time that is nonexistent or ambiguous.
+
+When clocks are set forward, eg at the start of daylight saving time, the local times in the gap
+are nonexistent. When clocks are set back the local times in the overlap are ambiguous: they occur
+once before the transition and once after. Either way there are two candidate UTC times, one from
+each of the biases in effect before and after the transition.
+
+For example in Eastern the clocks go from 2:00 AM EST to 3:00 AM EDT and later from 2:00 AM EDT to
+1:00 AM EST. Nonexistent 2:30 AM is 6:30 UTC (EDT) or 7:30 UTC (EST), and ambiguous 1:30 AM is
+5:30 UTC (EDT) or 6:30 UTC (EST).
+
+LOCAL_TIME_EARLIER : The earlier candidate UTC time. (6:30, 5:30)
+LOCAL_TIME_LATER : The later candidate UTC time. (7:30, 6:30)
+LOCAL_TIME_REJECT : Fail with error code ERROR_INVALID_TIME.
+LOCAL_TIME_SHIFT : A nonexistent time is shifted to the transition, which is the first local time
+after the gap. An ambiguous time is the same as LOCAL_TIME_LATER. (7:00 (3:00 AM EDT), 6:30)
+*/
+enum LocalTimePolicy
+{
+    LOCAL_TIME_EARLIER,
+    LOCAL_TIME_LATER,
+    LOCAL_TIME_REJECT,
+    LOCAL_TIME_SHIFT
+};
+
+
+/* LocalTimeToUTCTime()
+- Get the UTC time for a local time.
+
+This is the inverse of UTCTimeToLocalTime(). The timezone information is for the local time's year
+and it's retrieved the same way, from the current timezone or the zone passed.
+
+Each local time is resolved in constant time by comparing it to the year's transitions, which are
+calculated by TimezoneTimeToLocalTime(). The batch overloads calculate the transitions once for
+each run of local times that are in the same year.
+
+'nonexistent' and 'ambiguous' are required so that the caller decides what happens to those times.
+Refer to the comment block above the LocalTimePolicy declaration.
+
+The batch overloads convert all the times they can. Each time that could not be converted is zeroed
+out in 'utc_times', which is an invalid SYSTEMTIME (year 0).
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_TIME : 'local_time' is invalid, or is nonexistent or ambiguous and rejected by policy.
+
+If a failure occurs in a WinAPI function the error code will likely be different from the above.
+######
+
+[in] 'local_time' / 'local_times' : Local time. wDayOfWeek is ignored.
+[out] 'utc_st' / 'utc_times' : UTC time
+[out] 'tzi_id' : TIME_ZONE_ID_DAYLIGHT, TIME_ZONE_ID_STANDARD or TIME_ZONE_ID_UNKNOWN for 'utc_st',
+the same as the TIME_ZONE_ID UTCTimeToLocalTime() would return for it. For a nonexistent local time
+that is not the ID of the bias that was applied, eg 2:30 AM resolved to 7:30 UTC by the EST bias is
+TIME_ZONE_ID_DAYLIGHT.
+[in] 'count' : The number of times in 'local_times' and 'utc_times'
+[in] 'nonexistent' : How to resolve a local time that does not exist
+[in] 'ambiguous' : How to resolve a local time that exists twice
+[in][opt] 'tz' / 'zone' / 'provider' : The zone of the local time, or the provider of its timezone
+information. If not passed then the current timezone.
+[ret][failure] (false) : Conversion failed or, for batch, at least one conversion failed. An error
+code was set.
+[ret][success] (true) : Conversion successful
+*/
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const Timezone &tz
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneRules &zone
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const Timezone &tz
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneRules &zone
+);
+bool LocalTimeToUTCTime(
+    const SYSTEMTIME local_times[],
+    SYSTEMTIME utc_times[],
+    const size_t count,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+);
+
+
+
+/* enum LocalTimeArithmetic
+- How LocalTimeAdd() adds to a local time.
+
+LOCAL_TIME_WALL_CLOCK : The fields of the local time are added, so a day later is the same time of
+day even when the day has 23 or 25 hours. A month or year later is the same day of the month, or the
+last day of a shorter month. Refer to SystemTimeAdd() in time.hpp.
+LOCAL_TIME_ELAPSED : The amount is added to the UTC time, so a day later is 24 hours later and the
+time of day changes when a transition is crossed. Months and years aren't a fixed amount of time so
+they can't be added this way.
+*/
+enum LocalTimeArithmetic
+{
+    LOCAL_TIME_WALL_CLOCK,
+    LOCAL_TIME_ELAPSED
+};
+
+
+/* LocalTimeAdd()
+- Add an amount of a unit to a local time in a zone.
+
+The local time is resolved the same as LocalTimeToUTCTime(). For LOCAL_TIME_WALL_CLOCK it's the
+result that's resolved, so a result in the gap when clocks are set forward is nonexistent and a
+result in the overlap when they're set back is ambiguous. For LOCAL_TIME_ELAPSED it's 'local_time'
+that's resolved, since that's the UTC time the amount is added to.
+
+The output local time is the local time of the output UTC time. For LOCAL_TIME_WALL_CLOCK that's the
+local time plus the amount, unless it was nonexistent and resolved to a time after the gap.
+
+Eastern, where the clocks go from 2:00 AM EST to 3:00 AM EDT on 2013-03-10:
+
+    2013-03-09 02:30 + 1 day, LOCAL_TIME_WALL_CLOCK, LOCAL_TIME_LATER = 2013-03-10 03:30 EDT
+    2013-03-09 12:00 + 1 day, LOCAL_TIME_WALL_CLOCK = 2013-03-10 12:00 EDT (23 hours later)
+    2013-03-09 12:00 + 1 day, LOCAL_TIME_ELAPSED = 2013-03-10 13:00 EDT (24 hours later)
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : 'unit' is invalid, or months or years for LOCAL_TIME_ELAPSED.
+ERROR_INVALID_TIME : 'local_time' is invalid, the result is out of range, or a local time is
+nonexistent or ambiguous and rejected by policy.
+
+If a failure occurs getting the timezone information the error code may be different from the above.
+######
+
+[in] 'local_time' : Local time. wDayOfWeek is ignored.
+[out] 'result' : Local time, 'amount' units after 'local_time'
+[out] 'utc_st' : UTC time of 'result'
+[out] 'tzi_id' : A valid TIME_ZONE_ID for 'result'
+[in] 'amount' : The number of units to add. Negative subtracts.
+[in] 'unit' : The unit of 'amount'
+[in] 'arithmetic' : Wall clock or elapsed time
+[in] 'nonexistent' : How to resolve a local time that does not exist
+[in] 'ambiguous' : How to resolve a local time that exists twice
+[in][opt] 'provider' : The provider of the zone's timezone information, eg a Timezone handle. If not
+passed then the current timezone.
+[ret][failure] (false) : The time could not be added. An error code was set.
+[ret][success] (true) : The time was added
+*/
+bool LocalTimeAdd(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &result,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const long long amount,
+    const TimeUnit unit,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous
+);
+bool LocalTimeAdd(
+    const SYSTEMTIME &local_time,
+    SYSTEMTIME &result,
+    SYSTEMTIME &utc_st,
+    DWORD &tzi_id,
+    const long long amount,
+    const TimeUnit unit,
+    const LocalTimeArithmetic arithmetic,
+    const LocalTimePolicy nonexistent,
+    const LocalTimePolicy ambiguous,
+    const TimezoneProvider &provider
+);
+
+
+
+/* StartTimezoneWatcher()
+* StopTimezoneWatcher()
+- Start or stop watching for changes to the timezone information.
+
+The watcher is a thread that waits for the registry to notify it of a change to either of:
+HKEY_LOCAL_MACHINE\SYSTEM\CurrentControlSet\Control\TimeZoneInformation
+HKEY_LOCAL_MACHINE\SOFTWARE\Microsoft\Windows NT\CurrentVersion\Time Zones
+
+The first changes when the current timezone or Windows' auto-DST setting is changed and the second
+when the timezone information is updated. There is no polling.
+
+While the watcher is running the current timezone's rules are cached, so GetTimezoneForYear() and
+everything that calls it for the current timezone (eg UTCTimeToLocalTime()) uses the cache instead
+of calling the WinAPI. The rules are read from the same registry values the WinAPI reads and the
+auto-DST setting is applied the same way, refer to the GetTimezoneForYear() comment block.
+
+When there is a change the watcher reads the current timezone's rules again, publishes them by
+swapping a pointer and then calls Timezone::ReloadAll(). Readers never take a lock, refer to the
+comment block above the Timezone class declaration.
+
+The cache requires ::GetDynamicTimeZoneInformation() (>= Vista) for the current timezone's key name.
+If it's not available or the current timezone's rules can't be read then GetTimezoneForYear() calls
+the WinAPI as it does when the watcher is not running.
+
+Stopping the watcher stops using the cache.
+
+The watcher thread stops on its own if it can't request a registry notification or its wait fails,
+and then the cache is no longer used. Calling StartTimezoneWatcher() again starts a new watcher.
+
+[ret][failure] (false) : The watcher could not be started. An error code was set.
+[ret][success] (true) : The watcher was started or was already running
+*/
+bool StartTimezoneWatcher();
+void StopTimezoneWatcher();
+
+
+
+/* PosixTZToTimezoneInfo()
+- Convert a POSIX TZ string to timezone information.
+
+A POSIX TZ string is the format of the TZ environment variable, eg:
+"EST5EDT,M3.2.0,M11.1.0" (US Eastern)
+"CET-1CEST,M3.5.0,M10.5.0/3" (Central Europe)
+
+    std[offset] [dst[offset]] [,start[/time],end[/time]]
+
+The offsets are [+|-]hh[:mm[:ss]] and are positive west of UTC, the same as a Bias. The dst offset
+defaults to one hour less than the std offset. A name is 3 or more letters, or any characters except
+'>' and ',' in angle brackets ("<+0530>-5:30").
+
+The rule Mm.w.d is the same as a relative timezone time: month m, occurrence w (5 is the final
+occurrence) of day of the week d. The start rule is DaylightDate and the end rule is StandardDate.
+The time is [+|-]hh[:mm[:ss]], the default is 02:00:00. If there is a dst name but no rules then the
+US rules are used: M3.2.0,M11.1.0.
+
+The result is the same as timezone information for the current timezone and can be used wherever a
+TIME_ZONE_INFORMATION is taken, eg GetLocalTimeForTimezone(). There is no file or registry access.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : 'tz' is NULL.
+ERROR_INVALID_DATA : 'tz' is not a valid POSIX TZ string or the information it converts to is not
+valid timezone information.
+ERROR_NOT_SUPPORTED : 'tz' is a valid POSIX TZ string that can't be converted: a TZ string that
+begins with ':', a Julian day rule (Jn or n), a rule time not within a day, an offset with seconds
+or a name longer than 31 characters.
+######
+
+[in] 'tz' : The POSIX TZ string
+[out] 'tzi' : Timezone information
+[ret][failure] (false) : Conversion failed. An error code was set.
+[ret][success] (true) : Conversion successful
+*/
+bool PosixTZToTimezoneInfo( const char *tz, TIME_ZONE_INFORMATION &tzi );
+
+
+/* GetTimezoneInfoFromTZEnvironment()
+- Convert the TZ environment variable to timezone information.
+
+Refer to PosixTZToTimezoneInfo(). The error codes are the same except:
+
+ERROR_ENVVAR_NOT_FOUND : The TZ environment variable does not exist.
+
+[out] 'tzi' : Timezone information
+[ret][failure] (false) : Conversion failed. An error code was set.
+[ret][success] (true) : Conversion successful
+*/
+bool GetTimezoneInfoFromTZEnvironment( TIME_ZONE_INFORMATION &tzi );
+
 } // namespace time
 } // namespace jay
 #endif // _JAY_TIME_TIMEZONE_HPP
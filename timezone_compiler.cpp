@@ -0,0 +1,323 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Compile zones from the registry into tables that can be embedded in a program, or into a
+timezone database file.
+
+Usage: timezone_compiler [--reg <file>] [--binary <file>] <--all | zone key name ...>
+
+The tables are written to stdout. Use the output file for JAY_TIME_EMBEDDED_TIMEZONES when building
+timezone_embedded.cpp. Refer to timezone_embedded.hpp.
+
+eg: timezone_compiler "Eastern Standard Time" "Pacific Standard Time" > my_timezones.inc
+
+If --binary is passed then the zones are written to a timezone database file instead. Refer to
+timezone_database.hpp.
+
+eg: timezone_compiler --binary timezones.tzdb --all
+
+If --reg is passed then the zones are read from a .reg file exported from the registry instead of
+from the registry, so the tables or database can be built from another machine's zones. Refer to
+timezone_regfile.hpp.
+
+eg: timezone_compiler --reg timezones.reg --binary timezones.tzdb --all
+
+To build it:
+g++ -Wall -o timezone_compiler timezone_compiler.cpp timezone.cpp timezone_embedded.cpp timezone_database.cpp timezone_regfile.cpp time.cpp
+cl /W4 /EHsc timezone_compiler.cpp timezone.cpp timezone_embedded.cpp timezone_database.cpp timezone_regfile.cpp time.cpp
+*/
+
+#include "timezone.hpp"
+#include "timezone_database.hpp"
+#include "timezone_regfile.hpp"
+#include "time.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include <wchar.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+
+
+using namespace std;
+using namespace jay::time;
+
+
+
+bool LessKeyName( const wstring &a, const wstring &b )
+{
+    return _wcsicmp( a.c_str(), b.c_str() ) < 0;
+}
+
+bool EqualKeyName( const wstring &a, const wstring &b )
+{
+    return !_wcsicmp( a.c_str(), b.c_str() );
+}
+
+
+// Get the key names of all the zones in the registry
+bool GetAllKeyNames( vector<wstring> &key_names )
+{
+    HKEY key = NULL;
+    LONG ret = RegOpenKeyExW( HKEY_LOCAL_MACHINE,
+        L"SOFTWARE\\Microsoft\\Windows NT\\CurrentVersion\\Time Zones", 0, KEY_READ, &key );
+    if( ret != ERROR_SUCCESS )
+        return false;
+
+    for( DWORD i = 0; ; ++i )
+    {
+        wchar_t name[ 256 ] = {};
+        DWORD name_size = sizeof( name ) / sizeof( name[ 0 ] );
+
+        ret = RegEnumKeyExW( key, i, name, &name_size, NULL, NULL, NULL, NULL );
+        if( ret != ERROR_SUCCESS )
+            break;
+
+        key_names.push_back( name );
+    }
+
+    RegCloseKey( key );
+    return ( ret == ERROR_NO_MORE_ITEMS );
+}
+
+
+/* Output a wide string literal. Anything not printable ASCII is output as a hex escape, and the
+literal is split after the escape so that a hex digit that follows isn't read as part of it.
+*/
+string WideStringLiteral( const wstring &s )
+{
+    stringstream ss;
+
+    ss << "L\"";
+    for( size_t i = 0; i < s.size(); ++i )
+    {
+        const unsigned c = (unsigned)s[ i ];
+
+        if( ( c == '\\' ) || ( c == '"' ) )
+            ss << '\\' << (char)c;
+        else if( ( c >= 0x20 ) && ( c < 0x7F ) )
+            ss << (char)c;
+        else
+            ss << "\\x" << hex << setw( 4 ) << setfill( '0' ) << c << dec << "\" L\"";
+    }
+    ss << "\"";
+
+    return ss.str();
+}
+
+
+string SystemTimeInitializer( const SYSTEMTIME &st )
+{
+    stringstream ss;
+
+    ss << "{ " << st.wYear << ", " << st.wMonth << ", " << st.wDayOfWeek << ", " << st.wDay
+        << ", " << st.wHour << ", " << st.wMinute << ", " << st.wSecond << ", "
+        << st.wMilliseconds << " }";
+
+    return ss.str();
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *usage =
+        "Usage: timezone_compiler [--reg <file>] [--binary <file>] <--all | zone key name ...>";
+
+    // the database file if --binary was passed, and the .reg file if --reg was passed
+    wstring binary_filename, reg_filename;
+    int first_arg = 1;
+
+    while( ( argc >= first_arg + 2 )
+        && ( !strcmp( argv[ first_arg ], "--binary" ) || !strcmp( argv[ first_arg ], "--reg" ) )
+    )
+    {
+        wchar_t name[ MAX_PATH ] = {};
+        if( !MultiByteToWideChar( CP_ACP, 0, argv[ first_arg + 1 ], -1, name,
+                sizeof( name ) / sizeof( name[ 0 ] ) )
+        )
+        {
+            cerr << "Error: Filename \"" << argv[ first_arg + 1 ] << "\" is invalid." << endl;
+            return 1;
+        }
+
+        if( !strcmp( argv[ first_arg ], "--binary" ) )
+            binary_filename = name;
+        else
+            reg_filename = name;
+
+        first_arg += 2;
+    }
+
+    TimezoneRegFile regfile;
+
+    if( reg_filename.size() && !regfile.Open( reg_filename ) )
+    {
+        DWORD gle = GetLastError();
+        wcerr << L"Error: Failed to read \"" << reg_filename << L"\", "
+            << L"GetLastError: " << gle << L"." << endl;
+        return 1;
+    }
+
+    if( argc <= first_arg )
+    {
+        cerr << usage << endl;
+        return 1;
+    }
+
+    vector<wstring> key_names;
+
+    if( ( argc == first_arg + 1 ) && !strcmp( argv[ first_arg ], "--all" ) && regfile.IsOpen() )
+    {
+        for( size_t i = 0; i < regfile.GetCount(); ++i )
+        {
+            TimezoneRules zone = {};
+            regfile.GetZone( i, zone );
+            key_names.push_back( zone.key_name );
+        }
+    }
+    else if( ( argc == first_arg + 1 ) && !strcmp( argv[ first_arg ], "--all" ) )
+    {
+        if( !GetAllKeyNames( key_names ) )
+        {
+            cerr << "Error: Failed to enumerate the zones in the registry." << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        for( int i = first_arg; i < argc; ++i )
+        {
+            wchar_t name[ 256 ] = {};
+            if( !MultiByteToWideChar( CP_ACP, 0, argv[ i ], -1, name,
+                    sizeof( name ) / sizeof( name[ 0 ] ) )
+            )
+            {
+                cerr << "Error: Zone name \"" << argv[ i ] << "\" is invalid." << endl;
+                return 1;
+            }
+
+            key_names.push_back( name );
+        }
+    }
+
+    // FindEmbeddedTimezone() does a binary search so the zones must be sorted
+    sort( key_names.begin(), key_names.end(), LessKeyName );
+    key_names.erase( unique( key_names.begin(), key_names.end(), EqualKeyName ),
+        key_names.end() );
+
+    vector<wstring> standard_names( key_names.size() ), daylight_names( key_names.size() );
+    vector< vector<TimezoneRule> > rules( key_names.size() );
+
+    for( size_t i = 0; i < key_names.size(); ++i )
+    {
+        TimezoneRules zone = {};
+
+        if( regfile.IsOpen() )
+        {
+            if( !regfile.Find( key_names[ i ].c_str(), zone ) )
+            {
+                wcerr << L"Error: Zone \"" << key_names[ i ] << L"\" is not in \""
+                    << reg_filename << L"\"." << endl;
+                return 1;
+            }
+
+            standard_names[ i ] = zone.standard_name;
+            daylight_names[ i ] = zone.daylight_name;
+            rules[ i ].assign( zone.rules, zone.rules + zone.count );
+        }
+        else if( !ReadTimezoneRulesFromRegistry( key_names[ i ], standard_names[ i ],
+                daylight_names[ i ], rules[ i ] )
+        )
+        {
+            DWORD gle = GetLastError();
+            wcerr << L"Error: Failed to read zone \"" << key_names[ i ] << L"\", "
+                << L"GetLastError: " << gle << L"." << endl;
+            return 1;
+        }
+    }
+
+    if( binary_filename.size() )
+    {
+        vector<TimezoneRules> zones( key_names.size() );
+
+        for( size_t i = 0; i < key_names.size(); ++i )
+        {
+            zones[ i ].key_name = key_names[ i ].c_str();
+            zones[ i ].standard_name = standard_names[ i ].c_str();
+            zones[ i ].daylight_name = daylight_names[ i ].c_str();
+            zones[ i ].rules = &rules[ i ][ 0 ];
+            zones[ i ].count = rules[ i ].size();
+        }
+
+        if( !WriteTimezoneDatabase( binary_filename, ( zones.empty() ? NULL : &zones[ 0 ] ),
+                zones.size() )
+        )
+        {
+            DWORD gle = GetLastError();
+            wcerr << L"Error: Failed to write \"" << binary_filename << L"\", "
+                << L"GetLastError: " << gle << L"." << endl;
+            return 1;
+        }
+
+        return 0;
+    }
+
+    stringstream ss_rules, ss_zones;
+
+    ss_zones << "const jay::time::TimezoneRules embedded_timezones[] = {" << endl;
+
+    for( size_t i = 0; i < key_names.size(); ++i )
+    {
+        ss_rules << "// " << WideStringLiteral( key_names[ i ] ) << endl;
+        ss_rules << "const jay::time::TimezoneRule embedded_rules_" << i << "[] = {" << endl;
+        for( size_t j = 0; j < rules[ i ].size(); ++j )
+        {
+            const TimezoneRule &rule = rules[ i ][ j ];
+
+            ss_rules << "    { " << rule.year << ", " << rule.Bias << ", "
+                << rule.StandardBias << ", " << rule.DaylightBias << "," << endl
+                << "        " << SystemTimeInitializer( rule.StandardDate ) << "," << endl
+                << "        " << SystemTimeInitializer( rule.DaylightDate ) << " },"
+                << endl;
+        }
+        ss_rules << "};" << endl << endl;
+
+        ss_zones << "    { " << WideStringLiteral( key_names[ i ] ) << "," << endl
+            << "        " << WideStringLiteral( standard_names[ i ] ) << "," << endl
+            << "        " << WideStringLiteral( daylight_names[ i ] ) << "," << endl
+            << "        embedded_rules_" << i << ", " << rules[ i ].size() << " }," << endl;
+    }
+
+    ss_zones << "};" << endl;
+
+    cout << "/* Generated by timezone_compiler.cpp. Do not edit." << endl
+        << "Refer to timezone_embedded.hpp." << endl
+        << "*/" << endl << endl
+        << ss_rules.str() << ss_zones.str();
+
+    return 0;
+}
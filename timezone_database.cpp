@@ -0,0 +1,426 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** A compiled timezone database file that is mapped into memory read-only and used in place.
+
+Documentation is in timezone_database.hpp. The file is built by timezone_compiler.cpp.
+*/
+
+#include "timezone_database.hpp"
+#include "timezone.hpp"
+
+#include <windows.h>
+#include <wchar.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+
+using namespace std;
+
+
+
+namespace {
+
+// The string section of a database being written. Each name is stored once.
+class StringPool
+{
+public:
+    DWORD Add( const WCHAR *s )
+    {
+        const wstring str( s ? s : L"" );
+
+        map<wstring, DWORD>::const_iterator it = _indexes.find( str );
+        if( it != _indexes.end() )
+            return it->second;
+
+        const DWORD index = (DWORD)_pool.size();
+        _pool.insert( _pool.end(), str.begin(), str.end() );
+        _pool.push_back( L'\0' );
+        _indexes[ str ] = index;
+        return index;
+    }
+
+    const vector<WCHAR> &GetPool() const { return _pool; }
+
+private:
+    vector<WCHAR> _pool;
+    map<wstring, DWORD> _indexes;
+};
+
+
+// Sort the zones being written by key name, not case sensitive
+struct LessZoneKeyName
+{
+    explicit LessZoneKeyName( const jay::time::TimezoneRules zones[] ) : _zones( zones ) {}
+
+    bool operator()( const size_t a, const size_t b ) const
+    {
+        return _wcsicmp( _zones[ a ].key_name, _zones[ b ].key_name ) < 0;
+    }
+
+    const jay::time::TimezoneRules *_zones;
+};
+
+
+// Whether or not rules are sorted by year in ascending order with no year repeated
+bool AreRulesSorted( const jay::time::TimezoneRule rules[], const size_t count )
+{
+    for( size_t i = 1; i < count; ++i )
+    {
+        if( rules[ i - 1 ].year >= rules[ i ].year )
+            return false;
+    }
+
+    return true;
+}
+
+
+// Round up to a multiple of 4
+size_t Align4( const size_t n )
+{
+    return ( n + 3 ) & ~(size_t)3;
+}
+
+
+/* Whether or not an array of 'count' elements of 'element_size' at 'offset' is within a view of
+'view_size' and aligned
+*/
+bool IsSectionValid(
+    const size_t view_size,
+    const DWORD offset,
+    const DWORD count,
+    const size_t element_size
+)
+{
+    return !( offset % 4 )
+        && ( offset <= view_size )
+        && ( count <= ( ( view_size - offset ) / element_size ) );
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+bool WriteTimezoneDatabase(
+    const std::wstring &filename,
+    const TimezoneRules zones[],
+    const size_t count
+)
+{
+    if( filename.empty() || ( count && !zones ) )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    vector<size_t> order( count );
+    for( size_t i = 0; i < count; ++i )
+    {
+        if( !zones[ i ].key_name || !zones[ i ].rules || !zones[ i ].count
+            || !AreRulesSorted( zones[ i ].rules, zones[ i ].count )
+        )
+        {
+            SetLastError( ERROR_INVALID_PARAMETER );
+            return false;
+        }
+
+        order[ i ] = i;
+    }
+
+    // Find() does a binary search so the zones must be sorted
+    sort( order.begin(), order.end(), LessZoneKeyName( zones ) );
+
+    // Open() rejects a database with a key name more than once
+    for( size_t i = 1; i < count; ++i )
+    {
+        if( !_wcsicmp( zones[ order[ i - 1 ] ].key_name, zones[ order[ i ] ].key_name ) )
+        {
+            SetLastError( ERROR_INVALID_PARAMETER );
+            return false;
+        }
+    }
+
+    vector<TimezoneDatabaseZone> db_zones( count );
+    vector<TimezoneRule> db_rules;
+    StringPool strings;
+
+    for( size_t i = 0; i < count; ++i )
+    {
+        const TimezoneRules &zone = zones[ order[ i ] ];
+
+        db_zones[ i ].key_name = strings.Add( zone.key_name );
+        db_zones[ i ].standard_name = strings.Add( zone.standard_name );
+        db_zones[ i ].daylight_name = strings.Add( zone.daylight_name );
+        db_zones[ i ].first_rule = (DWORD)db_rules.size();
+        db_zones[ i ].rule_count = (DWORD)zone.count;
+        db_rules.insert( db_rules.end(), zone.rules, zone.rules + zone.count );
+    }
+
+    // the pool is never empty so that its last WCHAR is always null
+    if( strings.GetPool().empty() )
+        strings.Add( L"" );
+
+    const vector<WCHAR> &pool = strings.GetPool();
+
+    TimezoneDatabaseHeader header = {};
+    memcpy( header.magic, JAY_TIME_TIMEZONE_DATABASE_MAGIC, sizeof( header.magic ) );
+    header.version = JAY_TIME_TIMEZONE_DATABASE_VERSION;
+    header.header_size = sizeof( header );
+
+    size_t size = Align4( sizeof( header ) );
+
+    header.zone_count = (DWORD)db_zones.size();
+    header.zones_offset = (DWORD)size;
+    size = Align4( size + ( db_zones.size() * sizeof( TimezoneDatabaseZone ) ) );
+
+    header.rule_count = (DWORD)db_rules.size();
+    header.rules_offset = (DWORD)size;
+    size = Align4( size + ( db_rules.size() * sizeof( TimezoneRule ) ) );
+
+    header.string_count = (DWORD)pool.size();
+    header.strings_offset = (DWORD)size;
+    size = Align4( size + ( pool.size() * sizeof( WCHAR ) ) );
+
+    header.file_size = (DWORD)size;
+
+    vector<BYTE> buf( size );
+    memcpy( &buf[ 0 ], &header, sizeof( header ) );
+    if( db_zones.size() )
+    {
+        memcpy( &buf[ header.zones_offset ], &db_zones[ 0 ],
+            db_zones.size() * sizeof( TimezoneDatabaseZone ) );
+    }
+    if( db_rules.size() )
+    {
+        memcpy( &buf[ header.rules_offset ], &db_rules[ 0 ],
+            db_rules.size() * sizeof( TimezoneRule ) );
+    }
+    memcpy( &buf[ header.strings_offset ], &pool[ 0 ], pool.size() * sizeof( WCHAR ) );
+
+    HANDLE file = CreateFileW( filename.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    DWORD written = 0;
+    bool success = WriteFile( file, &buf[ 0 ], (DWORD)buf.size(), &written, NULL )
+        && ( written == buf.size() );
+
+    DWORD gle = GetLastError();
+    CloseHandle( file );
+
+    if( !success )
+    {
+        DeleteFileW( filename.c_str() );
+        SetLastError( gle ? gle : ERROR_WRITE_FAULT );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+bool TimezoneDatabase::Open( const std::wstring &filename )
+{
+    Close();
+
+    _file = CreateFileW( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL );
+    if( _file == INVALID_HANDLE_VALUE )
+        return false;
+
+    // an empty file can't be mapped, and a database is never larger than a DWORD
+    LARGE_INTEGER size = {};
+    if( !GetFileSizeEx( _file, &size )
+        || ( size.QuadPart < (LONGLONG)sizeof( TimezoneDatabaseHeader ) )
+        || ( size.QuadPart > (LONGLONG)0xFFFFFFFF )
+    )
+    {
+        DWORD gle = GetLastError();
+        Close();
+        SetLastError( gle ? gle : ERROR_BAD_FORMAT );
+        return false;
+    }
+
+    _mapping = CreateFileMappingW( _file, NULL, PAGE_READONLY, 0, 0, NULL );
+    if( _mapping )
+        _view = (const BYTE *)MapViewOfFile( _mapping, FILE_MAP_READ, 0, 0, 0 );
+
+    if( !_view )
+    {
+        DWORD gle = GetLastError();
+        Close();
+        SetLastError( gle );
+        return false;
+    }
+
+    if( !Validate( (size_t)size.QuadPart ) )
+    {
+        DWORD gle = GetLastError();
+        Close();
+        SetLastError( gle );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+bool TimezoneDatabase::Validate( const size_t view_size )
+{
+    const TimezoneDatabaseHeader *header = (const TimezoneDatabaseHeader *)_view;
+
+    if( memcmp( header->magic, JAY_TIME_TIMEZONE_DATABASE_MAGIC, sizeof( header->magic ) )
+        || ( header->version != JAY_TIME_TIMEZONE_DATABASE_VERSION )
+        || ( header->header_size != sizeof( *header ) )
+    )
+    {
+        SetLastError( ERROR_BAD_FORMAT );
+        return false;
+    }
+
+    if( ( header->file_size != view_size )
+        || !IsSectionValid( view_size, header->zones_offset, header->zone_count,
+            sizeof( TimezoneDatabaseZone ) )
+        || !IsSectionValid( view_size, header->rules_offset, header->rule_count,
+            sizeof( TimezoneRule ) )
+        || !IsSectionValid( view_size, header->strings_offset, header->string_count,
+            sizeof( WCHAR ) )
+        || !header->string_count
+    )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    const TimezoneDatabaseZone *zones =
+        (const TimezoneDatabaseZone *)( _view + header->zones_offset );
+    const TimezoneRule *rules = (const TimezoneRule *)( _view + header->rules_offset );
+    const WCHAR *strings = (const WCHAR *)( _view + header->strings_offset );
+
+    // every name is null terminated if the last WCHAR is
+    if( strings[ header->string_count - 1 ] )
+    {
+        SetLastError( ERROR_INVALID_DATA );
+        return false;
+    }
+
+    for( DWORD i = 0; i < header->zone_count; ++i )
+    {
+        const TimezoneDatabaseZone &zone = zones[ i ];
+
+        if( ( zone.key_name >= header->string_count )
+            || ( zone.standard_name >= header->string_count )
+            || ( zone.daylight_name >= header->string_count )
+            || !zone.rule_count
+            || ( zone.first_rule > header->rule_count )
+            || ( zone.rule_count > ( header->rule_count - zone.first_rule ) )
+            // sorted for the binary searches
+            || !AreRulesSorted( &rules[ zone.first_rule ], zone.rule_count )
+            || ( i && ( _wcsicmp( &strings[ zones[ i - 1 ].key_name ],
+                &strings[ zone.key_name ] ) >= 0 ) )
+        )
+        {
+            SetLastError( ERROR_INVALID_DATA );
+            return false;
+        }
+    }
+
+    _header = header;
+    _zones = zones;
+    _rules = rules;
+    _strings = strings;
+    return true;
+}
+
+
+
+void TimezoneDatabase::Close()
+{
+    if( _view )
+        UnmapViewOfFile( _view );
+
+    if( _mapping )
+        CloseHandle( _mapping );
+
+    if( _file != INVALID_HANDLE_VALUE )
+        CloseHandle( _file );
+
+    _file = INVALID_HANDLE_VALUE;
+    _mapping = NULL;
+    _view = NULL;
+    _header = NULL;
+    _zones = NULL;
+    _rules = NULL;
+    _strings = NULL;
+}
+
+
+
+bool TimezoneDatabase::GetZone( const size_t index, TimezoneRules &zone ) const
+{
+    if( index >= GetCount() )
+        return false;
+
+    const TimezoneDatabaseZone &db_zone = _zones[ index ];
+
+    zone.key_name = &_strings[ db_zone.key_name ];
+    zone.standard_name = &_strings[ db_zone.standard_name ];
+    zone.daylight_name = &_strings[ db_zone.daylight_name ];
+    zone.rules = &_rules[ db_zone.first_rule ];
+    zone.count = db_zone.rule_count;
+    return true;
+}
+
+
+
+bool TimezoneDatabase::Find( const WCHAR *key_name, TimezoneRules &zone ) const
+{
+    if( !key_name )
+        return false;
+
+    size_t first = 0, last = GetCount();
+    while( first < last )
+    {
+        const size_t middle = first + ( ( last - first ) / 2 );
+        const int cmp = _wcsicmp( key_name, &_strings[ _zones[ middle ].key_name ] );
+
+        if( !cmp )
+            return GetZone( middle, zone );
+        else if( cmp < 0 )
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    return false;
+}
+
+} // namespace time
+} // namespace jay
@@ -0,0 +1,239 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+A compiled timezone database file that is mapped into memory read-only and used in place.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+The file is built once, for example at deploy time, by timezone_compiler.cpp:
+
+    timezone_compiler --binary timezones.tzdb --all
+
+Each process that opens the file maps a view of it. The OS shares the pages of the same file between
+all the processes that map it, so there is one copy of the database in memory no matter how many
+processes use it. Opening the file validates the header and the zone table; nothing is parsed or
+copied. A zone found in the database is a TimezoneRules (refer to timezone.hpp) that points into the
+mapped view and can be used with any function that takes a TimezoneRules:
+
+    TimezoneDatabase db;
+    TimezoneRules zone;
+    if( db.Open( L"timezones.tzdb" ) && db.Find( L"Eastern Standard Time", zone ) )
+        UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi, zone );
+
+The rules are what GetTimezoneForYear() needs to output the TIME_ZONE_INFORMATION for a year and
+that is all GetLocalTimeForTimezone() needs to find the transitions in the year. The transitions
+are not stored; they're calculated from the rules in the same way as for the current timezone.
+
+
+The file format. All values are little endian and every section is 4 byte aligned.
+
+TimezoneDatabaseHeader
+TimezoneDatabaseZone[ zone_count ] : sorted by key name, not case sensitive
+TimezoneRule[ rule_count ] : each zone's rules are consecutive and sorted by year
+WCHAR[ string_count ] : the names, each null terminated. The last WCHAR is always null.
+
+The version is incremented when the format changes. A file of a different version is rejected.
+*/
+
+#ifndef _JAY_TIME_TIMEZONE_DATABASE_HPP
+#define _JAY_TIME_TIMEZONE_DATABASE_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+#include <string>
+
+
+
+namespace jay {
+namespace time {
+
+// The first bytes of a timezone database file
+#define JAY_TIME_TIMEZONE_DATABASE_MAGIC "JTZDB\r\n\x1A"
+
+// The version of the timezone database file format
+#define JAY_TIME_TIMEZONE_DATABASE_VERSION 1
+
+
+/* struct TimezoneDatabaseHeader
+- The header at the beginning of a timezone database file.
+
+The offsets are in bytes from the beginning of the file.
+*/
+struct TimezoneDatabaseHeader
+{
+    char magic[ 8 ];
+    DWORD version;
+    DWORD header_size;
+    DWORD file_size;
+
+    DWORD zone_count;
+    DWORD zones_offset;
+
+    DWORD rule_count;
+    DWORD rules_offset;
+
+    DWORD string_count;
+    DWORD strings_offset;
+};
+
+
+/* struct TimezoneDatabaseZone
+- A zone in a timezone database file.
+
+The names are indexes of null terminated strings in the string section. The rules are indexes in
+the rule section.
+*/
+struct TimezoneDatabaseZone
+{
+    DWORD key_name;
+    DWORD standard_name;
+    DWORD daylight_name;
+
+    DWORD first_rule;
+    DWORD rule_count;
+};
+
+
+/* WriteTimezoneDatabase()
+- Write zones to a timezone database file.
+
+The zones don't have to be sorted. An existing file is replaced.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_INVALID_PARAMETER : A zone has no key name or no rules, its rules are not sorted by year in
+ascending order with no year repeated, or its key name is the same as another zone's (not case
+sensitive). Open() would reject the file so it's not written.
+######
+
+[in] 'filename' : The name of the file to write
+[in] 'zones' : An array of 'count' zones. Each zone must have at least one rule.
+[in] 'count' : The number of zones
+[ret][failure] (false) : The file could not be written. An error code was set.
+[ret][success] (true) : The file was written
+*/
+bool WriteTimezoneDatabase(
+    const std::wstring &filename,
+    const TimezoneRules zones[],
+    const size_t count
+);
+
+
+
+/* class TimezoneDatabase
+- A timezone database file mapped into memory read-only.
+
+The TimezoneRules output by this object point into the mapped view. They're valid until the
+database is closed or destroyed.
+*/
+class TimezoneDatabase
+{
+public:
+    /* TimezoneDatabase::Open()
+    - Map a timezone database file and validate it.
+
+    A database that is already open is closed first.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_BAD_FORMAT : The file is not a timezone database or it's not the supported version.
+    ERROR_INVALID_DATA : The file is a timezone database of the supported version but it's corrupt,
+    for example a zone's rules are not sorted by year or its key name is out of order.
+    ######
+
+    [in] 'filename' : The name of the file to open
+    [ret][failure] (false) : The file could not be opened or is invalid. An error code was set.
+    [ret][success] (true) : The database is open
+    */
+    bool Open( const std::wstring &filename );
+
+    // Unmap the database. The TimezoneRules output by this object are no longer valid.
+    void Close();
+
+    bool IsOpen() const { return !!_view; }
+
+    // The number of zones. 0 if the database is not open.
+    size_t GetCount() const { return _header ? _header->zone_count : 0; }
+
+    /* TimezoneDatabase::GetZone()
+    - Enumerate the zones.
+
+    The zones are sorted by key name, not case sensitive.
+
+    [in] 'index' : [0, GetCount())
+    [out] 'zone' : The zone
+    [ret][failure] (false) : 'index' is out of range
+    [ret][success] (true) : The zone was output
+    */
+    bool GetZone( const size_t index, TimezoneRules &zone ) const;
+
+    /* TimezoneDatabase::Find()
+    - Find a zone by its Windows registry key name.
+
+    The name is not case sensitive, the same as a registry key name. The zones are binary searched.
+
+    [in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+    [out] 'zone' : The zone
+    [ret][failure] (false) : The zone was not found
+    [ret][success] (true) : The zone was output
+    */
+    bool Find( const WCHAR *key_name, TimezoneRules &zone ) const;
+
+    TimezoneDatabase() :
+        _file( INVALID_HANDLE_VALUE ),
+        _mapping( NULL ),
+        _view( NULL ),
+        _header( NULL ),
+        _zones( NULL ),
+        _rules( NULL ),
+        _strings( NULL )
+    {}
+
+    ~TimezoneDatabase() { Close(); }
+
+private:
+    // not copyable
+    TimezoneDatabase( const TimezoneDatabase & );
+    TimezoneDatabase &operator=( const TimezoneDatabase & );
+
+    // Validate the mapped view and set the section pointers
+    bool Validate( const size_t view_size );
+
+    HANDLE _file;
+    HANDLE _mapping;
+    const BYTE *_view;
+
+    const TimezoneDatabaseHeader *_header;
+    const TimezoneDatabaseZone *_zones;
+    const TimezoneRule *_rules;
+    const WCHAR *_strings;
+};
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_TIMEZONE_DATABASE_HPP
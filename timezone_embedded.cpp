@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Timezone rules compiled into the program.
+
+Documentation is in timezone_embedded.hpp. The tables are generated by timezone_compiler.cpp.
+*/
+
+#include "timezone_embedded.hpp"
+#include "timezone.hpp"
+
+#include <windows.h>
+#include <wchar.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+#ifndef JAY_TIME_NO_EMBEDDED_TIMEZONES
+
+#ifndef JAY_TIME_EMBEDDED_TIMEZONES
+#define JAY_TIME_EMBEDDED_TIMEZONES "timezone_embedded_data.inc"
+#endif
+
+/* The generated file defines the rule tables and 'embedded_timezones', the zones sorted by key name
+(not case sensitive). The tables are POD so they are constant initialized.
+*/
+#include JAY_TIME_EMBEDDED_TIMEZONES
+
+const size_t embedded_timezones_count =
+    sizeof( embedded_timezones ) / sizeof( embedded_timezones[ 0 ] );
+
+#else
+
+const jay::time::TimezoneRules *const embedded_timezones = NULL;
+const size_t embedded_timezones_count = 0;
+
+#endif // JAY_TIME_NO_EMBEDDED_TIMEZONES
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+const TimezoneRules *FindEmbeddedTimezone( const WCHAR *key_name )
+{
+    if( !key_name )
+        return NULL;
+
+    size_t first = 0, last = embedded_timezones_count;
+    while( first < last )
+    {
+        const size_t middle = first + ( ( last - first ) / 2 );
+        const int cmp = _wcsicmp( key_name, embedded_timezones[ middle ].key_name );
+
+        if( !cmp )
+            return &embedded_timezones[ middle ];
+        else if( cmp < 0 )
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    return NULL;
+}
+
+
+
+size_t GetEmbeddedTimezoneCount()
+{
+    return embedded_timezones_count;
+}
+
+
+const TimezoneRules *GetEmbeddedTimezone( const size_t index )
+{
+    return ( index < embedded_timezones_count ) ? &embedded_timezones[ index ] : NULL;
+}
+
+} // namespace time
+} // namespace jay
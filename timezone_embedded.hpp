@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Timezone rules compiled into the program.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+Converting a time with the current timezone has the OS look up the timezone information in the
+registry, at least once for each year converted. A zone that is embedded is a constant table of
+TimezoneRules (refer to timezone.hpp) that is part of the program image. It has no startup cost and
+converting a time with it needs no file or registry access and no parsing:
+
+    const TimezoneRules *zone = FindEmbeddedTimezone( L"Eastern Standard Time" );
+    if( zone && UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi, *zone ) )
+        ...
+
+The tables are generated by timezone_compiler.cpp, which reads the chosen zones from the registry of
+the machine it is run on. The zones to embed are whichever zones are passed to it, which bounds the
+size they add to the binary:
+
+    timezone_compiler "Eastern Standard Time" "Pacific Standard Time" > my_timezones.inc
+
+Preprocessor defines for timezone_embedded.cpp:
+JAY_TIME_EMBEDDED_TIMEZONES : The file of generated tables to embed, eg "my_timezones.inc". The
+default is "timezone_embedded_data.inc" which has a small set of common zones.
+JAY_TIME_NO_EMBEDDED_TIMEZONES : Embed no zones. FindEmbeddedTimezone() always fails.
+
+The timezone information embedded is only as current as the registry it was generated from. Refer
+to the comment block above the GetTimezoneForYear() declaration in timezone.hpp for why that may
+matter for future years.
+*/
+
+#ifndef _JAY_TIME_TIMEZONE_EMBEDDED_HPP
+#define _JAY_TIME_TIMEZONE_EMBEDDED_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+/* FindEmbeddedTimezone()
+- Find an embedded zone by its Windows registry key name.
+
+The name is not case sensitive, the same as a registry key name.
+
+[in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+[ret][failure] (NULL) : The zone is not embedded
+[ret][success] (const TimezoneRules *) : The embedded zone. It is valid for the life of the program.
+*/
+const TimezoneRules *FindEmbeddedTimezone( const WCHAR *key_name );
+
+
+/* GetEmbeddedTimezoneCount()
+* GetEmbeddedTimezone()
+- Enumerate the embedded zones.
+
+The zones are sorted by key name, not case sensitive.
+
+[in] 'index' : [0, GetEmbeddedTimezoneCount())
+[ret][failure] (NULL) : 'index' is out of range
+[ret][success] (const TimezoneRules *) : The embedded zone. It is valid for the life of the program.
+*/
+size_t GetEmbeddedTimezoneCount();
+const TimezoneRules *GetEmbeddedTimezone( const size_t index );
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_TIMEZONE_EMBEDDED_HPP
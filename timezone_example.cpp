@@ -21,20 +21,28 @@ along with jay::time. If not, see <http://www.gnu.org/licenses/>.
 /** Example to show Timezone ID for the current timezone and time.
 
 Compiled using g++ (GCC) 4.7.2. No warnings.
-g++ -Wall -o tzid timezone_example.cpp timezone.cpp time.cpp
+g++ -Wall -o tzid timezone_example.cpp timezone.cpp timezone_embedded.cpp time.cpp
 
 Compiled using VS2010 cl 16.00.40219.01. No warnings.
-cl /W4 /EHsc /Fetzid timezone_example.cpp timezone.cpp time.cpp
+cl /W4 /EHsc /Fetzid timezone_example.cpp timezone.cpp timezone_embedded.cpp time.cpp
 
 Preprocessor defines:
 DEBUG_ST : Show SYSTEMTIME structs
 COMPARE_TO_WINAPI : Show the timezone ID returned by WinAPI as well as jay::time. If the comparison
 is not equal set the program exit code to 1.
+CHECK_CONVERSIONS : Check conversions that were wrong in the past (refer to CheckConversions()). If
+a check fails set the program exit code to 1. local_time_cursor.cpp and calendar.cpp must also be
+compiled.
 */
 
 #include "timezone.hpp"
 #include "time.hpp"
 
+#ifdef CHECK_CONVERSIONS
+#include "local_time_cursor.hpp"
+#include "calendar.hpp"
+#endif
+
 #include <windows.h>
 #include <time.h>
 #include <assert.h>
@@ -58,6 +66,148 @@ using namespace jay::time;
 
 
 
+#ifdef CHECK_CONVERSIONS
+// The ticks of a valid SYSTEMTIME
+ULONGLONG GetTicks( const SYSTEMTIME &st )
+{
+    FILETIME ft = {};
+    SystemTimeToFileTime( &st, &ft );
+    return FileTimeToTicks( ft );
+}
+
+
+/* A LocalTimeCursor window created from a UTC time with a sub-millisecond part must have the same
+offset as UTCTimeToLocalTime(), so that a time on a second boundary converted later in that window
+isn't a tick early.
+*/
+bool CheckCursorSubMillisecondOffset()
+{
+    const Timezone *tz = Timezone::Find( L"Eastern Standard Time" );
+    if( !tz )
+        return false;
+
+    LocalTimeCursor cursor( *tz );
+    const SYSTEMTIME first = { 2024, 7, 2, 2, 3, 10, 59, 0 };
+    const SYSTEMTIME later = { 2024, 7, 2, 2, 7, 11, 0, 0 };
+    FILETIME utc_ft = {}, local_ft = {};
+    SYSTEMTIME local = {}, expected = {};
+    DWORD tzi_id = 0;
+    TIME_ZONE_INFORMATION tzi = {};
+
+    // the window is created from a time 5 ticks past the second, then reused
+    TicksToFileTime( GetTicks( first ) + 5, utc_ft );
+    if( !cursor.UTCTimeToLocalTime( utc_ft, local_ft ) )
+        return false;
+
+    TicksToFileTime( GetTicks( later ), utc_ft );
+    if( !cursor.UTCTimeToLocalTime( utc_ft, local_ft )
+        || !FileTimeToSystemTime( &local_ft, &local )
+        || !UTCTimeToLocalTime( later, expected, tzi_id, tzi, *tz ) )
+    {
+        return false;
+    }
+
+    return !CompareSystemTimes( local, expected );
+}
+
+
+/* An event at exactly local midnight is in the day that begins then, even if the cursor's window
+was created from a time with a sub-millisecond part.
+*/
+bool CheckCalendarBucketAtMidnight()
+{
+    const Timezone *tz = Timezone::Find( L"Eastern Standard Time" );
+    if( !tz )
+        return false;
+
+    LocalTimeCursor cursor( *tz );
+    const SYSTEMTIME first = { 2024, 7, 1, 1, 12, 0, 0, 0 };
+    const SYSTEMTIME midnight = { 2024, 7, 2, 2, 4, 0, 0, 0 }; // 2024-07-02 00:00 EDT
+    const SYSTEMTIME local_midnight = { 2024, 7, 2, 2, 0, 0, 0, 0 };
+    FILETIME utc_times[ 2 ] = {};
+    DWORD buckets[ 2 ] = {}, expected = 0;
+
+    TicksToFileTime( GetTicks( first ) + 5, utc_times[ 0 ] );
+    TicksToFileTime( GetTicks( midnight ), utc_times[ 1 ] );
+
+    if( !GetCalendarBuckets( utc_times, buckets, 2, CALENDAR_DAY, cursor )
+        || !LocalTimeToCalendarBucket( local_midnight, CALENDAR_DAY, expected ) )
+    {
+        return false;
+    }
+
+    return ( buckets[ 1 ] == expected );
+}
+
+
+/* The TIME_ZONE_ID that LocalTimeToUTCTime() outputs for a nonexistent local time is the ID of
+the UTC time it outputs, the same as UTCTimeToLocalTime() returns for that time.
+*/
+bool CheckNonexistentTimezoneId()
+{
+    const Timezone *tz = Timezone::Find( L"Eastern Standard Time" );
+    if( !tz )
+        return false;
+
+    const SYSTEMTIME gap = { 2024, 3, 0, 10, 2, 30, 0, 0 }; // nonexistent 2:30 AM
+    const LocalTimePolicy policies[] = { LOCAL_TIME_EARLIER, LOCAL_TIME_LATER };
+
+    for( size_t i = 0; i < ( sizeof( policies ) / sizeof( policies[ 0 ] ) ); ++i )
+    {
+        SYSTEMTIME utc = {}, local = {};
+        DWORD tzi_id = 0, expected = 0;
+        TIME_ZONE_INFORMATION tzi = {};
+
+        if( !LocalTimeToUTCTime( gap, utc, tzi_id, policies[ i ], LOCAL_TIME_REJECT, *tz )
+            || !UTCTimeToLocalTime( utc, local, expected, tzi, *tz )
+            || ( tzi_id != expected ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/* CheckConversions()
+- Run each check and show the ones that fail.
+
+[ret][failure] (false) : At least one check failed
+[ret][success] (true) : Every check passed
+*/
+bool CheckConversions()
+{
+    struct Check
+    {
+        const char *name;
+        bool ( *function )();
+    };
+
+    const Check checks[] =
+    {
+        { "LocalTimeCursor sub-millisecond offset", CheckCursorSubMillisecondOffset },
+        { "Calendar bucket at local midnight", CheckCalendarBucketAtMidnight },
+        { "LocalTimeToUTCTime() nonexistent time ID", CheckNonexistentTimezoneId },
+    };
+
+    bool success = true;
+
+    for( size_t i = 0; i < ( sizeof( checks ) / sizeof( checks[ 0 ] ) ); ++i )
+    {
+        if( !checks[ i ].function() )
+        {
+            cout << "Check failed: " << checks[ i ].name << endl;
+            success = false;
+        }
+    }
+
+    return success;
+}
+#endif // CHECK_CONVERSIONS
+
+
+
 int main()
 {
     SYSTEMTIME local = {}, utc = {};
@@ -111,5 +261,11 @@ I used this for testing purposes when I was writing timezone.cpp.
 #endif // COMPARE_TO_WINAPI
 
 
+#ifdef CHECK_CONVERSIONS
+    if( !CheckConversions() )
+        return 1;
+#endif // CHECK_CONVERSIONS
+
+
     return 0;
 }
@@ -0,0 +1,155 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Map between Windows zone key names and IANA (Olson) timezone ids.
+
+Documentation is in timezone_iana.hpp. The tables are generated by timezone_iana_compiler.cpp.
+*/
+
+#include "timezone_iana.hpp"
+#include "timezone.hpp"
+
+#include <string.h>
+#include <windows.h>
+#include <wchar.h>
+
+
+using namespace std;
+
+
+
+namespace {
+
+struct WindowsZone
+{
+    const WCHAR *key_name;
+    const char *iana_id;
+};
+
+struct IANAZone
+{
+    const char *iana_id;
+    WORD windows_zone;
+};
+
+
+/* The generated file defines 'windows_zones' and 'iana_zones', and the seeds and slots of their
+perfect hashes. The tables are POD so they are constant initialized.
+*/
+#include "timezone_iana_data.inc"
+
+const size_t windows_zones_count = sizeof( windows_zones ) / sizeof( windows_zones[ 0 ] );
+
+
+// The slot of a name, which has the index of the only entry that can match it
+template <class Char, size_t seed_count, size_t slot_count>
+WORD FindSlot(
+    const Char *name,
+    const WORD ( &seeds )[ seed_count ],
+    const WORD ( &slots )[ slot_count ]
+)
+{
+    const WORD seed = seeds[ jay::time::HashTimezoneName( name, 0 ) % seed_count ];
+    return slots[ jay::time::HashTimezoneName( name, seed ) % slot_count ];
+}
+
+
+// The index of a Windows zone. False if it's not in the mapping.
+bool FindWindowsZone( const WCHAR *key_name, size_t &index )
+{
+    if( !key_name )
+        return false;
+
+    index = FindSlot( key_name, windows_zone_seeds, windows_zone_slots );
+
+    return ( index < windows_zones_count )
+        && !_wcsicmp( key_name, windows_zones[ index ].key_name );
+}
+
+
+// The index of the Windows zone of an IANA id. False if it's not in the mapping.
+bool FindWindowsZone( const char *iana_id, size_t &index )
+{
+    if( !iana_id )
+        return false;
+
+    const size_t slot = FindSlot( iana_id, iana_zone_seeds, iana_zone_slots );
+
+    if( ( slot >= sizeof( iana_zones ) / sizeof( iana_zones[ 0 ] ) )
+        || _stricmp( iana_id, iana_zones[ slot ].iana_id )
+    )
+        return false;
+
+    index = iana_zones[ slot ].windows_zone;
+    return true;
+}
+
+
+/* The handle of each Windows zone once it has been found. Timezone::Find() returns the same handle
+every time for a zone so a handle is never replaced by a different one. Zero initialized before any
+code runs.
+*/
+const jay::time::Timezone *volatile windows_zone_handles[ windows_zones_count ];
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+const char *GetIANATimezoneId( const WCHAR *key_name )
+{
+    size_t index = 0;
+    return FindWindowsZone( key_name, index ) ? windows_zones[ index ].iana_id : NULL;
+}
+
+
+const WCHAR *GetWindowsTimezoneKeyName( const char *iana_id )
+{
+    size_t index = 0;
+    return FindWindowsZone( iana_id, index ) ? windows_zones[ index ].key_name : NULL;
+}
+
+
+
+const Timezone *FindTimezoneByIANA( const char *iana_id )
+{
+    size_t index = 0;
+    if( !FindWindowsZone( iana_id, index ) )
+    {
+        SetLastError( ERROR_NOT_FOUND );
+        return NULL;
+    }
+
+    const Timezone *tz = windows_zone_handles[ index ];
+    if( tz )
+        return tz;
+
+    tz = Timezone::Find( windows_zones[ index ].key_name );
+    if( !tz )
+        return NULL;
+
+    InterlockedExchangePointer( (PVOID volatile *)&windows_zone_handles[ index ], (PVOID)tz );
+    return tz;
+}
+
+} // namespace time
+} // namespace jay
@@ -0,0 +1,155 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Map between Windows zone key names and IANA (Olson) timezone ids.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+A zone is identified on Windows by its registry key name, eg "Eastern Standard Time", which is the
+TimeZoneKeyName in DYNAMIC_TIME_ZONE_INFORMATION. Other systems identify it by an IANA id, eg
+"America/New_York". The mapping between them is the CLDR windowsZones data, a copy of which is
+windowsZones.xml.
+
+Several IANA ids map to each Windows zone, eg "America/Detroit" is also "Eastern Standard Time". A
+Windows zone maps to one IANA id, the one CLDR gives for territory 001 (the world).
+
+    const Timezone *tz = FindTimezoneByIANA( "America/New_York" );
+    if( tz && UTCTimeToLocalTime( utc_st, local_time, tzi_id, tzi, *tz ) )
+        ...
+
+The tables are generated by timezone_iana_compiler.cpp from windowsZones.xml into
+timezone_iana_data.inc, which is compiled into the program. Each direction is a minimal perfect
+hash: the name is hashed once to pick a seed, hashed again with the seed to get the only entry it
+can be, and compared to that entry. Looking up a name takes the same time no matter how many zones
+there are and allocates nothing.
+
+FindTimezoneByIANA() keeps the handle of each Windows zone once it has been found, so only the first
+lookup of a zone calls Timezone::Find() (which takes a lock and may read the registry). After that
+it's lock free and allocates nothing, so it's suitable for resolving a zone on every request.
+
+The IANA ids are as in the copy of the CLDR data, which has the names that were current when it was
+generated (eg "Asia/Calcutta", not "Asia/Kolkata"). To update the data replace windowsZones.xml with
+a newer copy and generate timezone_iana_data.inc again:
+
+    timezone_iana_compiler windowsZones.xml > timezone_iana_data.inc
+*/
+
+#ifndef _JAY_TIME_TIMEZONE_IANA_HPP
+#define _JAY_TIME_TIMEZONE_IANA_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+
+
+namespace jay {
+namespace time {
+
+/* GetIANATimezoneId()
+- Get the IANA id of a Windows zone.
+
+The name is not case sensitive, the same as a registry key name.
+
+[in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+[ret][failure] (NULL) : The zone is not in the mapping
+[ret][success] (const char *) : The IANA id for territory 001, eg "America/New_York". It is valid
+for the life of the program.
+*/
+const char *GetIANATimezoneId( const WCHAR *key_name );
+
+
+/* GetWindowsTimezoneKeyName()
+- Get the Windows zone of an IANA id.
+
+The id is not case sensitive.
+
+[in] 'iana_id' : The IANA id of the zone, eg "America/Detroit"
+[ret][failure] (NULL) : The id is not in the mapping
+[ret][success] (const WCHAR *) : The Windows registry key name of the zone, eg
+"Eastern Standard Time". It is valid for the life of the program.
+*/
+const WCHAR *GetWindowsTimezoneKeyName( const char *iana_id );
+
+
+/* FindTimezoneByIANA()
+- Find a zone by its IANA id.
+
+This is Timezone::Find() for the Windows zone of 'iana_id'. Every IANA id of a Windows zone returns
+the same handle.
+
+######
+::GetLastError() codes set by this function:
+
+ERROR_NOT_FOUND : The id is not in the mapping.
+
+If a failure occurs finding the zone the error code may be different from the above. Refer to
+Timezone::Find().
+######
+
+[in] 'iana_id' : The IANA id of the zone, eg "America/New_York"
+[ret][failure] (NULL) : The zone was not found or could not be read. An error code was set.
+[ret][success] (const Timezone *) : The handle. It is valid for the life of the program.
+*/
+const Timezone *FindTimezoneByIANA( const char *iana_id );
+
+
+/* HashTimezoneName()
+- Hash a zone name for the perfect hash tables.
+
+The hash ignores ASCII case so that it agrees with the case insensitive comparison of the names.
+It's used by timezone_iana.cpp and by timezone_iana_compiler.cpp to generate the tables, so the two
+must be built with the same function.
+
+[in] 'name' : A Windows key name or IANA id
+[in] 'seed' : The seed. 0 picks the seed of the name's group.
+[ret] (DWORD) : The hash
+*/
+template <class Char>
+inline DWORD HashTimezoneName( const Char *name, const DWORD seed )
+{
+    // FNV-1a, with the seed mixed into the offset basis and the result mixed so that the low bits
+    // depend on every character
+    unsigned long hash = ( 2166136261UL ^ ( seed * 0x9E3779B1UL ) ) & 0xFFFFFFFFUL;
+
+    for( ; *name; ++name )
+    {
+        unsigned long c = (unsigned long)*name & 0xFFFF;
+
+        if( ( c >= 'A' ) && ( c <= 'Z' ) )
+            c += 'a' - 'A';
+
+        hash = ( ( hash ^ c ) * 16777619UL ) & 0xFFFFFFFFUL;
+    }
+
+    hash ^= hash >> 15;
+    hash = ( hash * 0x2C1B3C6DUL ) & 0xFFFFFFFFUL;
+    hash ^= hash >> 12;
+
+    return (DWORD)hash;
+}
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_TIMEZONE_IANA_HPP
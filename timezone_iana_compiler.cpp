@@ -0,0 +1,360 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Compile the CLDR windowsZones data into the perfect hash tables of timezone_iana.cpp.
+
+Usage: timezone_iana_compiler <windowsZones.xml>
+
+The tables are written to stdout. Refer to timezone_iana.hpp.
+
+eg: timezone_iana_compiler windowsZones.xml > timezone_iana_data.inc
+
+Each direction is a minimal perfect hash of its names (hash and displace). The names are put into
+groups by HashTimezoneName( name, 0 ), and starting with the largest group a seed is found for each
+group that hashes its names to slots that are all free. The slot of a name is then:
+
+    seed = seeds[ HashTimezoneName( name, 0 ) % seed_count ]
+    slot = slots[ HashTimezoneName( name, seed ) % slot_count ]
+
+To build it:
+g++ -Wall -o timezone_iana_compiler timezone_iana_compiler.cpp
+cl /W4 /EHsc timezone_iana_compiler.cpp
+*/
+
+#include "timezone_iana.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+
+using namespace std;
+using namespace jay::time;
+
+
+
+// The value of a slot that has no name. Only possible if the table isn't minimal.
+const WORD empty_slot = 0xFFFF;
+
+
+bool LessName( const string &a, const string &b )
+{
+    return _stricmp( a.c_str(), b.c_str() ) < 0;
+}
+
+typedef map<string, string, bool (*)( const string &, const string & )> NameMap;
+
+
+// Get the value of an XML attribute. False if the tag doesn't have it.
+bool GetAttribute( const string &tag, const string &name, string &value )
+{
+    const string prefix = " " + name + "=\"";
+
+    const size_t begin = tag.find( prefix );
+    if( begin == string::npos )
+        return false;
+
+    const size_t end = tag.find( '"', begin + prefix.size() );
+    if( end == string::npos )
+        return false;
+
+    value.clear();
+    for( size_t i = begin + prefix.size(); i < end; ++i )
+    {
+        static const char *const entities[][ 2 ] = {
+            { "&amp;", "&" }, { "&lt;", "<" }, { "&gt;", ">" },
+            { "&quot;", "\"" }, { "&apos;", "'" }
+        };
+
+        size_t j = 0;
+        for( ; j < sizeof( entities ) / sizeof( entities[ 0 ] ); ++j )
+        {
+            if( !tag.compare( i, strlen( entities[ j ][ 0 ] ), entities[ j ][ 0 ] ) )
+            {
+                value += entities[ j ][ 1 ];
+                i += strlen( entities[ j ][ 0 ] ) - 1;
+                break;
+            }
+        }
+
+        if( j == sizeof( entities ) / sizeof( entities[ 0 ] ) )
+            value += tag[ i ];
+    }
+
+    return true;
+}
+
+
+/* Find a seed for each group of names so that every name has its own slot. 'slots' is the index
+of the name in each slot. False if a seed could not be found for a group.
+*/
+bool BuildPerfectHash(
+    const vector<string> &names,
+    const size_t seed_count,
+    vector<WORD> &seeds,
+    vector<WORD> &slots
+)
+{
+    const size_t slot_count = names.size();
+
+    vector< vector<size_t> > groups( seed_count );
+    for( size_t i = 0; i < names.size(); ++i )
+        groups[ HashTimezoneName( names[ i ].c_str(), 0 ) % seed_count ].push_back( i );
+
+    // the largest groups are the hardest to place so they go first, while most slots are free
+    vector< pair<size_t, size_t> > order;
+    for( size_t i = 0; i < seed_count; ++i )
+        order.push_back( make_pair( groups[ i ].size(), i ) );
+
+    sort( order.rbegin(), order.rend() );
+
+    seeds.assign( seed_count, 1 );
+    slots.assign( slot_count, empty_slot );
+
+    for( size_t i = 0; i < order.size() && order[ i ].first; ++i )
+    {
+        const vector<size_t> &group = groups[ order[ i ].second ];
+
+        DWORD seed = 1;
+        for( ; seed <= 0xFFFF; ++seed )
+        {
+            vector<size_t> taken;
+
+            size_t j = 0;
+            for( ; j < group.size(); ++j )
+            {
+                const size_t slot =
+                    HashTimezoneName( names[ group[ j ] ].c_str(), seed ) % slot_count;
+
+                if( ( slots[ slot ] != empty_slot )
+                    || ( find( taken.begin(), taken.end(), slot ) != taken.end() )
+                )
+                    break;
+
+                taken.push_back( slot );
+            }
+
+            if( j == group.size() )
+            {
+                for( j = 0; j < group.size(); ++j )
+                    slots[ taken[ j ] ] = (WORD)group[ j ];
+
+                break;
+            }
+        }
+
+        if( seed > 0xFFFF )
+            return false;
+
+        seeds[ order[ i ].second ] = (WORD)seed;
+    }
+
+    return true;
+}
+
+
+// Build the perfect hash with as few seeds as possible
+bool BuildPerfectHash( const vector<string> &names, vector<WORD> &seeds, vector<WORD> &slots )
+{
+    for( size_t seed_count = ( names.size() + 3 ) / 4; seed_count <= names.size(); ++seed_count )
+    {
+        if( BuildPerfectHash( names, seed_count, seeds, slots ) )
+            return true;
+    }
+
+    return false;
+}
+
+
+string WordArray( const string &name, const vector<WORD> &values )
+{
+    stringstream ss;
+
+    ss << "const WORD " << name << "[] = {";
+    for( size_t i = 0; i < values.size(); ++i )
+        ss << ( ( i % 12 ) ? " " : "\n    " ) << values[ i ] << ",";
+    ss << endl << "};" << endl;
+
+    return ss.str();
+}
+
+
+int main( int argc, char *argv[] )
+{
+    const char *usage = "Usage: timezone_iana_compiler <windowsZones.xml>";
+
+    if( argc != 2 )
+    {
+        cerr << usage << endl;
+        return 1;
+    }
+
+    ifstream file( argv[ 1 ] );
+    if( !file )
+    {
+        cerr << "Error: Failed to open \"" << argv[ 1 ] << "\"." << endl;
+        return 1;
+    }
+
+    // Windows key name => IANA id for territory 001
+    NameMap windows_zones( LessName );
+
+    // IANA id => Windows key name
+    NameMap iana_zones( LessName );
+
+    string line;
+    while( getline( file, line ) )
+    {
+        const size_t begin = line.find( "<mapZone " );
+        if( begin == string::npos )
+            continue;
+
+        const string tag = line.substr( begin );
+        string key_name, territory, types;
+
+        if( !GetAttribute( tag, "other", key_name )
+            || !GetAttribute( tag, "territory", territory )
+            || !GetAttribute( tag, "type", types )
+        )
+        {
+            cerr << "Error: mapZone is missing an attribute: " << line << endl;
+            return 1;
+        }
+
+        for( size_t i = 0; i < key_name.size(); ++i )
+        {
+            if( ( key_name[ i ] < 0x20 ) || ( key_name[ i ] >= 0x7F ) )
+            {
+                cerr << "Error: Key name \"" << key_name << "\" is not printable ASCII." << endl;
+                return 1;
+            }
+        }
+
+        if( territory == "001" )
+            windows_zones[ key_name ] = types;
+        else if( !windows_zones.count( key_name ) )
+            windows_zones[ key_name ] = "";
+
+        stringstream ss( types );
+        string iana_id;
+        while( ss >> iana_id )
+        {
+            if( iana_zones.count( iana_id ) && _stricmp( iana_zones[ iana_id ].c_str(),
+                    key_name.c_str() )
+            )
+            {
+                cerr << "Error: IANA id \"" << iana_id << "\" is mapped to both \""
+                    << iana_zones[ iana_id ] << "\" and \"" << key_name << "\"." << endl;
+                return 1;
+            }
+
+            iana_zones[ iana_id ] = key_name;
+        }
+    }
+
+    vector<string> key_names, iana_ids;
+
+    for( NameMap::const_iterator it = windows_zones.begin();
+        it != windows_zones.end();
+        ++it
+    )
+    {
+        if( it->second.empty() || ( it->second.find( ' ' ) != string::npos ) )
+        {
+            cerr << "Error: Zone \"" << it->first << "\" does not have one IANA id for territory "
+                << "001." << endl;
+            return 1;
+        }
+
+        key_names.push_back( it->first );
+    }
+
+    for( NameMap::const_iterator it = iana_zones.begin();
+        it != iana_zones.end();
+        ++it
+    )
+        iana_ids.push_back( it->first );
+
+    if( key_names.empty() || ( key_names.size() >= empty_slot )
+        || ( iana_ids.size() >= empty_slot )
+    )
+    {
+        cerr << "Error: The number of zones is not supported." << endl;
+        return 1;
+    }
+
+    vector<WORD> windows_seeds, windows_slots, iana_seeds, iana_slots;
+
+    if( !BuildPerfectHash( key_names, windows_seeds, windows_slots )
+        || !BuildPerfectHash( iana_ids, iana_seeds, iana_slots )
+    )
+    {
+        cerr << "Error: Failed to build the perfect hash." << endl;
+        return 1;
+    }
+
+    stringstream ss_windows, ss_iana;
+
+    ss_windows << "// The Windows zones sorted by key name (not case sensitive) and their IANA id "
+        << "for territory 001" << endl
+        << "const WindowsZone windows_zones[] = {" << endl;
+
+    for( size_t i = 0; i < key_names.size(); ++i )
+    {
+        ss_windows << "    { L\"" << key_names[ i ] << "\", \"" << windows_zones[ key_names[ i ] ]
+            << "\" }," << endl;
+    }
+
+    ss_windows << "};" << endl << endl;
+
+    ss_iana << "// The IANA ids sorted (not case sensitive) and the index of their Windows zone"
+        << endl << "const IANAZone iana_zones[] = {" << endl;
+
+    for( size_t i = 0; i < iana_ids.size(); ++i )
+    {
+        const size_t index = lower_bound( key_names.begin(), key_names.end(),
+            iana_zones[ iana_ids[ i ] ], LessName ) - key_names.begin();
+
+        ss_iana << "    { \"" << iana_ids[ i ] << "\", " << index << " }," << endl;
+    }
+
+    ss_iana << "};" << endl << endl;
+
+    cout << "/* Generated by timezone_iana_compiler.cpp. Do not edit." << endl
+        << "Refer to timezone_iana.hpp." << endl
+        << "*/" << endl << endl
+        << ss_windows.str() << ss_iana.str()
+        << "// The seed of each group and the index of the name in each slot" << endl
+        << WordArray( "windows_zone_seeds", windows_seeds )
+        << WordArray( "windows_zone_slots", windows_slots ) << endl
+        << WordArray( "iana_zone_seeds", iana_seeds )
+        << WordArray( "iana_zone_slots", iana_slots );
+
+    return 0;
+}
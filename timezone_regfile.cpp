@@ -0,0 +1,704 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Zones read from a .reg file exported from the Windows registry.
+
+Documentation is in timezone_regfile.hpp.
+*/
+
+#include "timezone_regfile.hpp"
+#include "timezone.hpp"
+#include "time.hpp"
+
+#include <windows.h>
+#include <wchar.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <sstream>
+
+
+using namespace std;
+
+
+
+namespace {
+
+// The size of a REG_TZI_FORMAT, which is how the "TZI" and "Dynamic DST" year values are stored
+const size_t reg_tzi_size = 44;
+
+// The part of a key path before a zone's key name
+const wchar_t time_zones_subkey[] = L"\\CurrentVersion\\Time Zones\\";
+
+
+struct LessName
+{
+    bool operator()( const wstring &a, const wstring &b ) const
+    {
+        return _wcsicmp( a.c_str(), b.c_str() ) < 0;
+    }
+};
+
+
+// A value in the file. A REG_SZ is 'str' and anything else is 'data'.
+struct RegValue
+{
+    DWORD type;
+    wstring str;
+    vector<BYTE> data;
+};
+
+typedef map<wstring, RegValue, LessName> RegValues;
+
+// The values of a zone's key and of its "Dynamic DST" key
+struct RegZone
+{
+    RegValues values;
+    RegValues dynamic_values;
+    bool dynamic;
+};
+
+typedef map<wstring, RegZone, LessName> RegZones;
+
+
+/* Decode the file to text. UTF-16LE if it has a BOM, otherwise UTF-8. A byte that isn't part of a
+valid UTF-8 sequence is read as Latin-1 since a REGEDIT4 file is in the ANSI code page.
+*/
+void DecodeRegFile( const BYTE *data, const size_t size, wstring &text )
+{
+    text.clear();
+
+    if( ( size >= 2 ) && ( data[ 0 ] == 0xFF ) && ( data[ 1 ] == 0xFE ) )
+    {
+        for( size_t i = 2; ( i + 1 ) < size; i += 2 )
+            text += (wchar_t)( data[ i ] | ( data[ i + 1 ] << 8 ) );
+
+        return;
+    }
+
+    size_t i = 0;
+    if( ( size >= 3 ) && ( data[ 0 ] == 0xEF ) && ( data[ 1 ] == 0xBB ) && ( data[ 2 ] == 0xBF ) )
+        i = 3;
+
+    while( i < size )
+    {
+        const BYTE c = data[ i ];
+        const size_t length = ( c >= 0xF0 ) ? 4 : ( c >= 0xE0 ) ? 3 : ( c >= 0xC2 ) ? 2 : 1;
+        unsigned long code_point = ( length == 1 ) ? c : ( c & ( 0x7F >> length ) );
+
+        size_t j = 1;
+        for( ; ( j < length ) && ( ( i + j ) < size ) && ( ( data[ i + j ] & 0xC0 ) == 0x80 ); ++j )
+            code_point = ( code_point << 6 ) | ( data[ i + j ] & 0x3F );
+
+        if( ( j < length ) || ( code_point > 0xFFFF ) )
+        {
+            text += (wchar_t)c;
+            ++i;
+            continue;
+        }
+
+        text += (wchar_t)code_point;
+        i += length;
+    }
+}
+
+
+// Remove whitespace from the beginning and end of 's'
+wstring Trim( const wstring &s )
+{
+    const size_t begin = s.find_first_not_of( L" \t\r" );
+    if( begin == wstring::npos )
+        return wstring();
+
+    return s.substr( begin, s.find_last_not_of( L" \t\r" ) - begin + 1 );
+}
+
+
+// Find 'needle' in 's', ignoring ASCII case
+size_t FindNoCase( const wstring &s, const wchar_t *needle )
+{
+    const size_t length = wcslen( needle );
+
+    for( size_t i = 0; ( i + length ) <= s.size(); ++i )
+    {
+        size_t j = 0;
+        for( ; j < length; ++j )
+        {
+            wchar_t a = s[ i + j ], b = needle[ j ];
+            if( ( a >= L'A' ) && ( a <= L'Z' ) )
+                a += L'a' - L'A';
+            if( ( b >= L'A' ) && ( b <= L'Z' ) )
+                b += L'a' - L'A';
+            if( a != b )
+                break;
+        }
+
+        if( j == length )
+            return i;
+    }
+
+    return wstring::npos;
+}
+
+
+// Parse the quoted string at 'pos' and move past it. \ escapes the character after it.
+bool ParseQuoted( const wstring &s, size_t &pos, wstring &out )
+{
+    if( ( pos >= s.size() ) || ( s[ pos ] != L'"' ) )
+        return false;
+
+    out.clear();
+    for( ++pos; pos < s.size(); ++pos )
+    {
+        if( s[ pos ] == L'"' )
+        {
+            ++pos;
+            return true;
+        }
+
+        if( ( s[ pos ] == L'\\' ) && ( ( pos + 1 ) < s.size() ) )
+            ++pos;
+
+        out += s[ pos ];
+    }
+
+    return false;
+}
+
+
+// The value of a hex digit, or -1
+int HexDigit( const wchar_t c )
+{
+    if( ( c >= L'0' ) && ( c <= L'9' ) )
+        return c - L'0';
+    if( ( c >= L'a' ) && ( c <= L'f' ) )
+        return c - L'a' + 10;
+    if( ( c >= L'A' ) && ( c <= L'F' ) )
+        return c - L'A' + 10;
+    return -1;
+}
+
+
+// Parse comma separated hex bytes, eg "2c,01,00"
+bool ParseHexBytes( const wstring &s, vector<BYTE> &data )
+{
+    data.clear();
+
+    const wstring trimmed = Trim( s );
+    if( trimmed.empty() )
+        return true;
+
+    size_t pos = 0;
+    for( ;; )
+    {
+        pos = trimmed.find_first_not_of( L" \t", pos );
+
+        if( ( pos == wstring::npos ) || ( ( pos + 2 ) > trimmed.size() ) )
+            return false;
+
+        const int high = HexDigit( trimmed[ pos ] ), low = HexDigit( trimmed[ pos + 1 ] );
+        if( ( high < 0 ) || ( low < 0 ) )
+            return false;
+
+        data.push_back( (BYTE)( ( high << 4 ) | low ) );
+        pos = trimmed.find_first_not_of( L" \t", pos + 2 );
+
+        if( pos == wstring::npos )
+            return true;
+
+        if( trimmed[ pos ] != L',' )
+            return false;
+
+        ++pos;
+    }
+}
+
+
+// Parse the data of a value, everything after the '='
+bool ParseValueData( const wstring &s, RegValue &value )
+{
+    value.str.clear();
+    value.data.clear();
+
+    if( !s.empty() && ( s[ 0 ] == L'"' ) )
+    {
+        size_t pos = 0;
+        value.type = REG_SZ;
+        return ParseQuoted( s, pos, value.str ) && Trim( s.substr( pos ) ).empty();
+    }
+
+    if( !s.compare( 0, 6, L"dword:" ) )
+    {
+        const wstring digits = Trim( s.substr( 6 ) );
+        if( digits.size() != 8 )
+            return false;
+
+        value.type = REG_DWORD;
+        value.data.resize( 4 );
+        for( size_t i = 0; i < 4; ++i )
+        {
+            const int high = HexDigit( digits[ 6 - ( i * 2 ) ] );
+            const int low = HexDigit( digits[ 7 - ( i * 2 ) ] );
+            if( ( high < 0 ) || ( low < 0 ) )
+                return false;
+
+            value.data[ i ] = (BYTE)( ( high << 4 ) | low );
+        }
+
+        return true;
+    }
+
+    if( !s.compare( 0, 4, L"hex:" ) )
+    {
+        value.type = REG_BINARY;
+        return ParseHexBytes( s.substr( 4 ), value.data );
+    }
+
+    // hex(type): is any other type
+    if( !s.compare( 0, 4, L"hex(" ) )
+    {
+        const size_t end = s.find( L"):" );
+        if( ( end == wstring::npos ) || ( end == 4 ) )
+            return false;
+
+        value.type = 0;
+        for( size_t i = 4; i < end; ++i )
+        {
+            const int digit = HexDigit( s[ i ] );
+            if( ( digit < 0 ) || ( value.type > 0x0FFFFFFF ) )
+                return false;
+
+            value.type = ( value.type << 4 ) | (DWORD)digit;
+        }
+
+        return ParseHexBytes( s.substr( end + 2 ), value.data );
+    }
+
+    return false;
+}
+
+
+// A little endian 32-bit signed integer
+LONG GetLong( const BYTE *p )
+{
+    const DWORD u = (DWORD)p[ 0 ] | ( (DWORD)p[ 1 ] << 8 ) | ( (DWORD)p[ 2 ] << 16 )
+        | ( (DWORD)p[ 3 ] << 24 );
+
+    // LONG is wider than 32 bits on some platforms, so the sign is extended explicitly
+    return ( u & 0x80000000UL ) ? ( (LONG)( u - 0x80000000UL ) - 0x7FFFFFFF - 1 ) : (LONG)u;
+}
+
+
+WORD GetWord( const BYTE *p )
+{
+    return (WORD)( p[ 0 ] | ( p[ 1 ] << 8 ) );
+}
+
+
+void GetSystemTime( const BYTE *p, SYSTEMTIME &st )
+{
+    st.wYear = GetWord( p );
+    st.wMonth = GetWord( p + 2 );
+    st.wDayOfWeek = GetWord( p + 4 );
+    st.wDay = GetWord( p + 6 );
+    st.wHour = GetWord( p + 8 );
+    st.wMinute = GetWord( p + 10 );
+    st.wSecond = GetWord( p + 12 );
+    st.wMilliseconds = GetWord( p + 14 );
+}
+
+
+// Get a REG_BINARY REG_TZI_FORMAT value as a rule beginning with 'year'
+bool GetTziValue(
+    const RegValues &values,
+    const wchar_t *name,
+    const unsigned year,
+    jay::time::TimezoneRule &rule
+)
+{
+    const RegValues::const_iterator it = values.find( name );
+
+    if( ( it == values.end() ) || ( it->second.type != REG_BINARY )
+        || ( it->second.data.size() != reg_tzi_size )
+    )
+        return false;
+
+    const BYTE *p = &it->second.data[ 0 ];
+
+    rule.year = year;
+    rule.Bias = GetLong( p );
+    rule.StandardBias = GetLong( p + 4 );
+    rule.DaylightBias = GetLong( p + 8 );
+    GetSystemTime( p + 12, rule.StandardDate );
+    GetSystemTime( p + 28, rule.DaylightDate );
+    return true;
+}
+
+
+// Get a REG_DWORD value
+bool GetDwordValue( const RegValues &values, const wchar_t *name, DWORD &value )
+{
+    const RegValues::const_iterator it = values.find( name );
+
+    if( ( it == values.end() ) || ( it->second.type != REG_DWORD )
+        || ( it->second.data.size() != 4 )
+    )
+        return false;
+
+    value = (DWORD)it->second.data[ 0 ] | ( (DWORD)it->second.data[ 1 ] << 8 )
+        | ( (DWORD)it->second.data[ 2 ] << 16 ) | ( (DWORD)it->second.data[ 3 ] << 24 );
+    return true;
+}
+
+
+// Get a REG_SZ value
+bool GetStringValue( const RegValues &values, const wchar_t *name, wstring &value )
+{
+    const RegValues::const_iterator it = values.find( name );
+
+    if( ( it == values.end() ) || ( it->second.type != REG_SZ ) )
+        return false;
+
+    value = it->second.str;
+    return true;
+}
+
+
+/* Get a zone's names and rules from its values, the same as ReadTimezoneRulesFromRegistry() reads
+them from the registry
+*/
+bool GetZoneRules(
+    const RegZone &zone,
+    wstring &standard_name,
+    wstring &daylight_name,
+    vector<jay::time::TimezoneRule> &rules
+)
+{
+    jay::time::TimezoneRule tzi = {};
+
+    if( !GetTziValue( zone.values, L"TZI", 0, tzi )
+        || !GetStringValue( zone.values, L"Std", standard_name )
+        || !GetStringValue( zone.values, L"Dlt", daylight_name )
+    )
+        return false;
+
+    rules.clear();
+
+    if( !zone.dynamic )
+    {
+        rules.push_back( tzi );
+        return true;
+    }
+
+    DWORD first_entry = 0, last_entry = 0;
+
+    if( !GetDwordValue( zone.dynamic_values, L"FirstEntry", first_entry )
+        || !GetDwordValue( zone.dynamic_values, L"LastEntry", last_entry )
+        || !jay::time::IsYearValid( first_entry ) || !jay::time::IsYearValid( last_entry )
+        || ( first_entry > last_entry )
+    )
+        return false;
+
+    for( DWORD year = first_entry; year <= last_entry; ++year )
+    {
+        wstringstream ss_year;
+        ss_year << year;
+
+        jay::time::TimezoneRule rule = {};
+        if( !GetTziValue( zone.dynamic_values, ss_year.str().c_str(), year, rule ) )
+            return false;
+
+        rules.push_back( rule );
+    }
+
+    return true;
+}
+
+} // anonymous namespace
+
+
+
+namespace jay {
+namespace time {
+
+bool TimezoneRegFile::Open( const std::wstring &filename )
+{
+    Close();
+
+    HANDLE file = CreateFileW( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file == INVALID_HANDLE_VALUE )
+        return false;
+
+    LARGE_INTEGER size = {};
+    if( !GetFileSizeEx( file, &size ) || ( size.QuadPart > (LONGLONG)0x7FFFFFFF ) )
+    {
+        DWORD gle = GetLastError();
+        CloseHandle( file );
+        SetLastError( gle ? gle : ERROR_BAD_FORMAT );
+        return false;
+    }
+
+    vector<BYTE> data( (size_t)size.QuadPart );
+    DWORD bytes_read = 0;
+
+    if( data.size()
+        && ( !ReadFile( file, &data[ 0 ], (DWORD)data.size(), &bytes_read, NULL )
+            || ( bytes_read != data.size() )
+        )
+    )
+    {
+        DWORD gle = GetLastError();
+        CloseHandle( file );
+        SetLastError( gle ? gle : ERROR_READ_FAULT );
+        return false;
+    }
+
+    CloseHandle( file );
+    return Parse( ( data.empty() ? NULL : &data[ 0 ] ), data.size() );
+}
+
+
+
+bool TimezoneRegFile::Parse( const void *data, const size_t size )
+{
+    Close();
+
+    if( size && !data )
+    {
+        SetLastError( ERROR_INVALID_PARAMETER );
+        return false;
+    }
+
+    wstring text;
+    DecodeRegFile( (const BYTE *)data, size, text );
+
+    RegZones reg_zones;
+
+    // the values of the key being read, or NULL if it's not a zone or its "Dynamic DST" key
+    RegValues *values = NULL;
+    bool header = false;
+
+    size_t pos = 0;
+    while( pos < text.size() )
+    {
+        size_t end = text.find( L'\n', pos );
+        if( end == wstring::npos )
+            end = text.size();
+
+        wstring line = Trim( text.substr( pos, end - pos ) );
+        pos = end + 1;
+
+        // hex data is continued on the next line after a trailing backslash
+        while( !line.empty() && ( line[ line.size() - 1 ] == L'\\' ) && ( pos < text.size() )
+            && ( line.find( L"=hex" ) != wstring::npos )
+        )
+        {
+            end = text.find( L'\n', pos );
+            if( end == wstring::npos )
+                end = text.size();
+
+            line = line.substr( 0, line.size() - 1 ) + Trim( text.substr( pos, end - pos ) );
+            pos = end + 1;
+        }
+
+        if( line.empty() || ( line[ 0 ] == L';' ) )
+            continue;
+
+        if( !header )
+        {
+            if( ( line != L"Windows Registry Editor Version 5.00" ) && ( line != L"REGEDIT4" ) )
+            {
+                SetLastError( ERROR_BAD_FORMAT );
+                return false;
+            }
+
+            header = true;
+            continue;
+        }
+
+        if( line[ 0 ] == L'[' )
+        {
+            if( line[ line.size() - 1 ] != L']' )
+            {
+                SetLastError( ERROR_INVALID_DATA );
+                return false;
+            }
+
+            const bool remove = ( line.size() > 1 ) && ( line[ 1 ] == L'-' );
+            const wstring path = line.substr( remove ? 2 : 1, line.size() - ( remove ? 3 : 2 ) );
+
+            values = NULL;
+
+            const size_t subkey = FindNoCase( path, time_zones_subkey );
+            if( subkey == wstring::npos )
+                continue;
+
+            const wstring rest = path.substr( subkey + wcslen( time_zones_subkey ) );
+            const size_t separator = rest.find( L'\\' );
+            const wstring key_name = rest.substr( 0, separator );
+
+            if( key_name.empty() )
+                continue;
+
+            if( separator == wstring::npos )
+            {
+                if( remove )
+                    reg_zones.erase( key_name );
+                else
+                    values = &reg_zones[ key_name ].values;
+            }
+            else if( !_wcsicmp( rest.substr( separator + 1 ).c_str(), L"Dynamic DST" ) )
+            {
+                RegZone &zone = reg_zones[ key_name ];
+                zone.dynamic = !remove;
+
+                if( remove )
+                    zone.dynamic_values.clear();
+                else
+                    values = &zone.dynamic_values;
+            }
+
+            continue;
+        }
+
+        if( !values )
+            continue;
+
+        // "name"=data, or @=data for the default value
+        wstring name;
+        size_t data_pos = 0;
+
+        if( line[ 0 ] == L'@' )
+            data_pos = 1;
+        else if( !ParseQuoted( line, data_pos, name ) )
+        {
+            SetLastError( ERROR_INVALID_DATA );
+            return false;
+        }
+
+        if( ( data_pos >= line.size() ) || ( line[ data_pos ] != L'=' ) )
+        {
+            SetLastError( ERROR_INVALID_DATA );
+            return false;
+        }
+
+        const wstring value_data = Trim( line.substr( data_pos + 1 ) );
+
+        if( value_data == L"-" )
+        {
+            values->erase( name );
+            continue;
+        }
+
+        RegValue value = {};
+        if( !ParseValueData( value_data, value ) )
+        {
+            SetLastError( ERROR_INVALID_DATA );
+            return false;
+        }
+
+        ( *values )[ name ] = value;
+    }
+
+    if( !header )
+    {
+        SetLastError( ERROR_BAD_FORMAT );
+        return false;
+    }
+
+    // the map is sorted by key name, not case sensitive
+    _zones.resize( reg_zones.size() );
+
+    size_t i = 0;
+    for( RegZones::const_iterator it = reg_zones.begin(); it != reg_zones.end(); ++it, ++i )
+    {
+        _zones[ i ].key_name = it->first;
+
+        if( !GetZoneRules( it->second, _zones[ i ].standard_name, _zones[ i ].daylight_name,
+                _zones[ i ].rules )
+        )
+        {
+            Close();
+            SetLastError( ERROR_INVALID_DATA );
+            return false;
+        }
+    }
+
+    _open = true;
+    return true;
+}
+
+
+
+bool TimezoneRegFile::GetZone( const size_t index, TimezoneRules &zone ) const
+{
+    if( index >= _zones.size() )
+        return false;
+
+    zone.key_name = _zones[ index ].key_name.c_str();
+    zone.standard_name = _zones[ index ].standard_name.c_str();
+    zone.daylight_name = _zones[ index ].daylight_name.c_str();
+    zone.rules = &_zones[ index ].rules[ 0 ];
+    zone.count = _zones[ index ].rules.size();
+    return true;
+}
+
+
+
+bool TimezoneRegFile::Find( const WCHAR *key_name, TimezoneRules &zone ) const
+{
+    if( !key_name )
+        return false;
+
+    size_t first = 0, last = _zones.size();
+    while( first < last )
+    {
+        const size_t middle = first + ( ( last - first ) / 2 );
+        const int cmp = _wcsicmp( key_name, _zones[ middle ].key_name.c_str() );
+
+        if( !cmp )
+            return GetZone( middle, zone );
+        else if( cmp < 0 )
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    return false;
+}
+
+
+
+bool TimezoneRegFile::AddAll() const
+{
+    for( size_t i = 0; i < _zones.size(); ++i )
+    {
+        TimezoneRules zone = {};
+        if( !GetZone( i, zone ) || !Timezone::Add( zone ) )
+            return false;
+    }
+
+    return true;
+}
+
+} // namespace time
+} // namespace jay
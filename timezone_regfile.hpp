@@ -0,0 +1,170 @@
+/*
+Copyright (C) 2013 Jay Satiro <raysatiro@yahoo.com>
+All rights reserved.
+
+This file is part of jay::time.
+
+jay::time is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+jay::time is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with jay::time. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/** Usage and design:
+
+Zones read from a .reg file exported from the Windows registry.
+
+When a function returns [failure] all output parameters are invalid unless otherwise specified.
+When a function returns [success] all output parameters are valid unless otherwise specified.
+
+
+A program that must convert times exactly the way Windows does, on a machine that doesn't have the
+Windows timezone registry (eg Linux), can use the zones of a Windows machine exported to a file:
+
+    reg export "HKLM\SOFTWARE\Microsoft\Windows NT\CurrentVersion\Time Zones" timezones.reg
+
+A zone in the file is read the same as ReadTimezoneRulesFromRegistry() reads it from the registry:
+the "Std" and "Dlt" names, the "TZI" value and, if the zone has a "Dynamic DST" key, one rule for
+each year in [FirstEntry, LastEntry] from the year values. The rules are a TimezoneRules (refer to
+timezone.hpp) so the timezone information for a year is selected by FindTimezoneRuleForYear(), a
+binary search over the years that makes the same selection as ::GetTimeZoneInformationForYear().
+
+To use the zones in place of the registry add them to the Timezone handles. Timezone::Find() then
+returns them, and one of them can be made the current timezone:
+
+    TimezoneRegFile regfile;
+    if( regfile.Open( L"timezones.reg" ) && regfile.AddAll() )
+        SetTimezoneProvider( Timezone::Find( L"Eastern Standard Time" ) );
+
+The file can also be compiled into a timezone database (refer to timezone_database.hpp) so that it's
+parsed once instead of by every process:
+
+    timezone_compiler --reg timezones.reg --binary timezones.tzdb --all
+
+Both the UTF-16 format of "Windows Registry Editor Version 5.00" and the 8-bit format of "REGEDIT4"
+are read. An 8-bit file is read as UTF-8. Keys other than the zones and their "Dynamic DST" keys are
+ignored, as are values that aren't used. A zone that is exported more than once is the combination
+of its values, the last value of the same name taking precedence, the same as importing the file.
+*/
+
+#ifndef _JAY_TIME_TIMEZONE_REGFILE_HPP
+#define _JAY_TIME_TIMEZONE_REGFILE_HPP
+
+#include "timezone.hpp"
+
+#include <windows.h>
+
+#include <string>
+#include <vector>
+
+
+
+namespace jay {
+namespace time {
+
+/* class TimezoneRegFile
+- The zones read from a .reg file.
+
+The TimezoneRules output by this object point into it. They're valid until the object is closed,
+opened again or destroyed.
+*/
+class TimezoneRegFile
+{
+public:
+    /* TimezoneRegFile::Open()
+    * TimezoneRegFile::Parse()
+    - Read the zones from a .reg file, or from the contents of one.
+
+    Zones that are already read are removed first. Every zone in the file must be valid.
+
+    ######
+    ::GetLastError() codes set by this function:
+
+    ERROR_BAD_FORMAT : The file is not a .reg file.
+    ERROR_INVALID_DATA : A line of the file or a zone's values are malformed.
+    ######
+
+    [in] 'filename' : The name of the file to read
+    [in] 'data' : The contents of a .reg file
+    [in] 'size' : The size of 'data', in bytes
+    [ret][failure] (false) : The file could not be read or is invalid. An error code was set.
+    [ret][success] (true) : The zones were read
+    */
+    bool Open( const std::wstring &filename );
+    bool Parse( const void *data, const size_t size );
+
+    // Remove the zones. The TimezoneRules output by this object are no longer valid.
+    void Close() { _zones.clear(); _open = false; }
+
+    bool IsOpen() const { return _open; }
+
+    // The number of zones
+    size_t GetCount() const { return _zones.size(); }
+
+    /* TimezoneRegFile::GetZone()
+    - Enumerate the zones.
+
+    The zones are sorted by key name, not case sensitive.
+
+    [in] 'index' : [0, GetCount())
+    [out] 'zone' : The zone
+    [ret][failure] (false) : 'index' is out of range
+    [ret][success] (true) : The zone was output
+    */
+    bool GetZone( const size_t index, TimezoneRules &zone ) const;
+
+    /* TimezoneRegFile::Find()
+    - Find a zone by its Windows registry key name.
+
+    The name is not case sensitive, the same as a registry key name. The zones are binary searched.
+
+    [in] 'key_name' : The Windows registry key name of the zone, eg "Eastern Standard Time"
+    [out] 'zone' : The zone
+    [ret][failure] (false) : The zone was not found
+    [ret][success] (true) : The zone was output
+    */
+    bool Find( const WCHAR *key_name, TimezoneRules &zone ) const;
+
+    /* TimezoneRegFile::AddAll()
+    - Add every zone to the Timezone handles.
+
+    Refer to Timezone::Add().
+
+    [ret][failure] (false) : A zone could not be added. An error code was set.
+    [ret][success] (true) : Every zone was added
+    */
+    bool AddAll() const;
+
+    TimezoneRegFile() : _open( false ) {}
+
+private:
+    // not copyable
+    TimezoneRegFile( const TimezoneRegFile & );
+    TimezoneRegFile &operator=( const TimezoneRegFile & );
+
+    struct Zone
+    {
+        std::wstring key_name;
+        std::wstring standard_name;
+        std::wstring daylight_name;
+        std::vector<TimezoneRule> rules;
+    };
+
+    // Sorted by key name, not case sensitive
+    std::vector<Zone> _zones;
+
+    // A file was read successfully. It may have had no zones.
+    bool _open;
+};
+
+} // namespace time
+} // namespace jay
+#endif // _JAY_TIME_TIMEZONE_REGFILE_HPP